@@ -0,0 +1,216 @@
+// Renders a generated scene headless along a fixed camera orbit and writes
+// frame time percentiles, per pass timings and memory use as JSON. The scene
+// is built by script/bench_main.py from the same arguments, so two runs with
+// the same arguments and seed draw the same frames.
+//
+//   engine_bench [--lights n] [--models n] [--bodies n] [--frames n]
+//                [--warmup n] [--seed n] [--window] [--out file]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <glad/glad.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include "ecs/world.h"
+#include "render/render.h"
+#include "render/render_stats.h"
+
+struct BenchConfig {
+  int lights = 256;
+  int models = 200;
+  int bodies = 100;
+  int frames = 600;
+  int warmup = 60;
+  int seed = 1;
+  bool window = false;
+  std::string out = "bench.json";
+};
+
+struct MemoryUsage {
+  // kB, 0 when unknown
+  long long resident = 0;
+  long long peak = 0;
+};
+
+static void PrintUsage(const char* exe) {
+  std::cout << "usage: " << exe << " [options]\n"
+    << "  --lights <n>   point lights, default 256\n"
+    << "  --models <n>   static models, default 200\n"
+    << "  --bodies <n>   dynamic physics bodies, default 100\n"
+    << "  --frames <n>   measured frames, default 600\n"
+    << "  --warmup <n>   frames before measuring, default 60\n"
+    << "  --seed <n>     scene layout seed, default 1\n"
+    << "  --window       render to a window instead of offscreen\n"
+    << "  --out <file>   json report, default bench.json\n";
+}
+
+static bool ParseArgs(int argc, char** argv, BenchConfig& config) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--lights" && has_value) {
+      config.lights = std::atoi(argv[++i]);
+    } else if (arg == "--models" && has_value) {
+      config.models = std::atoi(argv[++i]);
+    } else if (arg == "--bodies" && has_value) {
+      config.bodies = std::atoi(argv[++i]);
+    } else if (arg == "--frames" && has_value) {
+      config.frames = std::atoi(argv[++i]);
+    } else if (arg == "--warmup" && has_value) {
+      config.warmup = std::atoi(argv[++i]);
+    } else if (arg == "--seed" && has_value) {
+      config.seed = std::atoi(argv[++i]);
+    } else if (arg == "--window") {
+      config.window = true;
+    } else if (arg == "--out" && has_value) {
+      config.out = argv[++i];
+    } else {
+      if (arg != "--help" && arg != "-h") {
+        std::cerr << "bad argument: " << arg << std::endl;
+      }
+      PrintUsage(argv[0]);
+      return false;
+    }
+  }
+
+  if (config.frames <= 0 || config.warmup < 0) {
+    std::cerr << "frames must be positive" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static MemoryUsage GetMemoryUsage() {
+  MemoryUsage res;
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    res.resident = counters.WorkingSetSize / 1024;
+    res.peak = counters.PeakWorkingSetSize / 1024;
+  }
+#else
+  FILE* file = fopen("/proc/self/status", "r");
+  if (!file) {
+    return res;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    if (!strncmp(line, "VmRSS:", 6)) {
+      res.resident = std::atoll(line + 6);
+    } else if (!strncmp(line, "VmHWM:", 6)) {
+      res.peak = std::atoll(line + 6);
+    }
+  }
+  fclose(file);
+#endif
+  return res;
+}
+
+static void WriteSeries(FILE* file, const char* key, const render::TimingSeries& series) {
+  fprintf(file, "\"%s\": {\"min\": %.4f, \"avg\": %.4f, \"max\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f}",
+    key, series.Min(), series.Avg(), series.Max(),
+    series.Percentile(0.5f), series.Percentile(0.95f), series.Percentile(0.99f));
+}
+
+static bool WriteReport(const BenchConfig& config, const render::TimingSeries& frame_ms,
+  const render::RenderStats& stats, const MemoryUsage& memory, const MemoryUsage& scene_memory)
+{
+  FILE* file = fopen(config.out.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+
+  auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  auto avg = frame_ms.Avg();
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"config\": {\"lights\": %d, \"models\": %d, \"bodies\": %d, \"frames\": %d, \"warmup\": %d, \"seed\": %d, \"headless\": %s},\n",
+    config.lights, config.models, config.bodies, config.frames, config.warmup, config.seed,
+    config.window ? "false" : "true");
+  fprintf(file, "  \"renderer\": \"%s\",\n", renderer ? renderer : "unknown");
+  fprintf(file, "  ");
+  WriteSeries(file, "frame_ms", frame_ms);
+  fprintf(file, ",\n  \"fps\": %.2f,\n", avg > 0.0f ? 1000.0f / avg : 0.0f);
+  fprintf(file, "  \"dropped_queries\": %llu,\n", static_cast<unsigned long long>(stats.GetDroppedCount()));
+
+  fprintf(file, "  \"passes\": [\n");
+  auto& passes = stats.GetPasses();
+  for (size_t i = 0; i < passes.size(); i++) {
+    fprintf(file, "    {\"name\": \"%s\", ", passes[i].name.c_str());
+    WriteSeries(file, "cpu", passes[i].cpu);
+    fprintf(file, ", ");
+    WriteSeries(file, "gpu", passes[i].gpu);
+    fprintf(file, "}%s\n", i + 1 < passes.size() ? "," : "");
+  }
+  fprintf(file, "  ],\n");
+
+  fprintf(file, "  \"memory_kb\": {\"after_load\": %lld, \"resident\": %lld, \"peak\": %lld}\n",
+    scene_memory.resident, memory.resident, memory.peak);
+  fprintf(file, "}\n");
+
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  BenchConfig config;
+  if (!ParseArgs(argc, argv, config)) {
+    return 1;
+  }
+
+  auto& world = ECS::World::GetInstance();
+  world.ctx.headless = !config.window;
+  world.ctx.max_frames = config.warmup + config.frames;
+  world.ctx.script_module = "bench_main";
+  world.ctx.script_args = {
+    "--lights", std::to_string(config.lights),
+    "--models", std::to_string(config.models),
+    "--bodies", std::to_string(config.bodies),
+    "--seed", std::to_string(config.seed),
+  };
+  world.Init();
+  auto scene_memory = GetMemoryUsage();
+
+  // resources load and the physics settle during warmup
+  for (int i = 0; i < config.warmup; i++) {
+    if (!world.Step()) {
+      return 1;
+    }
+  }
+  glFinish();
+
+  auto& stats = render::Render::GetInstance().GetStats();
+  stats.SetHistorySize(config.frames);
+  render::TimingSeries frame_ms(config.frames);
+
+  auto last = std::chrono::steady_clock::now();
+  for (int i = 0; i < config.frames; i++) {
+    if (!world.Step()) {
+      break;
+    }
+    auto now = std::chrono::steady_clock::now();
+    frame_ms.Push(std::chrono::duration<float, std::milli>(now - last).count());
+    last = now;
+  }
+  glFinish();
+  stats.Flush();
+
+  if (!WriteReport(config, frame_ms, stats, GetMemoryUsage(), scene_memory)) {
+    std::cerr << "fail to write " << config.out << std::endl;
+    return 1;
+  }
+
+  std::cout << "frames: " << frame_ms.Count() << ", avg: " << frame_ms.Avg()
+    << " ms, p99: " << frame_ms.Percentile(0.99f) << " ms, report: " << config.out << std::endl;
+  return 0;
+}
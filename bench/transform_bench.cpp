@@ -0,0 +1,96 @@
+// Compares the batched TRS kernel against composing matrices one by one
+// through glm, the way ComponentTransform::GetTransform used to.
+//
+//   transform_bench [count] [iterations]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtx/quaternion.hpp"
+
+#include "core/simd_transform.h"
+
+struct TRS {
+  glm::vec3 translation;
+  glm::quat rotation;
+  glm::vec3 scale;
+};
+
+template<typename Fn>
+static double Measure(int iterations, Fn&& fn) {
+  fn();
+  auto begin = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    fn();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - begin).count() / iterations;
+}
+
+static float MaxError(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b) {
+  float res = 0.0f;
+  for (size_t i = 0; i < a.size(); i++) {
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) {
+        res = std::fmax(res, std::fabs(a[i][c][r] - b[i][c][r]));
+      }
+    }
+  }
+  return res;
+}
+
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+  int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> pos_dist(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> unit_dist(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> scale_dist(0.1f, 4.0f);
+
+  std::vector<TRS> items(count);
+  core::TRSBuffer trs;
+  trs.Reserve(count);
+  for (auto& item : items) {
+    item.translation = glm::vec3(pos_dist(rng), pos_dist(rng), pos_dist(rng));
+    item.rotation = glm::normalize(glm::quat(unit_dist(rng), unit_dist(rng), unit_dist(rng), unit_dist(rng)));
+    item.scale = glm::vec3(scale_dist(rng), scale_dist(rng), scale_dist(rng));
+
+    float quat[4] = { item.rotation.x, item.rotation.y, item.rotation.z, item.rotation.w };
+    trs.Push(&item.translation.x, quat, &item.scale.x);
+  }
+
+  std::vector<glm::mat4> reference(count);
+  double glm_ms = Measure(iterations, [&]() {
+    for (size_t i = 0; i < count; i++) {
+      auto& item = items[i];
+      auto trans_mat = glm::translate(glm::mat4(1.0f), item.translation);
+      auto rotate_mat = glm::toMat4(item.rotation);
+      auto scale_mat = glm::scale(glm::mat4(1.0f), item.scale);
+      reference[i] = trans_mat * rotate_mat * scale_mat;
+    }
+  });
+
+  std::printf("%zu transforms, %d iterations, detected %s\n", count, iterations,
+    core::GetSimdLevelName(core::DetectSimdLevel()));
+  std::printf("%-8s %10.4f ms %8.2f ns/item\n", "glm", glm_ms, glm_ms * 1e6 / count);
+
+  auto arrays = trs.GetArrays();
+  std::vector<glm::mat4> result(count);
+  for (int level = 0; level <= static_cast<int>(core::DetectSimdLevel()); level++) {
+    auto simd_level = static_cast<core::SimdLevel>(level);
+    double ms = Measure(iterations, [&]() {
+      core::ComposeTRS(arrays, &result[0][0][0], count, simd_level);
+    });
+    std::printf("%-8s %10.4f ms %8.2f ns/item  x%.2f  max err %g\n", core::GetSimdLevelName(simd_level),
+      ms, ms * 1e6 / count, glm_ms / ms, MaxError(reference, result));
+  }
+
+  return 0;
+}
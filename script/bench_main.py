@@ -0,0 +1,123 @@
+import _engine
+
+import argparse
+import math
+import random
+import sys
+from ecs import cdef
+from ecs import scene
+
+# fixed step so every run simulates the same frames
+FRAME_DT = 1.0 / 60.0
+ORBIT_FRAMES = 600.0
+ORBIT_RADIUS = 30.0
+ORBIT_HEIGHT = 8.0
+ORBIT_CENTER = [0.0, -3.0, -10.0]
+
+MATERIALS = ["rusted_iron", "gold", "grass", "plastic", "wall"]
+
+g_scene = None
+g_frame = 0
+
+def ParseArgs():
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--lights", type=int, default=256)
+	parser.add_argument("--models", type=int, default=200)
+	parser.add_argument("--bodies", type=int, default=100)
+	parser.add_argument("--seed", type=int, default=1)
+	return parser.parse_args(sys.argv[1:])
+
+def RandomFloorPos(rng, y):
+	return [rng.uniform(-23.0, 23.0), y, rng.uniform(-33.0, 13.0)]
+
+class BenchScene(scene.PyScene):
+	def __init__(self, args):
+		super().__init__()
+		self._args = args
+		self._rng = random.Random(args.seed)
+		self._cam_trans = None
+		self._cam = None
+
+	def tick(self, dt):
+		self.UpdateCamera(g_frame)
+		self.TickSystems(FRAME_DT)
+
+	def UpdateCamera(self, frame):
+		# one orbit around the arena every ORBIT_FRAMES, looking at the center
+		angle = 2.0 * math.pi * frame / ORBIT_FRAMES
+		pos = [ORBIT_CENTER[0] + math.sin(angle) * ORBIT_RADIUS,
+			ORBIT_CENTER[1] + ORBIT_HEIGHT,
+			ORBIT_CENTER[2] + math.cos(angle) * ORBIT_RADIUS]
+		dx = ORBIT_CENTER[0] - pos[0]
+		dz = ORBIT_CENTER[2] - pos[2]
+
+		self._cam_trans.SetPosition(pos)
+		# forward is (sin(yaw), 0, -cos(yaw))
+		self._cam.SetYaw(math.degrees(math.atan2(dx, -dz)))
+		self._cam.SetPitch(-math.degrees(math.atan2(ORBIT_HEIGHT, math.hypot(dx, dz))))
+
+	def InitBaseSystem(self):
+		self.add_system(_engine.CreateSystemCamera())
+		self.add_system(_engine.CreateSystemModel())
+		self.add_system(_engine.CreateSystemPhysics())
+		self.add_system(_engine.CreateSystemTransform())
+
+		cam_ent = scene.CreateCamera()
+		self._cam = cam_ent.GetComponent(cdef.ComponentType_Camera)
+		self._cam_trans = cam_ent.GetComponent(cdef.ComponentType_Transform)
+		self._cam.Lock(1)
+		self.AddEntity(cam_ent)
+		self.SetActiveCamera(cam_ent.get_id())
+		self.UpdateCamera(0)
+
+	def InitArena(self):
+		# floor
+		self.AddEntity(scene.createBox("", [0.0, -5.0, -10.0], [50.0, 1.0, 50.0]))
+
+		# wall
+		self.AddEntity(scene.createBox("", [-25.0, -3.0, -10.0], [1.0, 4.0, 50.0]))
+		self.AddEntity(scene.createBox("", [25.0, -3.0, -10.0], [1.0, 4.0, 50.0]))
+		self.AddEntity(scene.createBox("", [0.0, -3.0, -35.0], [50.0, 4.0, 1.0]))
+		self.AddEntity(scene.createBox("", [0.0, -3.0, 15.0], [50.0, 4.0, 1.0]))
+
+		self.AddEntity(scene.createDirectionLight([1.0, 1.0, 1.0], [1.0, -1.0, 0.0], 1))
+
+	def InitModels(self):
+		rng = self._rng
+		for i in range(self._args.models):
+			self.AddEntity(scene.createCylinder("resource/images/pbr/wall/albedo.png",
+				RandomFloorPos(rng, -3.0), [1.0, rng.uniform(0.5, 2.0), 1.0]))
+
+	def InitBodies(self):
+		rng = self._rng
+		for i in range(self._args.bodies):
+			self.AddEntity(scene.createBall(rng.choice(MATERIALS),
+				RandomFloorPos(rng, rng.uniform(0.0, 10.0)), 0.5))
+
+	def InitLights(self):
+		rng = self._rng
+		for i in range(self._args.lights):
+			color = [2.0 * rng.random() for x in range(3)]
+			self.AddEntity(scene.createPointLight(color, RandomFloorPos(rng, -2.5), 3.0))
+
+	def Init(self):
+		self.InitBaseSystem()
+		self.InitArena()
+		self.InitModels()
+		self.InitBodies()
+		self.InitLights()
+		self.InitRenderSystem()
+
+def tick():
+	global g_frame
+	g_scene.tick(FRAME_DT)
+	g_frame += 1
+
+def __start__():
+	args = ParseArgs()
+	print("bench scene: %d lights, %d models, %d bodies, seed %d" % (args.lights, args.models, args.bodies, args.seed))
+
+	global g_scene
+	g_scene = BenchScene(args)
+	_engine.get_world().AddScene(g_scene)
+	g_scene.Init()
@@ -130,8 +130,7 @@ class PyScene(_engine.Scene):
         self._sys_list = []
 
     def tick(self, dt):
-        for sys in self._sys_list:
-            sys.tick(dt)
+        self.TickSystems(dt)
 
     def SceneTAA(self):
         # enable IBL skybox
@@ -223,6 +222,7 @@ class PyScene(_engine.Scene):
         self.add_system(_engine.CreateSystemInput())
         
         self.add_system(_engine.CreateSystemPhysics())
+        self.add_system(_engine.CreateSystemTransform())
 
         # camera
         cam_ent = CreateCamera()
@@ -0,0 +1,50 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+struct LightGrid {
+  uint offset;
+  uint count;
+};
+
+layout(std430, binding = 2) buffer LightGridList
+{
+  LightGrid light_grids[];
+};
+
+// ClusterCounters in light_clusters.h
+layout(std430, binding = 5) buffer ClusterCounters {
+  uvec3 dispatch_size;
+  uint active_count;
+  uint index_count;
+  uint index_capacity;
+};
+
+layout(std430, binding = 10) buffer ClusterFlags {
+  uint cluster_flags[];
+};
+
+layout(std430, binding = 11) buffer ActiveClusters {
+  uint active_clusters[];
+};
+
+uniform uint cluster_count;
+
+void main() {
+  uint cluster_idx = gl_GlobalInvocationID.x;
+  if (cluster_idx >= cluster_count) {
+    return;
+  }
+
+  if (cluster_flags[cluster_idx] != 0u) {
+    // cleared for the next frame's mark pass
+    cluster_flags[cluster_idx] = 0u;
+    uint slot = atomicAdd(active_count, 1u);
+    active_clusters[slot] = cluster_idx;
+    atomicMax(dispatch_size.x, slot + 1u);
+  }
+  else {
+    // no pixel reads it, but keep it empty
+    light_grids[cluster_idx].offset = 0u;
+    light_grids[cluster_idx].count = 0u;
+  }
+}
@@ -1,5 +1,6 @@
 #version 430 core
-layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+// a group per active cluster, the threads split the lights
+layout (local_size_x = 64) in;
 
 struct AABBBox {
   vec4 minPoint;
@@ -35,80 +36,70 @@ layout(std430, binding = 4) buffer LightIndexList {
   uint point_light_index[];
 };
 
-layout (std430, binding = 5) buffer globalIndexCountSSBO{
-  uint globalIndexCount;
+layout(std430, binding = 11) buffer ActiveClusters {
+  uint active_clusters[];
 };
 
-uniform mat4 view;
-
-shared PLight batch_lights[64];
+// per view, ViewUniforms in render.h
+layout(std140) uniform ViewUniforms {
+  mat4 view;
+  mat4 projection;
+  mat4 last_vp;
+  vec3 cam_pos;
+  vec2 jitter;
+};
 
-bool testLightAABB(uint light, uint tile);
+uniform uint light_count;
+// 0 counts the lights of the cluster, 1 writes their indices behind the
+// offset of the scan pass
+uniform uint write_indices;
 
-void main() {
-  // uint tile_index = gl_LocalInvocationIndex * gl_NumWorkGroups.x * gl_NumWorkGroups.y + \
-  //                    gl_WorkGroupID.y * gl_NumWorkGroups.x + \
-  //                    gl_WorkGroupID.x;
+shared uint cluster_hits;
 
-  uint thread_count = gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
-  uint tile_index = gl_LocalInvocationIndex +                           \
-                    thread_count * gl_NumWorkGroups.x * gl_NumWorkGroups.y *  gl_WorkGroupID.z + \
-                    thread_count * gl_NumWorkGroups.x * gl_WorkGroupID.y + \
-                    thread_count * gl_WorkGroupID.x;
+bool testLightAABB(uint light, vec3 min_point, vec3 max_point);
 
-  uint visibleLightCount = 0;
-  uint visibleLightIndices[1000];
-  uint light_count = point_lights.length();
-
-  uint batch_count = (light_count + thread_count - 1) / thread_count;
+void main() {
+  uint cluster_idx = active_clusters[gl_WorkGroupID.x];
+  if (gl_LocalInvocationIndex == 0u) {
+    cluster_hits = 0u;
+  }
   barrier();
-  for (uint i=0; i<=batch_count; i++) {
-    uint light_idx = i * thread_count + gl_LocalInvocationIndex;
-    light_idx = min(light_idx, light_count - 1);
 
-    batch_lights[gl_LocalInvocationIndex] = point_lights[light_idx];
-    barrier();
+  vec3 min_point = cluster[cluster_idx].minPoint.xyz;
+  vec3 max_point = cluster[cluster_idx].maxPoint.xyz;
+  uint offset = light_grids[cluster_idx].offset;
+  uint capacity = light_grids[cluster_idx].count;
 
-    for (uint j=0; j<thread_count; j++) {
-      light_idx = i * thread_count + j;
-      if (light_idx >= light_count) {
-        break;
-      }
-      if (testLightAABB(j, tile_index)) {
-        visibleLightIndices[visibleLightCount] = light_idx;
-        visibleLightCount++;
+  uint hits = 0u;
+  for (uint i = gl_LocalInvocationIndex; i < light_count; i += gl_WorkGroupSize.x) {
+    if (!testLightAABB(i, min_point, max_point)) {
+      continue;
+    }
+    if (write_indices != 0u) {
+      uint slot = atomicAdd(cluster_hits, 1u);
+      if (slot < capacity) {
+        point_light_index[offset + slot] = i;
       }
     }
+    else {
+      hits++;
+    }
   }
 
-  uint offset = atomicAdd(globalIndexCount, visibleLightCount);
-  for (uint i=0; i<visibleLightCount; i++) {
-    point_light_index[offset + i] = visibleLightIndices[i];
+  if (write_indices == 0u) {
+    atomicAdd(cluster_hits, hits);
+    barrier();
+    if (gl_LocalInvocationIndex == 0u) {
+      light_grids[cluster_idx].count = cluster_hits;
+    }
   }
-
-  light_grids[tile_index].offset = offset;
-  light_grids[tile_index].count = visibleLightCount;
 }
 
-bool testLightAABB(uint light, uint tile) {
-  vec3 light_pos = (view * vec4(batch_lights[light].position, 1.0)).xyz;
-  float light_radius = batch_lights[light].radius;
-
-  vec3 min_point = cluster[tile].minPoint.xyz;
-  vec3 max_point = cluster[tile].maxPoint.xyz;
-
-  float sum = 0.0;
-  for (uint i=0; i<3; i++) {
-    float l = light_pos[i];
-    float minp = min_point[i];
-    float maxp = max_point[i];
-
-    if (l < minp) {
-      sum += (minp - l) * (minp - l);
-    } else if (l > maxp) {
-      sum += (l - maxp) * (l - maxp);
-    }
-  }
+bool testLightAABB(uint light, vec3 min_point, vec3 max_point) {
+  vec3 light_pos = (view * vec4(point_lights[light].position, 1.0)).xyz;
+  float light_radius = point_lights[light].radius;
 
-  return sum <= (light_radius * light_radius);
+  vec3 closest = clamp(light_pos, min_point, max_point);
+  vec3 diff = closest - light_pos;
+  return dot(diff, diff) <= light_radius * light_radius;
 }
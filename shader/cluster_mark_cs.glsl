@@ -0,0 +1,68 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout(std430, binding = 10) buffer ClusterFlags {
+  uint cluster_flags[];
+};
+
+// per frame, FrameUniforms in render.h
+layout(std140) uniform FrameUniforms {
+  uint screen_width;
+  uint screen_height;
+  uint tile_size;
+  uint z_slices;
+  uint tile_x;
+  uint tile_y;
+  float z_near;
+  float z_far;
+  int enable_ssao;
+  int enable_shadow;
+  int enable_ibl;
+};
+
+// per view, ViewUniforms in render.h
+layout(std140) uniform ViewUniforms {
+  mat4 view;
+  mat4 projection;
+  mat4 last_vp;
+  vec3 cam_pos;
+  vec2 jitter;
+};
+
+uniform sampler2D gPosAO;
+
+void main() {
+  uvec2 pixel = gl_GlobalInvocationID.xy;
+  if (pixel.x >= screen_width || pixel.y >= screen_height) {
+    return;
+  }
+
+  // same cluster as pbr_fs.glsl picks for this pixel
+  vec3 world_pos = texelFetch(gPosAO, ivec2(pixel), 0).rgb;
+  vec3 view_pos = (view * vec4(world_pos, 1.0)).xyz;
+  if (-view_pos.z < z_near) {
+    return;
+  }
+
+  float log_far_near = log(z_far / z_near);
+  float slice = log(-view_pos.z) * z_slices / log_far_near - z_slices * log(z_near) / log_far_near;
+  uint cluster_z = uint(slice);
+  if (cluster_z >= z_slices) {
+    return;
+  }
+
+  uvec2 cluster_xy = pixel / tile_size;
+  uint tile_idx = cluster_xy.y * tile_x + cluster_xy.x;
+  uint slice_size = tile_x * tile_y;
+  cluster_flags[cluster_z * slice_size + tile_idx] = 1u;
+
+  // the light pass computes the slice again, close to a boundary it may
+  // round into the neighbour
+  float depth_frac = fract(slice);
+  if (depth_frac < 0.01 && cluster_z > 0u) {
+    cluster_flags[(cluster_z - 1u) * slice_size + tile_idx] = 1u;
+  }
+  if (depth_frac > 0.99 && cluster_z + 1u < z_slices) {
+    cluster_flags[(cluster_z + 1u) * slice_size + tile_idx] = 1u;
+  }
+}
@@ -0,0 +1,64 @@
+#version 430 core
+// a single group, every thread sums a run of the active clusters
+layout (local_size_x = 1024) in;
+
+struct LightGrid {
+  uint offset;
+  uint count;
+};
+
+layout(std430, binding = 2) buffer LightGridList
+{
+  LightGrid light_grids[];
+};
+
+// ClusterCounters in light_clusters.h
+layout(std430, binding = 5) buffer ClusterCounters {
+  uvec3 dispatch_size;
+  uint active_count;
+  uint index_count;
+  uint index_capacity;
+};
+
+layout(std430, binding = 11) buffer ActiveClusters {
+  uint active_clusters[];
+};
+
+shared uint run_sums[1024];
+
+void main() {
+  uint thread_idx = gl_LocalInvocationIndex;
+  uint thread_count = gl_WorkGroupSize.x;
+  uint run_length = (active_count + thread_count - 1u) / thread_count;
+  uint run_begin = min(thread_idx * run_length, active_count);
+  uint run_end = min(run_begin + run_length, active_count);
+
+  uint run_sum = 0u;
+  for (uint i = run_begin; i < run_end; i++) {
+    run_sum += light_grids[active_clusters[i]].count;
+  }
+  run_sums[thread_idx] = run_sum;
+  barrier();
+
+  // inclusive scan of the run sums
+  for (uint stride = 1u; stride < thread_count; stride <<= 1) {
+    uint value = thread_idx >= stride ? run_sums[thread_idx - stride] : 0u;
+    barrier();
+    run_sums[thread_idx] += value;
+    barrier();
+  }
+
+  uint offset = run_sums[thread_idx] - run_sum;
+  for (uint i = run_begin; i < run_end; i++) {
+    uint cluster_idx = active_clusters[i];
+    uint count = light_grids[cluster_idx].count;
+    light_grids[cluster_idx].offset = offset;
+    // lights past the capacity are dropped, the count says how many fit
+    light_grids[cluster_idx].count = offset < index_capacity ? min(count, index_capacity - offset) : 0u;
+    offset += count;
+  }
+
+  if (thread_idx == thread_count - 1u) {
+    index_count = run_sums[thread_idx];
+  }
+}
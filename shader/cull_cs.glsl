@@ -0,0 +1,101 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// GpuObject, GpuBatch and DrawCommand in gpu_draw_list.h
+struct Object {
+  mat4 model;
+  mat4 last_model;
+  vec4 bounds_min;
+  vec4 bounds_max;
+  uint batch;
+  uint pad0;
+  uint pad1;
+  uint pad2;
+};
+
+struct Batch {
+  uint first_command;
+  uint command_count;
+  uint pad0;
+  uint pad1;
+};
+
+struct DrawCommand {
+  uint count;
+  uint instance_count;
+  uint first_index;
+  int base_vertex;
+  uint base_instance;
+};
+
+layout(std430, binding = 6) readonly buffer ObjectList
+{
+  Object objects[];
+};
+
+layout(std430, binding = 7) readonly buffer BatchList
+{
+  Batch batches[];
+};
+
+layout(std430, binding = 8) buffer CommandList
+{
+  DrawCommand commands[];
+};
+
+layout(std430, binding = 9) writeonly buffer InstanceList
+{
+  uint instances[];
+};
+
+uniform uint object_count;
+// first command of the view
+uniform uint command_offset;
+// world space, inside when dot(xyz, p) + w >= 0
+uniform vec4 planes[6];
+// xyz center, w radius, tested instead of the planes when w > 0
+uniform vec4 sphere;
+
+const uint NO_BATCH = 0xffffffffu;
+
+void main() {
+  uint idx = gl_GlobalInvocationID.x;
+  if (idx >= object_count) {
+    return;
+  }
+
+  Object obj = objects[idx];
+  if (obj.batch == NO_BATCH) {
+    return;
+  }
+
+  // world space aabb of the transformed box
+  vec3 local_center = (obj.bounds_min.xyz + obj.bounds_max.xyz) * 0.5;
+  vec3 local_extents = (obj.bounds_max.xyz - obj.bounds_min.xyz) * 0.5;
+  vec3 center = (obj.model * vec4(local_center, 1.0)).xyz;
+  mat3 abs_model = mat3(abs(obj.model[0].xyz), abs(obj.model[1].xyz), abs(obj.model[2].xyz));
+  vec3 extents = abs_model * local_extents;
+
+  if (sphere.w > 0.0) {
+    vec3 closest = clamp(sphere.xyz, center - extents, center + extents);
+    vec3 diff = closest - sphere.xyz;
+    if (dot(diff, diff) > sphere.w * sphere.w) {
+      return;
+    }
+  }
+  else {
+    for (int i = 0; i < 6; i++) {
+      float radius = dot(extents, abs(planes[i].xyz));
+      if (dot(planes[i].xyz, center) + planes[i].w < -radius) {
+        return;
+      }
+    }
+  }
+
+  Batch batch = batches[obj.batch];
+  for (uint i = 0; i < batch.command_count; i++) {
+    uint command = command_offset + batch.first_command + i;
+    uint slot = atomicAdd(commands[command].instance_count, 1u);
+    instances[commands[command].base_instance + slot] = idx;
+  }
+}
@@ -1,14 +1,38 @@
-#version 330 core
+#version 430 core
 
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTex;
 layout(location = 3) in vec3 aTangent;
 layout(location = 4) in vec3 aBitangent;
+// per instance, written by cull_cs.glsl
+layout(location = 5) in uint aObject;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// GpuObject in gpu_draw_list.h
+struct Object {
+  mat4 model;
+  mat4 last_model;
+  vec4 bounds_min;
+  vec4 bounds_max;
+  uint batch;
+  uint pad0;
+  uint pad1;
+  uint pad2;
+};
+
+layout(std430, binding = 6) readonly buffer ObjectList
+{
+  Object objects[];
+};
+
+// per view, ViewUniforms in render.h
+layout(std140) uniform ViewUniforms {
+  mat4 view;
+  mat4 projection;
+  mat4 last_vp;
+  vec3 cam_pos;
+  vec2 jitter;
+};
 
 out vec3 WorldPos;
 out vec2 TexCoords;
@@ -18,12 +42,11 @@ out vec3 ViewPos;
 out mat3 TBN_View;
 
 // TAA
-uniform vec2 jitter;
-uniform mat4 last_mvp;
 out vec2 real_pos;
 out vec2 last_pos;
 
 void main () {
+  mat4 model = objects[aObject].model;
   vec4 world_pos = model * vec4(aPos, 1.0f);
   vec4 view_pos = view * world_pos;
 
@@ -33,7 +56,7 @@ void main () {
 
   vec4 proj_pos_normal = projection * view_pos;
   vec4 proj_pos_jitter = jitter_projection * view_pos;
-  vec4 last_proj_pos = last_mvp * vec4(aPos, 1.0f);
+  vec4 last_proj_pos = last_vp * objects[aObject].last_model * vec4(aPos, 1.0f);
 
   WorldPos = world_pos.xyz;
   ViewPos = view_pos.xyz;
@@ -27,35 +27,36 @@ layout(std430, binding = 4) buffer LightIndexList {
   uint point_light_index[];
 };
 
-struct PLightShadow {
-  samplerCube shadow_map;
-};
-
 struct DLight {
   vec3 direction;
   vec3 diffuse;
   int shadow_idx;
 };
 
-struct DLightShadow {
-  mat4 shadow_vp;
-  sampler2D shadow_map;
+// per light, LightUniforms in render.h
+#define DIRECTION_LIGHT_MAX_COUNT 256
+#define DIRECTION_SHADOW_MAX_COUNT 16
+layout(std140) uniform LightUniforms {
+  int direction_light_count;
+  DLight direction_light_list[DIRECTION_LIGHT_MAX_COUNT];
+  mat4 direction_shadow_vp[DIRECTION_SHADOW_MAX_COUNT];
+  // uv offset in xy, uv scale in zw of the tile in the atlas
+  vec4 direction_shadow_rect[DIRECTION_SHADOW_MAX_COUNT];
 };
 
-#define POINT_LIGHT_MAX_COUNT 1000
-uniform int point_light_count;
-uniform PLight point_light_list[POINT_LIGHT_MAX_COUNT];
-
-#define DIRECTION_LIGHT_MAX_COUNT 100
-uniform int direction_light_count;
-uniform DLight direction_light_list[DIRECTION_LIGHT_MAX_COUNT];
-
-uniform PLightShadow point_light_shadow[3];
-uniform DLightShadow direction_light_shadow[3];
-
-// viewer
-uniform vec3 cam_pos;
-uniform mat4 cam_view;
+// ShadowAtlas, point light shadow_idx is page << 8 | layer
+#define POINT_SHADOW_PAGE_COUNT 4
+uniform samplerCubeArray point_shadow_pages[POINT_SHADOW_PAGE_COUNT];
+uniform sampler2D direction_shadow_atlas;
+
+// per view, ViewUniforms in render.h
+layout(std140) uniform ViewUniforms {
+  mat4 view;
+  mat4 projection;
+  mat4 last_vp;
+  vec3 cam_pos;
+  vec2 jitter;
+};
 
 //IBL
 uniform samplerCube irradiance_map;
@@ -68,20 +69,20 @@ uniform sampler2D gAlbedoRoughness;
 uniform sampler2D gNormalMetalic;
 uniform sampler2D gSSAO;
 
-// switch
-uniform int enable_ssao;
-uniform int enable_shadow;
-uniform int enable_ibl;
-
-// cluster
-uniform uint screen_width;
-uniform uint screen_height;
-uniform uint tile_size;
-uniform float z_near;
-uniform float z_far;
-uniform uint z_slices;
-uniform uint tile_x;
-uniform uint tile_y;
+// per frame, FrameUniforms in render.h
+layout(std140) uniform FrameUniforms {
+  uint screen_width;
+  uint screen_height;
+  uint tile_size;
+  uint z_slices;
+  uint tile_x;
+  uint tile_y;
+  float z_near;
+  float z_far;
+  int enable_ssao;
+  int enable_shadow;
+  int enable_ibl;
+};
 
 in vec2 TexCoords;
 out vec4 FragColor;
@@ -96,6 +97,7 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness);
 // shadow
 float CalcDirShadow(DLight light, vec3 pos, vec3 normal);
 float CalcPointShadow(PLight light, vec3 world_pos);
+float SamplePointShadow(int page, vec4 coord);
 
 void main() {
   vec4 pos_ao = texture(gPosAO, TexCoords);
@@ -122,7 +124,7 @@ void main() {
 
   vec3 sum_color = vec3(0.0);
 
-  vec3 view_pos = (cam_view * vec4(WorldPos, 1.0)).xyz;
+  vec3 view_pos = (view * vec4(WorldPos, 1.0)).xyz;
 
   vec2 screen_pos = TexCoords * vec2(screen_width, screen_height);
   uvec2 cluster_xy = uvec2(screen_pos / float(tile_size));
@@ -270,18 +272,26 @@ float CalcDirShadow(DLight light, vec3 pos, vec3 normal)
 {
   float shadow_ratio = 0.0f;
   if (light.shadow_idx >= 0) {
-    vec4 shadow_tex = direction_light_shadow[light.shadow_idx].shadow_vp * vec4(pos, 1.0f);
+    vec4 shadow_tex = direction_shadow_vp[light.shadow_idx] * vec4(pos, 1.0f);
     vec3 projCoords = shadow_tex.xyz / shadow_tex.w;
     projCoords = projCoords * 0.5 + 0.5;
+    // outside the tile is another light's shadow
+    if (any(lessThan(projCoords.xy, vec2(0.0))) || any(greaterThan(projCoords.xy, vec2(1.0)))) {
+      return 0.0;
+    }
 
-    vec2 texelSize = 1.0 / textureSize(direction_light_shadow[light.shadow_idx].shadow_map, 0);
+    vec4 rect = direction_shadow_rect[light.shadow_idx];
+    vec2 texelSize = 1.0 / textureSize(direction_shadow_atlas, 0);
+    vec2 uv = rect.xy + projCoords.xy * rect.zw;
+    vec2 uv_min = rect.xy + 0.5 * texelSize;
+    vec2 uv_max = rect.xy + rect.zw - 0.5 * texelSize;
     float bias = max(0.05 * (1.0 - pow(dot(normal, normalize(-light.direction)), 2.0)), 0.005);
     
     for(int x = -1; x <= 1; ++x)
     {
         for(int y = -1; y <= 1; ++y)
         {
-            float pcfDepth = texture(direction_light_shadow[light.shadow_idx].shadow_map, projCoords.xy + vec2(x, y) * texelSize).r; 
+            float pcfDepth = texture(direction_shadow_atlas, clamp(uv + vec2(x, y) * texelSize, uv_min, uv_max)).r; 
             shadow_ratio += projCoords.z - bias > pcfDepth ? 1.0 : 0.0;        
         }    
     }
@@ -313,10 +323,12 @@ float CalcPointShadow(PLight light, vec3 world_pos)
 
     float viewDistance = length(cam_pos - world_pos);
     float diskRadius = (1.0 + (viewDistance / 50.0f)) / 25.0;
+    int page = light.shadow_idx >> 8;
+    float layer = float(light.shadow_idx & 255);
 
     for(int i = 0; i < samples; ++i)
     {
-        float closestDepth = texture(point_light_shadow[light.shadow_idx].shadow_map, fragToLight + sampleOffsetDirections[i] * diskRadius).r;
+        float closestDepth = SamplePointShadow(page, vec4(fragToLight + sampleOffsetDirections[i] * diskRadius, layer));
         closestDepth *= 50.0f;   // undo mapping [0;1]
         if(currentDepth - bias > closestDepth)
             shadow_ratio += 1.0;
@@ -326,3 +338,18 @@ float CalcPointShadow(PLight light, vec3 world_pos)
 
   return shadow_ratio;
 }
+
+// samplers are indexed with constants only, the page differs per pixel
+float SamplePointShadow(int page, vec4 coord)
+{
+  if (page == 0) {
+    return texture(point_shadow_pages[0], coord).r;
+  }
+  else if (page == 1) {
+    return texture(point_shadow_pages[1], coord).r;
+  }
+  else if (page == 2) {
+    return texture(point_shadow_pages[2], coord).r;
+  }
+  return texture(point_shadow_pages[3], coord).r;
+}
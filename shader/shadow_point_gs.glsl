@@ -5,6 +5,8 @@ layout (triangle_strip, max_vertices=18) out;
 uniform mat4 shadowMatrices[6];
 uniform vec3 lightPos;
 uniform float radius;
+// cube of the ShadowAtlas page attached as a layered target
+uniform int cube_layer;
 
 out vec4 FragPos; // FragPos from GS (output per emitvertex)
 
@@ -18,7 +20,7 @@ void main()
   }
   for(int face = 0; face < 6; ++face)
   {
-    gl_Layer = face; // built-in variable that specifies to which face we render.
+    gl_Layer = cube_layer * 6 + face; // built-in variable that specifies to which face we render.
     for(int i = 0; i < 3; ++i) // for each triangle's vertices
     {
       FragPos = gl_in[i].gl_Position;
@@ -1,9 +1,26 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
+// per instance, written by cull_cs.glsl
+layout (location = 5) in uint aObject;
 
-uniform mat4 model;
+// GpuObject in gpu_draw_list.h
+struct Object {
+  mat4 model;
+  mat4 last_model;
+  vec4 bounds_min;
+  vec4 bounds_max;
+  uint batch;
+  uint pad0;
+  uint pad1;
+  uint pad2;
+};
+
+layout(std430, binding = 6) readonly buffer ObjectList
+{
+  Object objects[];
+};
 
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
+    gl_Position = objects[aObject].model * vec4(aPos, 1.0);
 }
\ No newline at end of file
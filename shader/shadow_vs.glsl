@@ -1,10 +1,28 @@
-#version 420 core
+#version 430 core
 
 layout (location = 0) in vec3 aPosition;
+// per instance, written by cull_cs.glsl
+layout (location = 5) in uint aObject;
+
+// GpuObject in gpu_draw_list.h
+struct Object {
+  mat4 model;
+  mat4 last_model;
+  vec4 bounds_min;
+  vec4 bounds_max;
+  uint batch;
+  uint pad0;
+  uint pad1;
+  uint pad2;
+};
+
+layout(std430, binding = 6) readonly buffer ObjectList
+{
+  Object objects[];
+};
 
-uniform mat4 model;
 uniform mat4 shadow_vp;
 
 void main() {
-  gl_Position = shadow_vp * model * vec4(aPosition, 1.0);
+  gl_Position = shadow_vp * objects[aObject].model * vec4(aPosition, 1.0);
 }
@@ -2,8 +2,14 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 view;
-uniform mat4 projection;
+// per view, ViewUniforms in render.h
+layout(std140) uniform ViewUniforms {
+  mat4 view;
+  mat4 projection;
+  mat4 last_vp;
+  vec3 cam_pos;
+  vec2 jitter;
+};
 
 out vec3 TexCoords;
 
@@ -10,8 +10,14 @@ uniform vec3 samples[kernelSize];
 uniform sampler2D texture_noise;
 const vec2 noiseScale = vec2(1920.0/4.0, 1080.0/4.0);
 
-uniform mat4 projection;
-uniform vec2 jitter;
+// per view, ViewUniforms in render.h
+layout(std140) uniform ViewUniforms {
+  mat4 view;
+  mat4 projection;
+  mat4 last_vp;
+  vec3 cam_pos;
+  vec2 jitter;
+};
 
 in vec2 TexCoords;
 out float ao_result;
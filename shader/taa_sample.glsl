@@ -4,8 +4,20 @@ uniform sampler2D last_frame;
 uniform sampler2D jitter_frame;
 uniform sampler2D velocity;
 
-uniform uint screen_width;
-uniform uint screen_height;
+// per frame, FrameUniforms in render.h
+layout(std140) uniform FrameUniforms {
+  uint screen_width;
+  uint screen_height;
+  uint tile_size;
+  uint z_slices;
+  uint tile_x;
+  uint tile_y;
+  float z_near;
+  float z_far;
+  int enable_ssao;
+  int enable_shadow;
+  int enable_ibl;
+};
 
 uniform float blend_ratio;
 
@@ -0,0 +1,130 @@
+#include "headless_context.h"
+
+#include <iostream>
+
+#ifdef ENGINE_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace core {
+
+#ifdef ENGINE_HAS_EGL
+
+static EGLDisplay GetHeadlessDisplay() {
+  auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+    eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display) {
+    auto display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display != EGL_NO_DISPLAY) {
+      return display;
+    }
+
+    auto query_devices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+    EGLDeviceEXT device;
+    EGLint device_count = 0;
+    if (query_devices && query_devices(1, &device, &device_count) && device_count > 0) {
+      display = get_platform_display(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+      if (display != EGL_NO_DISPLAY) {
+        return display;
+      }
+    }
+  }
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+HeadlessContext::~HeadlessContext() {
+  Shutdown();
+}
+
+bool HeadlessContext::IsSupported() {
+  return true;
+}
+
+bool HeadlessContext::Init(int major, int minor) {
+  auto display = GetHeadlessDisplay();
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    std::cerr << "egl: no display" << std::endl;
+    return false;
+  }
+  _display = display;
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    std::cerr << "egl: desktop gl not supported" << std::endl;
+    Shutdown();
+    return false;
+  }
+
+  // no surface is ever created, any gl capable config will do
+  const EGLint config_attribs[] = {
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_NONE
+  };
+  EGLConfig config = nullptr;
+  EGLint config_count = 0;
+  if (!eglChooseConfig(display, config_attribs, &config, 1, &config_count) || config_count == 0) {
+    // EGL_KHR_no_config_context
+    config = nullptr;
+  }
+
+  const EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, major,
+    EGL_CONTEXT_MINOR_VERSION, minor,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  auto context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+  if (context == EGL_NO_CONTEXT) {
+    std::cerr << "egl: fail to create gl " << major << "." << minor << " context" << std::endl;
+    Shutdown();
+    return false;
+  }
+  _context = context;
+
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    std::cerr << "egl: surfaceless context not supported" << std::endl;
+    Shutdown();
+    return false;
+  }
+
+  return true;
+}
+
+void HeadlessContext::Shutdown() {
+  if (!_display) {
+    return;
+  }
+
+  eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (_context) {
+    eglDestroyContext(_display, _context);
+    _context = nullptr;
+  }
+  eglTerminate(_display);
+  _display = nullptr;
+}
+
+void* HeadlessContext::GetProcAddress(const char* name) {
+  return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+
+#else
+
+HeadlessContext::~HeadlessContext() {}
+
+bool HeadlessContext::IsSupported() {
+  return false;
+}
+
+bool HeadlessContext::Init(int /*major*/, int /*minor*/) {
+  return false;
+}
+
+void HeadlessContext::Shutdown() {}
+
+void* HeadlessContext::GetProcAddress(const char* /*name*/) {
+  return nullptr;
+}
+
+#endif
+} // namespace core
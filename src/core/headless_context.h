@@ -0,0 +1,30 @@
+#pragma once
+
+namespace core {
+
+// Surfaceless EGL context for rendering without a display. Prefers Mesa's
+// surfaceless platform (works with llvmpipe), then an EGL device, then the
+// default display. Everything renders into FBOs, there is no default
+// framebuffer. Only available when built with ENGINE_HAS_EGL.
+class HeadlessContext {
+public:
+  HeadlessContext() = default;
+  ~HeadlessContext();
+
+  HeadlessContext(const HeadlessContext&) = delete;
+  HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+  static bool IsSupported();
+
+  // creates a core profile context and makes it current
+  bool Init(int major, int minor);
+  void Shutdown();
+
+  // loader for gladLoadGLLoader
+  static void* GetProcAddress(const char* name);
+
+private:
+  void* _display = nullptr;
+  void* _context = nullptr;
+};
+} // namespace core
@@ -0,0 +1,298 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <string>
+
+#include "profiler.h"
+
+namespace core {
+
+static thread_local JobSystem* t_owner = nullptr;
+static thread_local int t_slot = -1;
+
+JobSystem::JobSystem() : _quit(false), _queued(0) {}
+
+JobSystem::~JobSystem() {
+  Shutdown();
+}
+
+void JobSystem::Init(uint32_t worker_count) {
+  if (IsRunning()) {
+    return;
+  }
+
+  if (!worker_count) {
+    auto hw_count = std::thread::hardware_concurrency();
+    worker_count = hw_count > 1 ? hw_count - 1 : 1;
+  }
+
+  _quit = false;
+  _queued = 0;
+  for (uint32_t i = 0; i <= worker_count; i++) {
+    _queues.emplace_back(new WorkQueue());
+  }
+
+  t_owner = this;
+  t_slot = 0;
+  for (uint32_t i = 0; i < worker_count; i++) {
+    _workers.emplace_back(&JobSystem::WorkerLoop, this, static_cast<int>(i + 1));
+  }
+}
+
+void JobSystem::Shutdown() {
+  if (!IsRunning()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(_sleep_lock);
+    _quit = true;
+  }
+  _sleep_cv.notify_all();
+
+  for (auto& worker : _workers) {
+    worker.join();
+  }
+  _workers.clear();
+  _queues.clear();
+
+  if (t_owner == this) {
+    t_owner = nullptr;
+    t_slot = -1;
+  }
+}
+
+int JobSystem::GetThreadIndex() const {
+  return t_owner == this ? t_slot : -1;
+}
+
+JobHandle JobSystem::Create(JobFunc func, Job* parent) {
+  auto job = std::make_shared<Job>();
+  job->func = std::move(func);
+  if (parent) {
+    parent->unfinished++;
+  }
+  return job;
+}
+
+void JobSystem::Submit(const JobHandle& job, const JobHandle* deps, size_t dep_count) {
+  for (size_t i = 0; i < dep_count; i++) {
+    auto& dep = deps[i];
+    if (!dep) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> guard(dep->lock);
+    if (!dep->done) {
+      job->pending_deps++;
+      dep->continuations.push_back(job);
+    }
+  }
+
+  if (--job->pending_deps == 0) {
+    Push(job);
+  }
+}
+
+JobHandle JobSystem::Schedule(JobFunc func, std::initializer_list<JobHandle> deps) {
+  auto job = Create(std::move(func), nullptr);
+  Submit(job, deps.begin(), deps.size());
+  return job;
+}
+
+JobHandle JobSystem::Schedule(JobFunc func, const std::vector<JobHandle>& deps) {
+  auto job = Create(std::move(func), nullptr);
+  Submit(job, deps.data(), deps.size());
+  return job;
+}
+
+JobHandle JobSystem::ScheduleChild(const JobHandle& parent, JobFunc func) {
+  auto job = Create(std::move(func), parent.get());
+  job->parent = parent;
+  Submit(job, nullptr, 0);
+  return job;
+}
+
+size_t JobSystem::ChunkSize(size_t count, size_t chunk) const {
+  if (chunk) {
+    return chunk;
+  }
+  // a few chunks per thread so stealing can even out uneven items
+  size_t threads = GetWorkerCount() + 1;
+  return std::max<size_t>(1, count / (threads * 4));
+}
+
+JobHandle JobSystem::ScheduleParallelFor(size_t count, size_t chunk, RangeFunc func,
+  const std::vector<JobHandle>& deps) {
+  chunk = ChunkSize(count, chunk);
+  auto shared_func = std::make_shared<RangeFunc>(std::move(func));
+
+  auto root = Create(nullptr, nullptr);
+  std::weak_ptr<Job> weak_root = root;
+  root->func = [this, weak_root, shared_func, count, chunk]() {
+    auto self = weak_root.lock();
+    for (size_t begin = 0; begin < count; begin += chunk) {
+      size_t end = std::min(count, begin + chunk);
+      ScheduleChild(self, [shared_func, begin, end]() {
+        (*shared_func)(begin, end);
+      });
+    }
+  };
+
+  Submit(root, deps.data(), deps.size());
+  return root;
+}
+
+void JobSystem::ParallelFor(size_t count, size_t chunk, RangeFunc func) {
+  if (!count) {
+    return;
+  }
+
+  chunk = ChunkSize(count, chunk);
+  if (!IsRunning() || count <= chunk) {
+    func(0, count);
+    return;
+  }
+
+  // group job that is never queued, it finishes with its last chunk
+  auto group = Create(nullptr, nullptr);
+  for (size_t begin = 0; begin < count; begin += chunk) {
+    size_t end = std::min(count, begin + chunk);
+    ScheduleChild(group, [&func, begin, end]() {
+      func(begin, end);
+    });
+  }
+  Finish(group.get());
+  Wait(group);
+}
+
+void JobSystem::Push(JobHandle job) {
+  if (!IsRunning()) {
+    Execute(std::move(job));
+    return;
+  }
+
+  int slot = GetThreadIndex();
+  auto& queue = *_queues[slot < 0 ? 0 : slot];
+  {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.jobs.push_back(std::move(job));
+  }
+  _queued++;
+
+  {
+    std::lock_guard<std::mutex> guard(_sleep_lock);
+  }
+  _sleep_cv.notify_one();
+}
+
+JobHandle JobSystem::Pop(int slot) {
+  auto& queue = *_queues[slot];
+  std::lock_guard<std::mutex> guard(queue.lock);
+  if (queue.jobs.empty()) {
+    return nullptr;
+  }
+  auto job = std::move(queue.jobs.back());
+  queue.jobs.pop_back();
+  return job;
+}
+
+JobHandle JobSystem::Steal(int slot) {
+  size_t count = _queues.size();
+  for (size_t i = 1; i < count; i++) {
+    auto& queue = *_queues[(slot + i) % count];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (!queue.jobs.empty()) {
+      auto job = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+bool JobSystem::RunOne(int slot) {
+  auto job = Pop(slot);
+  if (!job) {
+    job = Steal(slot);
+  }
+  if (!job) {
+    return false;
+  }
+
+  _queued--;
+  Execute(std::move(job));
+  return true;
+}
+
+void JobSystem::Execute(JobHandle job) {
+  if (job->func) {
+    PROFILE_SCOPE("Job");
+    job->func();
+  }
+  Finish(job.get());
+}
+
+void JobSystem::Finish(Job* job) {
+  if (--job->unfinished != 0) {
+    return;
+  }
+
+  std::vector<JobHandle> continuations;
+  {
+    std::lock_guard<std::mutex> guard(job->lock);
+    job->done = true;
+    continuations.swap(job->continuations);
+  }
+
+  for (auto& cont : continuations) {
+    if (--cont->pending_deps == 0) {
+      Push(cont);
+    }
+  }
+
+  // release the parent reference last, it may be the only one left
+  auto parent = std::move(job->parent);
+  if (parent) {
+    Finish(parent.get());
+  }
+}
+
+bool JobSystem::IsDone(const JobHandle& job) {
+  if (!job) {
+    return true;
+  }
+  std::lock_guard<std::mutex> guard(job->lock);
+  return job->done;
+}
+
+void JobSystem::Wait(const JobHandle& job) {
+  int slot = GetThreadIndex();
+  while (!IsDone(job)) {
+    if (slot < 0 || !RunOne(slot)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::WaitAll(const std::vector<JobHandle>& jobs) {
+  for (auto& job : jobs) {
+    Wait(job);
+  }
+}
+
+void JobSystem::WorkerLoop(int slot) {
+  t_owner = this;
+  t_slot = slot;
+  PROFILE_THREAD(("worker " + std::to_string(slot)).c_str());
+
+  while (!_quit) {
+    if (RunOne(slot)) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> guard(_sleep_lock);
+    _sleep_cv.wait(guard, [this]() { return _quit || _queued > 0; });
+  }
+}
+} // namespace core
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+typedef std::function<void()> JobFunc;
+typedef std::function<void(size_t begin, size_t end)> RangeFunc;
+
+struct Job;
+typedef std::shared_ptr<Job> JobHandle;
+
+struct Job {
+  JobFunc func;
+  JobHandle parent;
+
+  // dependencies that must finish before the job is queued (+1 while scheduling)
+  std::atomic<int32_t> pending_deps{ 1 };
+  // the job itself plus children spawned with it as parent
+  std::atomic<int32_t> unfinished{ 1 };
+
+  std::mutex lock;
+  bool done = false;
+  std::vector<JobHandle> continuations;
+};
+
+// Work-stealing scheduler. Each worker owns a deque, pops its own work from
+// the back and steals from the front of the others. Slot 0 belongs to the
+// thread that called Init (the main thread), which only runs jobs while it
+// is blocked in Wait.
+class JobSystem {
+public:
+  JobSystem();
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  // worker_count == 0 picks hardware_concurrency - 1
+  void Init(uint32_t worker_count = 0);
+  void Shutdown();
+
+  bool IsRunning() const { return !_workers.empty(); }
+  uint32_t GetWorkerCount() const { return static_cast<uint32_t>(_workers.size()); }
+  // slot of the calling thread, -1 for threads not owned by the scheduler
+  int GetThreadIndex() const;
+
+  JobHandle Schedule(JobFunc func, std::initializer_list<JobHandle> deps = {});
+  JobHandle Schedule(JobFunc func, const std::vector<JobHandle>& deps);
+  // spawn a child, `parent` is not done until all its children are
+  JobHandle ScheduleChild(const JobHandle& parent, JobFunc func);
+
+  // splits [0, count) into chunks of `chunk` items (0 picks one)
+  JobHandle ScheduleParallelFor(size_t count, size_t chunk, RangeFunc func,
+    const std::vector<JobHandle>& deps = {});
+  void ParallelFor(size_t count, size_t chunk, RangeFunc func);
+
+  // runs other jobs while waiting
+  void Wait(const JobHandle& job);
+  void WaitAll(const std::vector<JobHandle>& jobs);
+
+  static bool IsDone(const JobHandle& job);
+
+private:
+  struct WorkQueue {
+    std::mutex lock;
+    std::deque<JobHandle> jobs;
+  };
+
+  JobHandle Create(JobFunc func, Job* parent);
+  void Submit(const JobHandle& job, const JobHandle* deps, size_t dep_count);
+  void Push(JobHandle job);
+  JobHandle Pop(int slot);
+  JobHandle Steal(int slot);
+  bool RunOne(int slot);
+  void Execute(JobHandle job);
+  void Finish(Job* job);
+  void WorkerLoop(int slot);
+
+  size_t ChunkSize(size_t count, size_t chunk) const;
+
+private:
+  std::vector<std::thread> _workers;
+  std::vector<std::unique_ptr<WorkQueue>> _queues;
+
+  std::atomic<bool> _quit;
+  std::atomic<int32_t> _queued;
+  std::mutex _sleep_lock;
+  std::condition_variable _sleep_cv;
+};
+} // namespace core
@@ -0,0 +1,128 @@
+#include "mapped_file.h"
+
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace core {
+
+MappedFile::MappedFile()
+  : _data(nullptr)
+  , _size(0)
+#ifdef _WIN32
+  , _file(INVALID_HANDLE_VALUE)
+  , _mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const char* path) {
+  Close();
+
+  _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (_file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(_file, &size) || !size.QuadPart) {
+    Close();
+    return false;
+  }
+
+  _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!_mapping) {
+    Close();
+    return false;
+  }
+
+  _data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!_data) {
+    Close();
+    return false;
+  }
+  _size = static_cast<size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (_data) {
+    UnmapViewOfFile(_data);
+  }
+  if (_mapping) {
+    CloseHandle(_mapping);
+  }
+  if (_file != INVALID_HANDLE_VALUE) {
+    CloseHandle(_file);
+  }
+  _data = nullptr;
+  _size = 0;
+  _mapping = nullptr;
+  _file = INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::Open(const char* path) {
+  Close();
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+
+  // the mapping keeps the file alive on its own
+  auto data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  _data = static_cast<const uint8_t*>(data);
+  _size = static_cast<size_t>(info.st_size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (_data) {
+    munmap(const_cast<uint8_t*>(_data), _size);
+  }
+  _data = nullptr;
+  _size = 0;
+}
+#endif
+
+bool GetFileStamp(const char* path, uint64_t& size, int64_t& mtime) {
+  std::error_code err;
+  auto file_size = std::filesystem::file_size(path, err);
+  if (err) {
+    return false;
+  }
+  auto write_time = std::filesystem::last_write_time(path, err);
+  if (err) {
+    return false;
+  }
+
+  size = file_size;
+  mtime = static_cast<int64_t>(write_time.time_since_epoch().count());
+  return true;
+}
+
+} // namespace core
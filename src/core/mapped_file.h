@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace core {
+
+// Read only mapping of a whole file, pages are loaded by the OS on first
+// touch. Unmapped on Close or destruction.
+class MappedFile {
+public:
+  MappedFile();
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const char* path);
+  void Close();
+
+  bool IsOpen() const { return _data != nullptr; }
+  const uint8_t* GetData() const { return _data; }
+  size_t GetSize() const { return _size; }
+
+private:
+  const uint8_t* _data;
+  size_t _size;
+#ifdef _WIN32
+  void* _file;
+  void* _mapping;
+#endif
+};
+
+// size and last write time, false when the file is missing
+bool GetFileStamp(const char* path, uint64_t& size, int64_t& mtime);
+
+} // namespace core
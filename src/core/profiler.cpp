@@ -0,0 +1,117 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace core {
+
+static thread_local ProfileBuffer* t_buffer = nullptr;
+
+ProfileBuffer::ProfileBuffer(uint32_t thread_id)
+  : _slots(new Slot[Capacity])
+  , _head(0)
+  , _thread_id(thread_id)
+  , _thread_name("thread " + std::to_string(thread_id)) {
+}
+
+void ProfileBuffer::Push(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+  auto head = _head.load(std::memory_order_relaxed);
+  auto& slot = _slots[head % Capacity];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+  slot.end_ns.store(end_ns, std::memory_order_relaxed);
+  _head.store(head + 1, std::memory_order_release);
+}
+
+void ProfileBuffer::Copy(std::vector<ProfileEvent>& res) const {
+  auto head = _head.load(std::memory_order_acquire);
+  auto first = head > Capacity ? head - Capacity : 0;
+
+  size_t offset = res.size();
+  for (auto i = first; i < head; i++) {
+    auto& slot = _slots[i % Capacity];
+    res.push_back({ slot.name.load(std::memory_order_relaxed),
+      slot.begin_ns.load(std::memory_order_relaxed),
+      slot.end_ns.load(std::memory_order_relaxed) });
+  }
+
+  // slots the owner wrapped onto while copying may be torn, including the
+  // one it may be writing right now
+  std::atomic_thread_fence(std::memory_order_acquire);
+  auto new_head = _head.load(std::memory_order_relaxed) + 1;
+  if (new_head > first + Capacity) {
+    auto torn = std::min<uint64_t>(new_head - first - Capacity, head - first);
+    res.erase(res.begin() + offset, res.begin() + offset + torn);
+  }
+}
+
+void ProfileBuffer::SetThreadName(const char* name) {
+  std::lock_guard<std::mutex> guard(_name_lock);
+  _thread_name = name;
+}
+
+std::string ProfileBuffer::GetThreadName() const {
+  std::lock_guard<std::mutex> guard(_name_lock);
+  return _thread_name;
+}
+
+Profiler::Profiler()
+  : _start(std::chrono::steady_clock::now())
+  , _enabled(true) {
+}
+
+uint64_t Profiler::Now() const {
+  auto elapsed = std::chrono::steady_clock::now() - _start;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+ProfileBuffer& Profiler::GetThreadBuffer() {
+  if (!t_buffer) {
+    // once per thread, buffers stay alive after their thread exits
+    std::lock_guard<std::mutex> guard(_buffers_lock);
+    _buffers.emplace_back(new ProfileBuffer(static_cast<uint32_t>(_buffers.size())));
+    t_buffer = _buffers.back().get();
+  }
+  return *t_buffer;
+}
+
+void Profiler::Record(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+  GetThreadBuffer().Push(name, begin_ns, end_ns);
+}
+
+void Profiler::SetThreadName(const char* name) {
+  GetThreadBuffer().SetThreadName(name);
+}
+
+bool Profiler::ExportChromeTrace(const char* path) const {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"engine\"}}");
+
+  std::vector<ProfileEvent> events;
+  std::lock_guard<std::mutex> guard(_buffers_lock);
+  for (auto& buffer : _buffers) {
+    auto tid = buffer->GetThreadId();
+    fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+      tid, buffer->GetThreadName().c_str());
+    fprintf(file, ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"sort_index\": %u}}",
+      tid, tid);
+
+    events.clear();
+    buffer->Copy(events);
+    // complete events, ts and dur in us
+    for (auto& event : events) {
+      fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+        event.name, tid, event.begin_ns / 1000.0, (event.end_ns - event.begin_ns) / 1000.0);
+    }
+  }
+  fprintf(file, "\n]}\n");
+
+  fclose(file);
+  return true;
+}
+} // namespace core
@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace core {
+
+// One finished scope. `name` must outlive the profiler, string literals.
+struct ProfileEvent {
+  const char* name;
+  uint64_t begin_ns;
+  uint64_t end_ns;
+};
+
+// Written only by its owner thread, so recording takes no lock. The writer
+// publishes the slot count with a release store, readers copy the slots and
+// drop whatever may have been overwritten meanwhile. Slot fields are relaxed
+// atomics, plain moves on x86, so a torn slot is dropped rather than a race.
+class ProfileBuffer {
+public:
+  static constexpr size_t Capacity = 1 << 14;
+
+  explicit ProfileBuffer(uint32_t thread_id);
+
+  void Push(const char* name, uint64_t begin_ns, uint64_t end_ns);
+  // oldest first, at most Capacity events
+  void Copy(std::vector<ProfileEvent>& res) const;
+
+  uint32_t GetThreadId() const { return _thread_id; }
+
+  void SetThreadName(const char* name);
+  std::string GetThreadName() const;
+
+private:
+  struct Slot {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> begin_ns;
+    std::atomic<uint64_t> end_ns;
+  };
+
+  std::unique_ptr<Slot[]> _slots;
+  std::atomic<uint64_t> _head;
+  uint32_t _thread_id;
+
+  mutable std::mutex _name_lock;
+  std::string _thread_name;
+};
+
+// Scoped CPU timings of every thread, exported as a Chrome trace (also read
+// by Perfetto). Each thread records into its own ring buffer, registered the
+// first time it records, so only the last ProfileBuffer::Capacity scopes of
+// a thread are kept.
+class Profiler {
+public:
+  static Profiler& GetInstance() {
+    static Profiler inst;
+    return inst;
+  }
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  bool IsEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+  void SetEnabled(bool enable) { _enabled.store(enable, std::memory_order_relaxed); }
+
+  // ns since the profiler was created
+  uint64_t Now() const;
+  void Record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+  // shown as the track name in the trace viewer
+  void SetThreadName(const char* name);
+
+  // json for chrome://tracing or ui.perfetto.dev, safe while recording
+  bool ExportChromeTrace(const char* path) const;
+
+private:
+  Profiler();
+
+  ProfileBuffer& GetThreadBuffer();
+
+private:
+  std::chrono::steady_clock::time_point _start;
+  std::atomic<bool> _enabled;
+
+  mutable std::mutex _buffers_lock;
+  std::vector<std::unique_ptr<ProfileBuffer>> _buffers;
+};
+
+class ProfileScope {
+public:
+  explicit ProfileScope(const char* name)
+    : _name(Profiler::GetInstance().IsEnabled() ? name : nullptr)
+    , _begin(_name ? Profiler::GetInstance().Now() : 0)
+  {
+  }
+
+  ~ProfileScope() {
+    if (_name) {
+      auto& profiler = Profiler::GetInstance();
+      profiler.Record(_name, _begin, profiler.Now());
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+  const char* _name;
+  uint64_t _begin;
+};
+} // namespace core
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENGINE_PROFILER
+// times the enclosing scope, `name` must be a string literal
+#define PROFILE_SCOPE(name) ::core::ProfileScope PROFILE_CONCAT(_profile_scope_, __LINE__)(name)
+#define PROFILE_THREAD(name) ::core::Profiler::GetInstance().SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
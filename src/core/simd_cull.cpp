@@ -0,0 +1,126 @@
+#include "simd_cull.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CORE_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// msvc accepts avx intrinsics anywhere, gcc/clang need them enabled per function
+#if defined(CORE_SIMD_X86) && !defined(_MSC_VER)
+#define CORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CORE_TARGET_AVX2
+#endif
+
+namespace core {
+
+// distance to the box per axis is max(min - c, c - max, 0), every level
+// does the same operations so they agree bit for bit
+static size_t CullScalar(const SphereArrays& in, const float* mn, const float* mx, uint32_t* out,
+  size_t begin, size_t end) {
+  size_t res = 0;
+  for (size_t i = begin; i < end; i++) {
+    float dx = std::max(std::max(mn[0] - in.x[i], in.x[i] - mx[0]), 0.0f);
+    float dy = std::max(std::max(mn[1] - in.y[i], in.y[i] - mx[1]), 0.0f);
+    float dz = std::max(std::max(mn[2] - in.z[i], in.z[i] - mx[2]), 0.0f);
+    float dist = dx * dx + dy * dy + dz * dz;
+    if (dist <= in.radius[i] * in.radius[i]) {
+      out[res++] = static_cast<uint32_t>(i);
+    }
+  }
+  return res;
+}
+
+#ifdef CORE_SIMD_X86
+// appends the lanes set in `mask`, lowest first
+static inline size_t WriteMask(unsigned int mask, size_t base, uint32_t* out) {
+  size_t res = 0;
+  while (mask) {
+#ifdef _MSC_VER
+    unsigned long lane;
+    _BitScanForward(&lane, mask);
+#else
+    unsigned int lane = __builtin_ctz(mask);
+#endif
+    out[res++] = static_cast<uint32_t>(base + lane);
+    mask &= mask - 1;
+  }
+  return res;
+}
+
+static size_t CullSSE(const SphereArrays& in, const float* mn, const float* mx, uint32_t* out,
+  size_t begin, size_t end) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 min_x = _mm_set1_ps(mn[0]), min_y = _mm_set1_ps(mn[1]), min_z = _mm_set1_ps(mn[2]);
+  const __m128 max_x = _mm_set1_ps(mx[0]), max_y = _mm_set1_ps(mx[1]), max_z = _mm_set1_ps(mx[2]);
+
+  size_t res = 0;
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    __m128 x = _mm_loadu_ps(in.x + i);
+    __m128 y = _mm_loadu_ps(in.y + i);
+    __m128 z = _mm_loadu_ps(in.z + i);
+    __m128 r = _mm_loadu_ps(in.radius + i);
+
+    __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_x, x), _mm_sub_ps(x, max_x)), zero);
+    __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_y, y), _mm_sub_ps(y, max_y)), zero);
+    __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_z, z), _mm_sub_ps(z, max_z)), zero);
+    __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    unsigned int mask = _mm_movemask_ps(_mm_cmple_ps(dist, _mm_mul_ps(r, r)));
+    res += WriteMask(mask, i, out + res);
+  }
+
+  return res + CullScalar(in, mn, mx, out + res, i, end);
+}
+
+CORE_TARGET_AVX2 static size_t CullAVX2(const SphereArrays& in, const float* mn, const float* mx, uint32_t* out,
+  size_t begin, size_t end) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 min_x = _mm256_set1_ps(mn[0]), min_y = _mm256_set1_ps(mn[1]), min_z = _mm256_set1_ps(mn[2]);
+  const __m256 max_x = _mm256_set1_ps(mx[0]), max_y = _mm256_set1_ps(mx[1]), max_z = _mm256_set1_ps(mx[2]);
+
+  size_t res = 0;
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 x = _mm256_loadu_ps(in.x + i);
+    __m256 y = _mm256_loadu_ps(in.y + i);
+    __m256 z = _mm256_loadu_ps(in.z + i);
+    __m256 r = _mm256_loadu_ps(in.radius + i);
+
+    __m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(min_x, x), _mm256_sub_ps(x, max_x)), zero);
+    __m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(min_y, y), _mm256_sub_ps(y, max_y)), zero);
+    __m256 dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(min_z, z), _mm256_sub_ps(z, max_z)), zero);
+    __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+    unsigned int mask = _mm256_movemask_ps(_mm256_cmp_ps(dist, _mm256_mul_ps(r, r), _CMP_LE_OQ));
+    res += WriteMask(mask, i, out + res);
+  }
+
+  return res + CullSSE(in, mn, mx, out + res, i, end);
+}
+#endif
+
+size_t CullSpheresAABB(const SphereArrays& spheres, size_t count,
+  const float* box_min, const float* box_max, uint32_t* out) {
+  return CullSpheresAABB(spheres, count, box_min, box_max, out, GetSimdLevel());
+}
+
+size_t CullSpheresAABB(const SphereArrays& spheres, size_t count,
+  const float* box_min, const float* box_max, uint32_t* out, SimdLevel level) {
+#ifdef CORE_SIMD_X86
+  switch (level) {
+  case SimdLevel::AVX2:
+    return CullAVX2(spheres, box_min, box_max, out, 0, count);
+  case SimdLevel::SSE:
+    return CullSSE(spheres, box_min, box_max, out, 0, count);
+  default:
+    break;
+  }
+#endif
+  return CullScalar(spheres, box_min, box_max, out, 0, count);
+}
+} // namespace core
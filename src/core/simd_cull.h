@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "simd_transform.h"
+
+namespace core {
+
+// Structure-of-arrays spheres, one entry per sphere.
+struct SphereArrays {
+  const float* x;
+  const float* y;
+  const float* z;
+  const float* radius;
+};
+
+// Writes the index of every sphere in [0, count) that touches the box
+// [box_min, box_max] to `out`, ascending, and returns how many. `out` needs
+// room for `count` indices. Infinite box sides are fine, they test only
+// the other axes.
+size_t CullSpheresAABB(const SphereArrays& spheres, size_t count,
+  const float* box_min, const float* box_max, uint32_t* out);
+size_t CullSpheresAABB(const SphereArrays& spheres, size_t count,
+  const float* box_min, const float* box_max, uint32_t* out, SimdLevel level);
+} // namespace core
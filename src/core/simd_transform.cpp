@@ -0,0 +1,317 @@
+#include "simd_transform.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CORE_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// msvc accepts avx intrinsics anywhere, gcc/clang need them enabled per function
+#if defined(CORE_SIMD_X86) && !defined(_MSC_VER)
+#define CORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CORE_TARGET_AVX2
+#endif
+
+namespace core {
+
+void TRSBuffer::Clear() {
+  for (auto& channel : _channels) {
+    channel.clear();
+  }
+}
+
+void TRSBuffer::Reserve(size_t count) {
+  for (auto& channel : _channels) {
+    channel.reserve(count);
+  }
+}
+
+void TRSBuffer::Push(const float* t, const float* q, const float* s) {
+  for (int i = 0; i < 3; i++) {
+    _channels[i].push_back(t[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    _channels[3 + i].push_back(q[i]);
+  }
+  for (int i = 0; i < 3; i++) {
+    _channels[7 + i].push_back(s[i]);
+  }
+}
+
+TRSArrays TRSBuffer::GetArrays() const {
+  TRSArrays res;
+  res.tx = _channels[0].data();
+  res.ty = _channels[1].data();
+  res.tz = _channels[2].data();
+  res.qx = _channels[3].data();
+  res.qy = _channels[4].data();
+  res.qz = _channels[5].data();
+  res.qw = _channels[6].data();
+  res.sx = _channels[7].data();
+  res.sy = _channels[8].data();
+  res.sz = _channels[9].data();
+  return res;
+}
+
+static void ComposeScalar(const TRSArrays& in, float* out, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    float x = in.qx[i], y = in.qy[i], z = in.qz[i], w = in.qw[i];
+    float xx = x * x, yy = y * y, zz = z * z;
+    float xy = x * y, xz = x * z, yz = y * z;
+    float wx = w * x, wy = w * y, wz = w * z;
+
+    float* m = out + i * 16;
+    m[0] = (1.0f - 2.0f * (yy + zz)) * in.sx[i];
+    m[1] = 2.0f * (xy + wz) * in.sx[i];
+    m[2] = 2.0f * (xz - wy) * in.sx[i];
+    m[3] = 0.0f;
+
+    m[4] = 2.0f * (xy - wz) * in.sy[i];
+    m[5] = (1.0f - 2.0f * (xx + zz)) * in.sy[i];
+    m[6] = 2.0f * (yz + wx) * in.sy[i];
+    m[7] = 0.0f;
+
+    m[8] = 2.0f * (xz + wy) * in.sz[i];
+    m[9] = 2.0f * (yz - wx) * in.sz[i];
+    m[10] = (1.0f - 2.0f * (xx + yy)) * in.sz[i];
+    m[11] = 0.0f;
+
+    m[12] = in.tx[i];
+    m[13] = in.ty[i];
+    m[14] = in.tz[i];
+    m[15] = 1.0f;
+  }
+}
+
+#ifdef CORE_SIMD_X86
+// four transforms per iteration, the matrix columns are built across lanes
+// and transposed into per transform columns on store
+static void ComposeSSE(const TRSArrays& in, float* out, size_t begin, size_t end) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 zero = _mm_setzero_ps();
+
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    __m128 x = _mm_loadu_ps(in.qx + i);
+    __m128 y = _mm_loadu_ps(in.qy + i);
+    __m128 z = _mm_loadu_ps(in.qz + i);
+    __m128 w = _mm_loadu_ps(in.qw + i);
+    __m128 sx = _mm_loadu_ps(in.sx + i);
+    __m128 sy = _mm_loadu_ps(in.sy + i);
+    __m128 sz = _mm_loadu_ps(in.sz + i);
+
+    __m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+    __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+    __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+    __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+    __m128 c0[4] = {
+      _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx),
+      _mm_mul_ps(_mm_add_ps(xy, wz), sx),
+      _mm_mul_ps(_mm_sub_ps(xz, wy), sx),
+      zero,
+    };
+    __m128 c1[4] = {
+      _mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+      _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+      _mm_mul_ps(_mm_add_ps(yz, wx), sy),
+      zero,
+    };
+    __m128 c2[4] = {
+      _mm_mul_ps(_mm_add_ps(xz, wy), sz),
+      _mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+      _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz),
+      zero,
+    };
+    __m128 c3[4] = {
+      _mm_loadu_ps(in.tx + i),
+      _mm_loadu_ps(in.ty + i),
+      _mm_loadu_ps(in.tz + i),
+      one,
+    };
+
+    _MM_TRANSPOSE4_PS(c0[0], c0[1], c0[2], c0[3]);
+    _MM_TRANSPOSE4_PS(c1[0], c1[1], c1[2], c1[3]);
+    _MM_TRANSPOSE4_PS(c2[0], c2[1], c2[2], c2[3]);
+    _MM_TRANSPOSE4_PS(c3[0], c3[1], c3[2], c3[3]);
+
+    float* m = out + i * 16;
+    for (int k = 0; k < 4; k++) {
+      _mm_storeu_ps(m + k * 16 + 0, c0[k]);
+      _mm_storeu_ps(m + k * 16 + 4, c1[k]);
+      _mm_storeu_ps(m + k * 16 + 8, c2[k]);
+      _mm_storeu_ps(m + k * 16 + 12, c3[k]);
+    }
+  }
+
+  ComposeScalar(in, out, i, end);
+}
+
+// 4x4 transpose inside each 128 bit half, the low half holds transforms
+// 0-3 and the high half transforms 4-7
+CORE_TARGET_AVX2 static inline void Transpose8x4(__m256& a, __m256& b, __m256& c, __m256& d) {
+  __m256 t0 = _mm256_unpacklo_ps(a, b);
+  __m256 t1 = _mm256_unpackhi_ps(a, b);
+  __m256 t2 = _mm256_unpacklo_ps(c, d);
+  __m256 t3 = _mm256_unpackhi_ps(c, d);
+  a = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  b = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  c = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  d = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+CORE_TARGET_AVX2 static void ComposeAVX2(const TRSArrays& in, float* out, size_t begin, size_t end) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 zero = _mm256_setzero_ps();
+
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 x = _mm256_loadu_ps(in.qx + i);
+    __m256 y = _mm256_loadu_ps(in.qy + i);
+    __m256 z = _mm256_loadu_ps(in.qz + i);
+    __m256 w = _mm256_loadu_ps(in.qw + i);
+    __m256 sx = _mm256_loadu_ps(in.sx + i);
+    __m256 sy = _mm256_loadu_ps(in.sy + i);
+    __m256 sz = _mm256_loadu_ps(in.sz + i);
+
+    __m256 x2 = _mm256_mul_ps(x, two), y2 = _mm256_mul_ps(y, two), z2 = _mm256_mul_ps(z, two);
+    __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+    __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+    __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+    __m256 c0[4] = {
+      _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+      _mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+      _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx),
+      zero,
+    };
+    __m256 c1[4] = {
+      _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+      _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+      _mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+      zero,
+    };
+    __m256 c2[4] = {
+      _mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+      _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+      _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+      zero,
+    };
+    __m256 c3[4] = {
+      _mm256_loadu_ps(in.tx + i),
+      _mm256_loadu_ps(in.ty + i),
+      _mm256_loadu_ps(in.tz + i),
+      one,
+    };
+
+    Transpose8x4(c0[0], c0[1], c0[2], c0[3]);
+    Transpose8x4(c1[0], c1[1], c1[2], c1[3]);
+    Transpose8x4(c2[0], c2[1], c2[2], c2[3]);
+    Transpose8x4(c3[0], c3[1], c3[2], c3[3]);
+
+    float* m = out + i * 16;
+    for (int k = 0; k < 4; k++) {
+      float* lo = m + k * 16;
+      float* hi = m + (k + 4) * 16;
+      _mm_storeu_ps(lo + 0, _mm256_castps256_ps128(c0[k]));
+      _mm_storeu_ps(lo + 4, _mm256_castps256_ps128(c1[k]));
+      _mm_storeu_ps(lo + 8, _mm256_castps256_ps128(c2[k]));
+      _mm_storeu_ps(lo + 12, _mm256_castps256_ps128(c3[k]));
+      _mm_storeu_ps(hi + 0, _mm256_extractf128_ps(c0[k], 1));
+      _mm_storeu_ps(hi + 4, _mm256_extractf128_ps(c1[k], 1));
+      _mm_storeu_ps(hi + 8, _mm256_extractf128_ps(c2[k], 1));
+      _mm_storeu_ps(hi + 12, _mm256_extractf128_ps(c3[k], 1));
+    }
+  }
+
+  ComposeSSE(in, out, i, end);
+}
+#endif
+
+SimdLevel DetectSimdLevel() {
+#if defined(CORE_SIMD_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  int max_leaf = info[0];
+
+  __cpuid(info, 1);
+  bool has_sse2 = (info[3] & (1 << 26)) != 0;
+  bool has_avx = (info[2] & (1 << 28)) != 0;
+  // the os saves ymm registers
+  bool has_osxsave = (info[2] & (1 << 27)) != 0;
+  bool ymm_enabled = has_osxsave && (_xgetbv(0) & 0x6) == 0x6;
+
+  bool has_avx2 = false;
+  if (max_leaf >= 7) {
+    __cpuidex(info, 7, 0);
+    has_avx2 = (info[1] & (1 << 5)) != 0;
+  }
+
+  if (has_avx && has_avx2 && ymm_enabled) {
+    return SimdLevel::AVX2;
+  }
+  return has_sse2 ? SimdLevel::SSE : SimdLevel::Scalar;
+#elif defined(CORE_SIMD_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SimdLevel::SSE;
+  }
+  return SimdLevel::Scalar;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+static SimdLevel& ActiveLevel() {
+  static SimdLevel level = DetectSimdLevel();
+  return level;
+}
+
+SimdLevel GetSimdLevel() {
+  return ActiveLevel();
+}
+
+void SetSimdLevel(SimdLevel level) {
+  auto supported = DetectSimdLevel();
+  ActiveLevel() = level > supported ? supported : level;
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::AVX2:
+    return "avx2";
+  case SimdLevel::SSE:
+    return "sse";
+  default:
+    return "scalar";
+  }
+}
+
+void ComposeTRS(const TRSArrays& in, float* out, size_t count) {
+  ComposeTRS(in, out, count, GetSimdLevel());
+}
+
+void ComposeTRS(const TRSArrays& in, float* out, size_t count, SimdLevel level) {
+#ifdef CORE_SIMD_X86
+  switch (level) {
+  case SimdLevel::AVX2:
+    ComposeAVX2(in, out, 0, count);
+    return;
+  case SimdLevel::SSE:
+    ComposeSSE(in, out, 0, count);
+    return;
+  default:
+    break;
+  }
+#endif
+  ComposeScalar(in, out, 0, count);
+}
+} // namespace core
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace core {
+
+enum class SimdLevel {
+  Scalar = 0,
+  SSE,
+  AVX2,
+};
+
+// Structure-of-arrays translation/rotation/scale, one entry per transform.
+// Rotations are unit quaternions.
+struct TRSArrays {
+  const float* tx;
+  const float* ty;
+  const float* tz;
+  const float* qx;
+  const float* qy;
+  const float* qz;
+  const float* qw;
+  const float* sx;
+  const float* sy;
+  const float* sz;
+};
+
+// Owns the arrays, filled once per batch.
+class TRSBuffer {
+public:
+  void Clear();
+  void Reserve(size_t count);
+  void Push(const float* t, const float* q, const float* s);
+
+  size_t Size() const { return _channels[0].size(); }
+  TRSArrays GetArrays() const;
+
+private:
+  enum { Channel_MAX = 10 };
+  std::vector<float> _channels[Channel_MAX];
+};
+
+// best level supported by the cpu and the os
+SimdLevel DetectSimdLevel();
+SimdLevel GetSimdLevel();
+// clamped to the detected level, mostly for benchmarks
+void SetSimdLevel(SimdLevel level);
+const char* GetSimdLevelName(SimdLevel level);
+
+// writes `count` column-major 4x4 matrices, 16 floats each, same layout as
+// glm::mat4 and translate * rotate * scale
+void ComposeTRS(const TRSArrays& in, float* out, size_t count);
+void ComposeTRS(const TRSArrays& in, float* out, size_t count, SimdLevel level);
+} // namespace core
@@ -0,0 +1,99 @@
+#include "archetype.h"
+#include "entity_base.h"
+#include "query.h"
+
+namespace ECS {
+
+uint32_t Archetype::Push(Entity* ent, Component* const* comps)
+{
+  uint32_t row = static_cast<uint32_t>(_entities.size());
+  _entities.push_back(ent);
+  for (int type = 0; type < ComponentType_MAX; type++) {
+    if (_mask & ComponentBit(type)) {
+      _columns[type].push_back(comps[type]);
+    }
+  }
+  return row;
+}
+
+Entity* Archetype::Remove(uint32_t row)
+{
+  uint32_t last = static_cast<uint32_t>(_entities.size() - 1);
+  for (int type = 0; type < ComponentType_MAX; type++) {
+    if (_mask & ComponentBit(type)) {
+      _columns[type][row] = _columns[type][last];
+      _columns[type].pop_back();
+    }
+  }
+  _entities[row] = _entities[last];
+  _entities.pop_back();
+
+  return row < last ? _entities[row] : nullptr;
+}
+
+ArchetypeStorage::~ArchetypeStorage()
+{
+  for (auto arch : _archetypes) {
+    delete arch;
+  }
+  _archetypes.clear();
+  _archetype_map.clear();
+  _queries.clear();
+}
+
+Archetype* ArchetypeStorage::GetOrCreate(ComponentMask mask)
+{
+  auto arch_itr = _archetype_map.find(mask);
+  if (arch_itr != _archetype_map.end()) {
+    return arch_itr->second;
+  }
+
+  auto arch = new Archetype(mask);
+  _archetype_map[mask] = arch;
+  _archetypes.push_back(arch);
+
+  for (auto query : _queries) {
+    query->OnArchetypeCreated(arch);
+  }
+  return arch;
+}
+
+void ArchetypeStorage::RegisterQuery(QueryState* query)
+{
+  for (auto arch : _archetypes) {
+    query->OnArchetypeCreated(arch);
+  }
+  _queries.push_back(query);
+}
+
+void ArchetypeStorage::Add(Entity* ent)
+{
+  auto arch = GetOrCreate(ent->GetMask());
+  ent->_archetype = arch;
+  ent->_archetype_row = arch->Push(ent, ent->_components);
+}
+
+void ArchetypeStorage::Remove(Entity* ent)
+{
+  auto arch = ent->_archetype;
+  if (!arch) {
+    return;
+  }
+
+  auto moved = arch->Remove(ent->_archetype_row);
+  if (moved) {
+    moved->_archetype_row = ent->_archetype_row;
+  }
+  ent->_archetype = nullptr;
+  ent->_archetype_row = 0;
+}
+
+void ArchetypeStorage::Move(Entity* ent)
+{
+  if (ent->_archetype && ent->_archetype->GetMask() == ent->GetMask()) {
+    return;
+  }
+  Remove(ent);
+  Add(ent);
+}
+} // namespace ECS
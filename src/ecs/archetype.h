@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+#include "component.h"
+
+namespace ECS {
+class Entity;
+class Component;
+class QueryState;
+
+// All entities sharing one component signature. Every component type of the
+// signature owns a dense column, row i of each column belongs to entity i.
+class Archetype {
+public:
+  Archetype(ComponentMask mask) : _mask(mask) {}
+
+  ComponentMask GetMask() const { return _mask; }
+  bool Match(ComponentMask mask) const { return (_mask & mask) == mask; }
+
+  size_t Size() const { return _entities.size(); }
+  Entity* const* GetEntities() const { return _entities.data(); }
+  Component* const* GetColumn(int type) const { return _columns[type].data(); }
+
+private:
+  uint32_t Push(Entity* ent, Component* const* comps);
+  // swap-remove, returns the entity which now lives in `row` (or nullptr)
+  Entity* Remove(uint32_t row);
+
+private:
+  ComponentMask _mask;
+  std::vector<Entity*> _entities;
+  std::vector<Component*> _columns[ComponentType_MAX];
+
+  friend class ArchetypeStorage;
+};
+
+class ArchetypeStorage {
+public:
+  ArchetypeStorage() {}
+  ~ArchetypeStorage();
+
+  ArchetypeStorage(const ArchetypeStorage&) = delete;
+  ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+
+  void Add(Entity* ent);
+  void Remove(Entity* ent);
+  // the entity signature changed, move it to its new archetype
+  void Move(Entity* ent);
+
+  const std::vector<Archetype*>& GetArchetypes() const { return _archetypes; }
+
+  // keep the query informed of existing and future matching archetypes
+  void RegisterQuery(QueryState* query);
+
+  template<typename Fn>
+  void ForEach(ComponentMask mask, Fn&& fn) const {
+    for (auto arch : _archetypes) {
+      if (arch->Match(mask) && arch->Size()) {
+        fn(*arch);
+      }
+    }
+  }
+
+private:
+  Archetype* GetOrCreate(ComponentMask mask);
+
+private:
+  std::unordered_map<ComponentMask, Archetype*> _archetype_map;
+  std::vector<Archetype*> _archetypes;
+  std::vector<QueryState*> _queries;
+};
+} // namespace ECS
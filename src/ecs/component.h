@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 
 namespace ECS {
 
@@ -14,6 +15,13 @@ enum ComponentType {
   ComponentType_MAX,
 };
 
+// one bit per ComponentType, used as the archetype signature
+typedef uint32_t ComponentMask;
+
+inline constexpr ComponentMask ComponentBit(int type) {
+  return ComponentMask(1) << type;
+}
+
 class IComponent {
 public:
   virtual ComponentType GetType() const = 0;
@@ -1,9 +1,19 @@
 #include "component_base.h"
+#include <atomic>
 
 #include "pybind/pybind.h"
 
 namespace ECS {
 
+static std::atomic<uint32_t> g_change_tick(1);
+
+uint32_t GetChangeTick() {
+  return g_change_tick.load(std::memory_order_relaxed);
+}
+
+uint32_t AdvanceChangeTick() {
+  return g_change_tick.fetch_add(1, std::memory_order_relaxed);
+}
 
 DEFINE_PYCXX_OBJECT_TYPE_BASE(Component, "Component", nullptr, py_init_params<>())
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 
 #include "component.h"
 #include "entity.h"
@@ -6,19 +7,32 @@
 #include "pybind/pyobject.h"
 
 namespace ECS {
+
+// Global change tick. Modified components are stamped with the current
+// tick, a reader closes the tick it has seen with AdvanceChangeTick and
+// later asks for components changed since that value.
+uint32_t GetChangeTick();
+// returns the tick being closed, later changes get a greater one
+uint32_t AdvanceChangeTick();
+
 class Component : public IComponent, public BindObject {
 public:
   DECLEAR_PYCXX_OBJECT_TYPE(Component);
-  Component() : _type(ComponentType_Unknown), _ent(nullptr){};
-  Component(ComponentType type) : _type(type), _ent(nullptr){};
+  Component() : _type(ComponentType_Unknown), _ent(nullptr), _changed_tick(GetChangeTick()){};
+  Component(ComponentType type) : _type(type), _ent(nullptr), _changed_tick(GetChangeTick()){};
 
   ComponentType GetType() const override { return _type; }
 
   void SetEntity(IEntity *ent) { _ent = ent; }
   IEntity *GetEntity() { return _ent; }
 
+  void MarkChanged() { _changed_tick = GetChangeTick(); }
+  uint32_t GetChangedTick() const { return _changed_tick; }
+  bool ChangedSince(uint32_t tick) const { return _changed_tick > tick; }
+
 private:
   ComponentType _type;
   IEntity *_ent;
+  uint32_t _changed_tick;
 };
 }; // namespace ECS
@@ -20,7 +20,7 @@ glm::mat4 ComponentCamera::GetView() {
         ent->GetComponent(ComponentType_Transform));
 
     if (comp_trans) {
-      auto pos = comp_trans->GetPosition();
+      auto pos = comp_trans->GetWorldPosition();
       return rotate_mat * glm::lookAt(pos, pos + glm::vec3(0.0f, 0.0f, -1.0f),
                                       glm::vec3(0.0f, 1.0f, 0.0f));
     }
@@ -36,10 +36,18 @@ glm::mat4 ComponentCamera::GetProjection()
 
 BIND_CLS_FUNC_DEFINE(ComponentCamera, Lock)
 BIND_CLS_FUNC_DEFINE(ComponentCamera, SetFOV)
+BIND_CLS_FUNC_DEFINE(ComponentCamera, GetYaw)
+BIND_CLS_FUNC_DEFINE(ComponentCamera, SetYaw)
+BIND_CLS_FUNC_DEFINE(ComponentCamera, GetPitch)
+BIND_CLS_FUNC_DEFINE(ComponentCamera, SetPitch)
 
 static PyMethodDef type_methods[] = {
   {"Lock", BIND_CLS_FUNC_NAME(ComponentCamera, Lock), METH_VARARGS, 0},
   {"SetFOV", BIND_CLS_FUNC_NAME(ComponentCamera, SetFOV), METH_VARARGS, 0},
+  {"GetYaw", BIND_CLS_FUNC_NAME(ComponentCamera, GetYaw), METH_NOARGS, 0},
+  {"SetYaw", BIND_CLS_FUNC_NAME(ComponentCamera, SetYaw), METH_VARARGS, 0},
+  {"GetPitch", BIND_CLS_FUNC_NAME(ComponentCamera, GetPitch), METH_NOARGS, 0},
+  {"SetPitch", BIND_CLS_FUNC_NAME(ComponentCamera, SetPitch), METH_VARARGS, 0},
   {0, nullptr, 0, 0},
 };
 
@@ -8,6 +8,8 @@ namespace ECS {
 class ComponentCamera : public Component {
 public:
   DECLEAR_PYCXX_OBJECT_TYPE(ComponentCamera);
+  static constexpr ComponentType StaticType = ComponentType_Camera;
+
   ComponentCamera()
     : Component(ComponentType_Camera)
     , _fov(60.0f)
@@ -21,8 +23,9 @@ public:
   float GetPitch() const { return _pitch; }
   float GetFOV() const { return _fov; }
 
-  void SetYaw(float val) { _yaw = val; }
+  void SetYaw(float val) { _yaw = val; MarkChanged(); }
   void SetPitch(float val) {
+    MarkChanged();
     _pitch = val;
     if (_pitch > 89.0f) {
       _pitch = 89.0f;
@@ -32,8 +35,8 @@ public:
       _pitch = -89.0f;
     }
   }
-  void SetFOV(float val) { _fov = val; }
-  void SetProjectionRatio(float ratio) { _ratio = ratio; }
+  void SetFOV(float val) { _fov = val; MarkChanged(); }
+  void SetProjectionRatio(float ratio) { _ratio = ratio; MarkChanged(); }
 
   glm::mat4 GetView();
   glm::mat4 GetProjection();
@@ -30,16 +30,19 @@ namespace ECS {
   void ComponentLight::SetLightColor(const glm::vec3& color)
   {
     _light.diffuse = color;
+    MarkChanged();
   }
 
   void ComponentLight::SetEnableShadow(bool enable)
   {
     _enable_shadow = enable;
+    MarkChanged();
   }
 
   void ComponentLight::SetRadius(float rad)
   {
     _radius = rad;
+    MarkChanged();
   }
 
   BIND_CLS_FUNC_DEFINE(ComponentLight, SetLightColor);
@@ -3,6 +3,7 @@
 
 #include "component_base.h"
 #include "glm/glm.hpp"
+#include "render/render.h"
 
 class Model;
 class Shader;
@@ -34,17 +35,23 @@ enum LightType {
 class ComponentLight : public Component {
 public:
   DECLEAR_PYCXX_OBJECT_TYPE(ComponentLight);
+  static constexpr ComponentType StaticType = ComponentType_Light;
+
   ComponentLight(int type);
   virtual ~ComponentLight();
 
   LightType GetLightType() { return _type; }
 
-  void SetLightParam(const LightParam &light) { _light = light; }
+  void SetLightParam(const LightParam &light) { _light = light; MarkChanged(); }
   const LightParam &GetLightParam() const { return _light; }
 
   void SetShadowTexture(unsigned int texture);
   unsigned int GetShadowTexture() const { return _shadow_texture; }
 
+  // render proxy, owned by SystemSyncRender
+  render::PointLightHandle point_light;
+  render::DirectionLightHandle direction_light;
+
   void SetLightColor(const glm::vec3& color);
   void SetEnableShadow(bool enable);
   bool IsShadowEnabled() { return _enable_shadow; }
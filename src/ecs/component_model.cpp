@@ -18,12 +18,6 @@ ComponentModel::ComponentModel(const char* file_path)
   , _metalic_path("resource/images/pbr/white/metallic.png")
   , _roughness_path("resource/images/pbr/white/roughness.png")
   , _ao_path("resource/images/pbr/white/ao.png")
-  , model_id(0)
-  , albedo_id(0)
-  , normal_id(0)
-  , metalic_id(0)
-  , roughness_id(0)
-  , ao_id(0)
   , _loaded(false)
   , _model(nullptr)
 {
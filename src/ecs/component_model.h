@@ -5,6 +5,7 @@
 
 #include "pybind/pybind.h"
 #include "ecs/system_model.h"
+#include "render/render.h"
 
 namespace render {
   class Model;
@@ -15,20 +16,22 @@ namespace ECS {
 class ComponentModel : public Component {
 public:
   DECLEAR_PYCXX_OBJECT_TYPE(ComponentModel);
+  static constexpr ComponentType StaticType = ComponentType_Model;
+
   ComponentModel(const char *file_path);
   virtual ~ComponentModel();
 
   bool IsLoaded() const { return _loaded; }
-  void SetLoaded() { _loaded = true; }
+  void SetLoaded() { _loaded = true; MarkChanged(); }
 
   void Draw(render::Shader* shader);
 
-  void SetModelPath(const char* path) { _model_path = path; }
-  void SetAlbedoPath(const char* path) { _albedo_path = path; }
-  void SetNormalPath(const char* path) { _normal_path = path; }
-  void SetMetalicPath(const char* path) { _metalic_path = path; }
-  void SetRouphnessPath(const char* path) { _roughness_path = path; }
-  void SetAOPath(const char* path) { _ao_path = path; }
+  void SetModelPath(const char* path) { _model_path = path; MarkChanged(); }
+  void SetAlbedoPath(const char* path) { _albedo_path = path; MarkChanged(); }
+  void SetNormalPath(const char* path) { _normal_path = path; MarkChanged(); }
+  void SetMetalicPath(const char* path) { _metalic_path = path; MarkChanged(); }
+  void SetRouphnessPath(const char* path) { _roughness_path = path; MarkChanged(); }
+  void SetAOPath(const char* path) { _ao_path = path; MarkChanged(); }
   std::string GetModelPath() { return _model_path; }
   std::string GetAlbedoPath() { return _albedo_path; }
   std::string GetNormalPath() { return _normal_path; }
@@ -50,12 +53,15 @@ protected:
   std::string _ao_path;
 
 public:
-  uint64_t model_id;
-  uint64_t albedo_id;
-  uint64_t normal_id;
-  uint64_t metalic_id;
-  uint64_t roughness_id;
-  uint64_t ao_id;
+  render::MeshHandle model_id;
+  render::TextureHandle albedo_id;
+  render::TextureHandle normal_id;
+  render::TextureHandle metalic_id;
+  render::TextureHandle roughness_id;
+  render::TextureHandle ao_id;
+
+  // render proxy, owned by SystemSyncRender
+  render::RenderItemHandle render_item;
 
   friend SystemModel;
 };
@@ -8,6 +8,7 @@ namespace ECS {
   void ComponentPhysics::SetKinematic(bool enable)
   {
     _is_kinematic = enable;
+    MarkChanged();
     if (!_is_static && _body) {
       auto rigid_body = static_cast<physx::PxRigidBody*>(_body);
       if (rigid_body) {
@@ -20,6 +21,15 @@ namespace ECS {
     _body->release();
   }
   _body = new_body;
+  MarkChanged();
+}
+
+bool ComponentPhysics::IsSleeping()
+{
+  if (_is_static || !_body) {
+    return true;
+  }
+  return static_cast<physx::PxRigidDynamic*>(_body)->isSleeping();
 }
 
 glm::mat4 ComponentPhysics::GetTransform()
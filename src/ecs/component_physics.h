@@ -9,6 +9,8 @@ namespace ECS {
 class ComponentPhysics : public Component {
 public:
   DECLEAR_PYCXX_OBJECT_TYPE(ComponentPhysics)
+  static constexpr ComponentType StaticType = ComponentType_Physics;
+
   ComponentPhysics(bool is_static, int geo_type, const glm::vec3& geo_size)
     : Component(ComponentType_Physics)
     , _is_static(is_static)
@@ -23,6 +25,7 @@ public:
   void SetKinematic(bool enable);
   bool IsStatic() { return _is_static; }
   bool IsLoaded() { return _body != nullptr; }
+  bool IsSleeping();
   void SetActor(physx::PxRigidActor* new_body);
 
   int GetGeoType() { return _geo_type; }
@@ -1,17 +1,66 @@
 #include "component_trans.h"
 
+#include <algorithm>
+
 #include "glm/gtx/quaternion.hpp"
-#include "glm/gtx/matrix_decompose.hpp"
 
+#include "entity_base.h"
 #include "pybind/pybind.h"
 
 namespace ECS {
-glm::mat4 ComponentTransform::GetTransform() const {
-  auto trans_mat = glm::translate(glm::mat4(1.0f), _translation);
-  auto rotate_mat = glm::toMat4(_rotation);
-  auto scale_mat = glm::scale(glm::mat4(1.0f), _scale);
+ComponentTransform::~ComponentTransform() {
+  DetachFromParent();
+  for (auto child : _children) {
+    child->_parent = nullptr;
+    child->MarkWorldDirty();
+  }
+  _children.clear();
+}
 
-  return trans_mat * rotate_mat * scale_mat;
+void ComponentTransform::MarkDirty() {
+  _local_dirty = true;
+  MarkWorldDirty();
+}
+
+// a dirty transform always has dirty descendants, refreshing a child
+// refreshes its parents first, so the walk can stop at a dirty one
+void ComponentTransform::MarkWorldDirty() {
+  MarkChanged();
+  if (_world_dirty) {
+    return;
+  }
+  _world_dirty = true;
+  for (auto child : _children) {
+    child->MarkWorldDirty();
+  }
+}
+
+const glm::mat4& ComponentTransform::GetLocalTransform() const {
+  if (_local_dirty) {
+    auto rot = glm::mat3_cast(_rotation);
+    _local[0] = glm::vec4(rot[0] * _scale.x, 0.0f);
+    _local[1] = glm::vec4(rot[1] * _scale.y, 0.0f);
+    _local[2] = glm::vec4(rot[2] * _scale.z, 0.0f);
+    _local[3] = glm::vec4(_translation, 1.0f);
+    _local_dirty = false;
+  }
+  return _local;
+}
+
+const glm::mat4& ComponentTransform::GetTransform() const {
+  if (_world_dirty) {
+    if (_parent) {
+      _world = _parent->GetTransform() * GetLocalTransform();
+    } else {
+      _world = GetLocalTransform();
+    }
+    _world_dirty = false;
+  }
+  return _world;
+}
+
+glm::vec3 ComponentTransform::GetWorldPosition() const {
+  return glm::vec3(GetTransform()[3]);
 }
 
 void ComponentTransform::UpdateLastTrans() {
@@ -28,7 +77,10 @@ glm::mat4 ComponentTransform::GetLastTrans() {
 
 glm::vec3 ComponentTransform::GetPosition() const { return _translation; }
 
-void ComponentTransform::SetPosition(glm::vec3 pos) { _translation = pos; }
+void ComponentTransform::SetPosition(glm::vec3 pos) {
+  _translation = pos;
+  MarkDirty();
+}
 
 glm::quat ComponentTransform::GetRotation() const { return _rotation; }
 
@@ -37,56 +89,167 @@ glm::vec3 ComponentTransform::GetRotationEular() const
   return glm::degrees(glm::eulerAngles(_rotation));
 }
 
+void ComponentTransform::SetScale(glm::vec3 scale) {
+  _scale = scale;
+  MarkDirty();
+}
+
 glm::vec3 ComponentTransform::GetScale() const { return _scale; }
 
 void ComponentTransform::SetRotation(const glm::quat& q)
 {
   _rotation = q;
+  MarkDirty();
 }
 
 void ComponentTransform::SetRotationEular(const glm::vec3& eular)
 {
   _rotation = glm::quat(glm::vec3(eular.y, eular.x, eular.z));
+  MarkDirty();
 }
 
+// local +z points along `forward`, same basis as inverse(lookAt(pos, pos - forward, up))
 void ComponentTransform::SetForward(const glm::vec3& forward)
 {
+  auto z_axis = glm::normalize(forward);
   glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-  if (glm::length(glm::cross(up, forward)) < 0.0001f) {
+  if (glm::length(glm::cross(up, z_axis)) < 0.0001f) {
     up = glm::vec3(1.0f, 0.0f, 0.0f);
   }
-  auto view = glm::lookAt(GetPosition(), GetPosition() - forward, up);
-  SetTransform(glm::inverse(view));
+  auto x_axis = glm::normalize(glm::cross(up, z_axis));
+  auto y_axis = glm::cross(z_axis, x_axis);
+
+  _rotation = glm::quat_cast(glm::mat3(x_axis, y_axis, z_axis));
+  MarkDirty();
 }
 
+// no shear or perspective is expected, so the columns are split directly
+// instead of going through glm::decompose
 bool ComponentTransform::SetTransform(glm::mat4 trans_mat) {
-  glm::vec3 skew;
-  glm::vec4 perspective;
-  return glm::decompose(trans_mat, _scale, _rotation, _translation, skew,
-                        perspective);
-  using type_new = decltype(&ComponentTransform::GetPosition);
-  using ttt_type = std::remove_const_t<type_new>;
+  glm::vec3 cols[3] = { glm::vec3(trans_mat[0]), glm::vec3(trans_mat[1]), glm::vec3(trans_mat[2]) };
+  glm::vec3 scale(glm::length(cols[0]), glm::length(cols[1]), glm::length(cols[2]));
+  if (scale.x == 0.0f || scale.y == 0.0f || scale.z == 0.0f) {
+    return false;
+  }
+
+  // mirrored basis, keep the rotation proper
+  if (glm::dot(cols[0], glm::cross(cols[1], cols[2])) < 0.0f) {
+    scale.x = -scale.x;
+  }
+
+  _translation = glm::vec3(trans_mat[3]);
+  _scale = scale;
+  _rotation = glm::normalize(glm::quat_cast(glm::mat3(cols[0] / scale.x, cols[1] / scale.y, cols[2] / scale.z)));
+  MarkDirty();
+  return true;
+}
+
+void ComponentTransform::SetWorldTransform(const glm::mat4& trans_mat) {
+  if (_parent) {
+    SetTransform(glm::inverse(_parent->GetTransform()) * trans_mat);
+  } else {
+    SetTransform(trans_mat);
+  }
+}
+
+void ComponentTransform::SetWorldPose(const glm::vec3& pos, const glm::quat& rot) {
+  if (!_parent) {
+    _translation = pos;
+    _rotation = rot;
+    MarkDirty();
+    return;
+  }
+
+  auto rot_mat = glm::mat3_cast(rot);
+  glm::mat4 world(
+    glm::vec4(rot_mat[0] * _scale.x, 0.0f),
+    glm::vec4(rot_mat[1] * _scale.y, 0.0f),
+    glm::vec4(rot_mat[2] * _scale.z, 0.0f),
+    glm::vec4(pos, 1.0f));
+  SetWorldTransform(world);
+}
+
+bool ComponentTransform::SetParent(Entity* parent_ent) {
+  if (!parent_ent) {
+    return false;
+  }
+  auto parent = static_cast<ComponentTransform*>(parent_ent->GetComponent(ComponentType_Transform));
+  return AttachTo(parent);
+}
+
+bool ComponentTransform::AttachTo(ComponentTransform* parent) {
+  if (!parent) {
+    return false;
+  }
+
+  // no cycles
+  for (auto itr = parent; itr; itr = itr->_parent) {
+    if (itr == this) {
+      return false;
+    }
+  }
+
+  DetachFromParent();
+  _parent = parent;
+  parent->_children.push_back(this);
+  MarkWorldDirty();
+  return true;
+}
+
+void ComponentTransform::DetachFromParent() {
+  if (!_parent) {
+    return;
+  }
+
+  auto& siblings = _parent->_children;
+  siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+  _parent = nullptr;
+  MarkWorldDirty();
+}
+
+void ComponentTransform::DetachChildren() {
+  auto children = _children;
+  for (auto child : children) {
+    auto world = child->GetTransform();
+    child->DetachFromParent();
+    child->SetTransform(world);
+  }
+}
+
+Entity* ComponentTransform::GetParent() const {
+  if (!_parent) {
+    return nullptr;
+  }
+  return dynamic_cast<Entity*>(_parent->GetEntity());
 }
 
 BIND_CLS_FUNC_DEFINE(ComponentTransform, SetPosition)
 BIND_CLS_FUNC_DEFINE(ComponentTransform, GetPosition)
+BIND_CLS_FUNC_DEFINE(ComponentTransform, GetWorldPosition)
 BIND_CLS_FUNC_DEFINE(ComponentTransform, SetScale)
 BIND_CLS_FUNC_DEFINE(ComponentTransform, GetScale)
 BIND_CLS_FUNC_DEFINE(ComponentTransform, GetRotation)
 BIND_CLS_FUNC_DEFINE(ComponentTransform, SetRotation)
 BIND_CLS_FUNC_DEFINE(ComponentTransform, SetRotationEular)
 BIND_CLS_FUNC_DEFINE(ComponentTransform, SetForward)
+BIND_CLS_FUNC_DEFINE(ComponentTransform, SetParent)
+BIND_CLS_FUNC_DEFINE(ComponentTransform, GetParent)
+BIND_CLS_FUNC_DEFINE(ComponentTransform, DetachFromParent)
 BIND_CLS_FUNC_DEFINE(ComponentTransform, UpdateLastTrans)
 
 static PyMethodDef type_methods[] = {
   {"SetPosition", BIND_CLS_FUNC_NAME(ComponentTransform, SetPosition), METH_VARARGS, 0},
   {"GetPosition", BIND_CLS_FUNC_NAME(ComponentTransform, GetPosition), METH_NOARGS, 0},
+  {"GetWorldPosition", BIND_CLS_FUNC_NAME(ComponentTransform, GetWorldPosition), METH_NOARGS, 0},
   {"SetScale", BIND_CLS_FUNC_NAME(ComponentTransform, SetScale), METH_VARARGS, 0},
   {"GetScale", BIND_CLS_FUNC_NAME(ComponentTransform, GetScale), METH_NOARGS, 0},
   {"GetRotation", BIND_CLS_FUNC_NAME(ComponentTransform, GetRotation), METH_NOARGS, 0},
   {"SetRotation", BIND_CLS_FUNC_NAME(ComponentTransform, SetRotation), METH_VARARGS, 0},
   {"SetRotationEular", BIND_CLS_FUNC_NAME(ComponentTransform, SetRotationEular), METH_VARARGS, 0},
   {"SetForward", BIND_CLS_FUNC_NAME(ComponentTransform, SetForward), METH_VARARGS, 0},
+  {"SetParent", BIND_CLS_FUNC_NAME(ComponentTransform, SetParent), METH_VARARGS, 0},
+  {"GetParent", BIND_CLS_FUNC_NAME(ComponentTransform, GetParent), METH_NOARGS, 0},
+  {"DetachFromParent", BIND_CLS_FUNC_NAME(ComponentTransform, DetachFromParent), METH_NOARGS, 0},
   {"UpdateLastTrans", BIND_CLS_FUNC_NAME(ComponentTransform, UpdateLastTrans), METH_NOARGS, 0},
   {0, nullptr, 0, 0},
 };
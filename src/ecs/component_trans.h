@@ -1,35 +1,49 @@
 #pragma once
+#include <vector>
 
 #include "component_base.h"
 #include "glm/ext/quaternion_float.hpp"
 #include "glm/glm.hpp"
 
 namespace ECS {
+class Entity;
+
+// Position, rotation and scale are local to the parent transform. Local and
+// world matrices are cached, changing a transform marks it and everything
+// below it dirty, SystemTransform refreshes the dirty ones once per tick.
 class ComponentTransform : public Component {
 public:
   DECLEAR_PYCXX_OBJECT_TYPE(ComponentTransform);
+  static constexpr ComponentType StaticType = ComponentType_Transform;
+
   ComponentTransform()
       : Component(ComponentType_Transform)
       , _scale(glm::vec3(1.0f, 1.0f, 1.0f))
-      , _rotation(glm::quat(0.0f, 0.0f, 0.0f, 1.0f))
+      , _rotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f))
       , _translation(glm::vec3(0.0f, 0.0f, 0.0f))
+      , _parent(nullptr)
+      , _local(1.0f)
+      , _world(1.0f)
+      , _local_dirty(false)
+      , _world_dirty(false)
       , _first_get_last_trans(true)
   {
-    SetTransform(glm::mat4(1.0f));
   };
 
   ComponentTransform(glm::mat4 trans)
-      : Component(ComponentType_Transform){
+      : ComponentTransform() {
     SetTransform(trans);
   };
 
+  ~ComponentTransform();
+
   void SetPosition(glm::vec3);
   glm::vec3 GetPosition() const;
 
   glm::quat GetRotation() const;
   glm::vec3 GetRotationEular() const;
 
-  void SetScale(glm::vec3 scale) { _scale = scale; }
+  void SetScale(glm::vec3 scale);
   glm::vec3 GetScale() const;
 
   void SetRotation(const glm::quat& q);
@@ -37,17 +51,56 @@ public:
 
   void SetForward(const glm::vec3& forward);
 
+  // local matrix, translation/rotation/scale only
   bool SetTransform(glm::mat4 trans_mat);
-  glm::mat4 GetTransform() const;
+  const glm::mat4& GetLocalTransform() const;
+  // world matrix
+  const glm::mat4& GetTransform() const;
+  glm::vec3 GetWorldPosition() const;
+
+  void SetWorldTransform(const glm::mat4& trans_mat);
+  // keeps the current scale
+  void SetWorldPose(const glm::vec3& pos, const glm::quat& rot);
+
+  // the local values are kept, they become relative to the new parent
+  bool SetParent(Entity* parent_ent);
+  bool AttachTo(ComponentTransform* parent);
+  void DetachFromParent();
+  // children keep their world transform
+  void DetachChildren();
+  Entity* GetParent() const;
+  ComponentTransform* GetParentTransform() const { return _parent; }
+  const std::vector<ComponentTransform*>& GetChildren() const { return _children; }
+
+  bool IsLocalDirty() const { return _local_dirty; }
+  bool IsWorldDirty() const { return _world_dirty; }
+  // local matrix composed elsewhere from the current TRS, e.g. in a batch
+  void StoreLocalTransform(const glm::mat4& local) const {
+    _local = local;
+    _local_dirty = false;
+  }
+  void UpdateWorld() const { GetTransform(); }
 
   void UpdateLastTrans();
   glm::mat4 GetLastTrans();
 
+private:
+  void MarkDirty();
+  void MarkWorldDirty();
+
 private:
   glm::vec3 _scale;
   glm::quat _rotation;
   glm::vec3 _translation;
 
+  ComponentTransform* _parent;
+  std::vector<ComponentTransform*> _children;
+
+  mutable glm::mat4 _local;
+  mutable glm::mat4 _world;
+  mutable bool _local_dirty;
+  mutable bool _world_dirty;
+
   glm::mat4 _last_trans;
   bool _first_get_last_trans;
 };
@@ -1,4 +1,5 @@
 #include "entity_base.h"
+#include "scene.h"
 #include "pybind/pybind.h"
 
 namespace ECS {
@@ -8,13 +9,24 @@ uint64_t GenEntityID() {
   return ++id;
 }
 
-Entity::Entity() : _type(EntityType_Base), _id(GenEntityID()) {}
+Entity::Entity()
+  : _type(EntityType_Base)
+  , _id(GenEntityID())
+  , _mask(0)
+  , _components{}
+  , _scene(nullptr)
+  , _archetype(nullptr)
+  , _archetype_row(0)
+{}
 
 Entity::~Entity() {
-  for (auto const &comp : _components) {
-    comp.second->DecRef();
+  for (auto &comp : _components) {
+    if (comp) {
+      comp->DecRef();
+      comp = nullptr;
+    }
   }
-  _components.clear();
+  _mask = 0;
 }
 
 bool Entity::AddComponent(Component *comp) {
@@ -22,29 +34,39 @@ bool Entity::AddComponent(Component *comp) {
     return false;
   }
   auto comp_type = comp->GetType();
-  if (_components.count(comp_type)) {
+  if (comp_type <= ComponentType_Unknown || comp_type >= ComponentType_MAX) {
+    return false;
+  }
+  if (_components[comp_type]) {
     return false;
   }
 
   _components[comp_type] = comp;
+  _mask |= ComponentBit(comp_type);
   comp->AddRef();
   comp->SetEntity(this);
+
+  // signature changed, move to the matching archetype
+  if (_scene) {
+    _scene->OnEntityChanged(this);
+  }
   return true;
 }
 
 Component *Entity::GetComponent(int type) {
-  auto comp_itr = _components.find(static_cast<ComponentType>(type));
-  if (comp_itr != _components.end()) {
-    return comp_itr->second;
+  if (type < 0 || type >= ComponentType_MAX) {
+    return nullptr;
   }
-  return nullptr;
+  return _components[type];
 }
 
 std::vector<ComponentType> Entity::GetComponentTypes() {
   std::vector<ComponentType> res;
 
-  for (auto const &comp : _components) {
-    res.push_back(comp.first);
+  for (int type = 0; type < ComponentType_MAX; type++) {
+    if (_components[type]) {
+      res.push_back(static_cast<ComponentType>(type));
+    }
   }
 
   return res;
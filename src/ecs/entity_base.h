@@ -5,9 +5,11 @@
 
 #include "entity.h"
 #include "component_base.h"
+#include "archetype.h"
 #include "pybind/pyobject.h"
 
 namespace ECS {
+class Scene;
 
 class Entity : public IEntity, public BindObject {
 public:
@@ -22,11 +24,23 @@ public:
   Component* GetComponent(int type);
 
   std::vector<ComponentType> GetComponentTypes();
+  ComponentMask GetMask() const { return _mask; }
+
+  void SetScene(Scene* scn) { _scene = scn; }
+  Scene* GetScene() { return _scene; }
 
 private:
   EntityType _type;
   uint64_t _id;
-  std::unordered_map<ComponentType, Component*> _components;
+  ComponentMask _mask;
+  Component* _components[ComponentType_MAX];
+
+  // location inside the owning scene's archetype storage
+  Scene* _scene;
+  Archetype* _archetype;
+  uint32_t _archetype_row;
+
+  friend class ArchetypeStorage;
 };
 
 } // namespace ECS
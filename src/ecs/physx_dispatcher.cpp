@@ -0,0 +1,17 @@
+#include "physx_dispatcher.h"
+
+#include "core/job_system.h"
+
+namespace ECS {
+
+void PhysxJobDispatcher::submitTask(physx::PxBaseTask& task) {
+  _jobs->Schedule([&task]() {
+    task.run();
+    task.release();
+  });
+}
+
+uint32_t PhysxJobDispatcher::getWorkerCount() const {
+  return _jobs->GetWorkerCount();
+}
+} // namespace ECS
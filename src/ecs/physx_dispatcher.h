@@ -0,0 +1,20 @@
+#pragma once
+#include <PxPhysicsAPI.h>
+
+namespace core {
+class JobSystem;
+}
+
+namespace ECS {
+// Runs PhysX tasks on the engine job system instead of a private thread pool.
+class PhysxJobDispatcher : public physx::PxCpuDispatcher {
+public:
+  PhysxJobDispatcher(core::JobSystem* jobs) : _jobs(jobs) {}
+
+  void submitTask(physx::PxBaseTask& task) override;
+  uint32_t getWorkerCount() const override;
+
+private:
+  core::JobSystem* _jobs;
+};
+} // namespace ECS
@@ -11,8 +11,11 @@
 #include "system_input.h"
 #include "system_syncrender.h"
 #include "system_physics.h"
+#include "system_transform.h"
+#include "world.h"
 
 #include "pybind/pybind.h"
+#include "render/render.h"
 
 namespace ECS {
   Entity* CreateEntity()
@@ -92,6 +95,25 @@ namespace ECS {
     return res;
   }
 
+  SystemTransform* CreateSystemTransform()
+  {
+    auto res = new SystemTransform();
+    res->SetRef(0);
+    return res;
+  }
+
+  // .csv or .json, pass timings of the last frames
+  bool ExportRenderStats(const char* path)
+  {
+    return render::Render::GetInstance().ExportStats(path);
+  }
+
+  // chrome trace of the profiler scopes
+  bool ExportProfile(const char* path)
+  {
+    return World::GetInstance().ExportTrace(path);
+  }
+
   BIND_FUNC_DEFINE(CreateScene);
   BIND_FUNC_DEFINE(CreateEntity);
   BIND_FUNC_DEFINE(CreateComponentModel);
@@ -103,6 +125,9 @@ namespace ECS {
   BIND_FUNC_DEFINE(CreateSystemInput);
   BIND_FUNC_DEFINE(CreateSystemSyncRender);
   BIND_FUNC_DEFINE(CreateSystemPhysics);
+  BIND_FUNC_DEFINE(CreateSystemTransform);
+  BIND_FUNC_DEFINE(ExportRenderStats);
+  BIND_FUNC_DEFINE(ExportProfile);
 
   static PyMethodDef my_methods[] = {
   {"CreateScene", BIND_FUNC_NAME(CreateScene), METH_NOARGS, NULL},
@@ -115,6 +140,9 @@ namespace ECS {
   {"CreateSystemInput", BIND_FUNC_NAME(CreateSystemInput), METH_NOARGS, NULL},
   {"CreateSystemSyncRender", BIND_FUNC_NAME(CreateSystemSyncRender), METH_NOARGS, NULL},
   {"CreateSystemPhysics", BIND_FUNC_NAME(CreateSystemPhysics), METH_NOARGS, NULL},
+  {"CreateSystemTransform", BIND_FUNC_NAME(CreateSystemTransform), METH_NOARGS, NULL},
+  {"ExportRenderStats", BIND_FUNC_NAME(ExportRenderStats), METH_VARARGS, NULL},
+  {"ExportProfile", BIND_FUNC_NAME(ExportProfile), METH_VARARGS, NULL},
   {nullptr, 0, 0, 0}
   };
 
@@ -12,6 +12,7 @@ namespace ECS {
   class SystemModel;
   class SystemInput;
   class SystemSyncRender;
+  class SystemTransform;
  
   Entity* CreateEntity();
   ComponentModel* CreateComponentModel(const char* path);
@@ -24,6 +25,7 @@ namespace ECS {
   SystemModel* CreateSystemModel();
   SystemInput* CreateSystemInput();
   SystemSyncRender* CreateSystemSyncRender();
+  SystemTransform* CreateSystemTransform();
 
   void InitFuncModule(void* mod);
 }
\ No newline at end of file
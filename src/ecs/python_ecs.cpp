@@ -19,6 +19,7 @@
 
 #include "ecs/pyfunc.h"
 #include "ecs/pymath.h"
+#include "core/profiler.h"
 
 #include <Python.h>
 #include <vector>
@@ -127,9 +128,30 @@ static PyMethodDef my_methods[] = {
   {nullptr, 0, 0, 0}
 };
 
+static std::string g_tick_code;
+
+// module name first, like a regular interpreter
+static void InitArgv() {
+  auto& ctx = World::GetInstance().ctx;
+  auto argv = PyList_New(0);
+
+  auto item = PyUnicode_FromString(ctx.script_module.c_str());
+  PyList_Append(argv, item);
+  Py_DECREF(item);
+  for (auto& arg : ctx.script_args) {
+    item = PyUnicode_FromString(arg.c_str());
+    PyList_Append(argv, item);
+    Py_DECREF(item);
+  }
+
+  PySys_SetObject("argv", argv);
+  Py_DECREF(argv);
+}
+
 void InitPython() {
   InitPath();
   Py_Initialize();
+  InitArgv();
 
   auto new_module = PyImport_AddModule("_engine");
   PyModule_AddFunctions(new_module, my_methods);
@@ -157,18 +179,17 @@ void InitPython() {
 }
 
 void InitPythonPost() {
-  PyRun_SimpleString(
-    "import script_main\n"
-    "script_main.__start__()\n"
-  );
+  auto& module = World::GetInstance().ctx.script_module;
+  auto start_code = "import " + module + "\n" + module + ".__start__()\n";
+  g_tick_code = "import " + module + "\n" + module + ".tick()\n";
+
+  PyRun_SimpleString(start_code.c_str());
 }
 
 void TickPython()
 {
-  PyRun_SimpleString(
-    "import script_main\n"
-    "script_main.tick()\n"
-  );
+  PROFILE_SCOPE("TickPython");
+  PyRun_SimpleString(g_tick_code.c_str());
 }
 
 }
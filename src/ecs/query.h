@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "archetype.h"
+#include "component_base.h"
+
+namespace ECS {
+class Entity;
+class Component;
+
+// Archetypes matching one signature, cached by Scene. Archetypes are never
+// destroyed, so the list only grows when the storage creates a new one.
+class QueryState {
+public:
+  QueryState(ComponentMask mask) : _mask(mask) {}
+
+  ComponentMask GetMask() const { return _mask; }
+  const std::vector<Archetype*>& GetArchetypes() const { return _archetypes; }
+
+  void OnArchetypeCreated(Archetype* arch) {
+    if (arch->Match(_mask)) {
+      _archetypes.push_back(arch);
+    }
+  }
+
+  size_t Count() const {
+    size_t count = 0;
+    for (auto arch : _archetypes) {
+      count += arch->Size();
+    }
+    return count;
+  }
+
+private:
+  ComponentMask _mask;
+  std::vector<Archetype*> _archetypes;
+};
+
+// Typed view over a cached QueryState. Each component type must expose a
+// `StaticType` constant, e.g. scene->Query<ComponentTransform, ComponentModel>().
+template<typename... Ts>
+class Query {
+public:
+  static constexpr ComponentMask Mask = (ComponentBit(Ts::StaticType) | ... | 0);
+
+  Query(const QueryState* state) : _state(state) {}
+
+  size_t Count() const { return _state->Count(); }
+
+  // fn(Ts&...) or fn(Entity*, Ts&...)
+  template<typename Fn>
+  void Each(Fn&& fn) const {
+    for (auto arch : _state->GetArchetypes()) {
+      size_t size = arch->Size();
+      if (!size) {
+        continue;
+      }
+
+      auto ents = arch->GetEntities();
+      Component* const* cols[sizeof...(Ts)] = { arch->GetColumn(Ts::StaticType)... };
+      for (size_t i = 0; i < size; i++) {
+        Invoke(fn, ents[i], cols, i, std::index_sequence_for<Ts...>{});
+      }
+    }
+  }
+
+  // like Each, but only rows where any of Ts changed after `tick`
+  template<typename Fn>
+  void EachChanged(uint32_t tick, Fn&& fn) const {
+    for (auto arch : _state->GetArchetypes()) {
+      size_t size = arch->Size();
+      if (!size) {
+        continue;
+      }
+
+      auto ents = arch->GetEntities();
+      Component* const* cols[sizeof...(Ts)] = { arch->GetColumn(Ts::StaticType)... };
+      for (size_t i = 0; i < size; i++) {
+        bool changed = false;
+        for (size_t c = 0; c < sizeof...(Ts); c++) {
+          changed |= cols[c][i]->ChangedSince(tick);
+        }
+        if (changed) {
+          Invoke(fn, ents[i], cols, i, std::index_sequence_for<Ts...>{});
+        }
+      }
+    }
+  }
+
+private:
+  template<typename Fn, size_t... Is>
+  static void Invoke(Fn& fn, Entity* ent, Component* const* const* cols, size_t row, std::index_sequence<Is...>) {
+    if constexpr (std::is_invocable_v<Fn&, Entity*, Ts&...>) {
+      fn(ent, *static_cast<Ts*>(cols[Is][row])...);
+    } else {
+      fn(*static_cast<Ts*>(cols[Is][row])...);
+    }
+  }
+
+private:
+  const QueryState* _state;
+};
+} // namespace ECS
@@ -30,11 +30,39 @@
 
 namespace ECS {
 
-Scene::Scene() : _active_camera(0), _ibl_hdr_path("") {
+static int GetSystemPriority(SystemType type) {
+  switch (type) {
+  case SystemType_Camera:
+    // moves only the camera, ahead of physics so it shares a stage with
+    // the model loads instead of waiting on the physics step
+    return -2;
+  case SystemType_Physics:
+    return -1;
+  case SystemType_Transform:
+    return 90;
+  case SystemType_SyncRender:
+    return 100;
+  default:
+    return 0;
+  }
+}
+
+// structural changes count as changes of every component
+static void MarkComponentsChanged(Entity* ent) {
+  for (auto comp_type : ent->GetComponentTypes()) {
+    ent->GetComponent(comp_type)->MarkChanged();
+  }
+}
+
+Scene::Scene()
+  : _removed_prune_tick(0)
+  , _schedule_dirty(true)
+  , _active_camera(0)
+  , _ibl_hdr_path("") {
   auto gPhysics = World::GetInstance().GetPhysics();
   physx::PxSceneDesc sceneDesc(gPhysics->getTolerancesScale());
   sceneDesc.gravity = physx::PxVec3(0.0f, -9.81f, 0.0f);
-  _px_dispatcher = physx::PxDefaultCpuDispatcherCreate(2);
+  _px_dispatcher = new PhysxJobDispatcher(&World::GetInstance().GetJobSystem());
   sceneDesc.cpuDispatcher = _px_dispatcher;
   sceneDesc.filterShader = physx::PxDefaultSimulationFilterShader;
   _px_scene = gPhysics->createScene(sceneDesc);
@@ -50,16 +78,35 @@ Scene::Scene() : _active_camera(0), _ibl_hdr_path("") {
 
 Scene::~Scene() {
   for (auto const &ent : _entities) {
-    auto base_ent = dynamic_cast<Entity*>(ent.second);
+    auto base_ent = static_cast<Entity*>(ent.second);
+    _storage.Remove(base_ent);
+    base_ent->SetScene(nullptr);
     base_ent->DecRef();
   }
   _entities.clear();
-  _entity_tag_list->clear();
+
+  for (auto const &removed : _removed_entities) {
+    removed.ent->DecRef();
+  }
+  _removed_entities.clear();
+
+  if (_px_scene) {
+    _px_scene->release();
+    _px_scene = nullptr;
+  }
+  delete _px_dispatcher;
+  _px_dispatcher = nullptr;
+
+  for (auto const &query : _queries) {
+    delete query.second;
+  }
+  _queries.clear();
 
   for (auto const &sys : _systems) {
     sys.second->DecRef();
   }
   _systems.clear();
+  _system_order.clear();
 }
 
 void Scene::OnAddedToWorld()
@@ -82,6 +129,12 @@ bool Scene::AddSystem(System *sys) {
   _systems[sys_type] = sys;
   sys->AddRef();
 
+  _system_order.push_back(sys);
+  std::stable_sort(_system_order.begin(), _system_order.end(), [](const System* a, const System* b) {
+    return GetSystemPriority(a->GetSystemType()) < GetSystemPriority(b->GetSystemType());
+    });
+  _schedule_dirty = true;
+
   return true;
 }
 
@@ -93,6 +146,8 @@ bool Scene::DelSystem(SystemType sys_type) {
 
   auto sys = sys_itr->second;
   _systems.erase(sys_itr);
+  _system_order.erase(std::find(_system_order.begin(), _system_order.end(), sys));
+  _schedule_dirty = true;
   sys->DecRef();
 
   return true;
@@ -104,17 +159,16 @@ bool Scene::AddEntity(Entity* base_ent) {
   }
 
   uint64_t ent_id = base_ent->GetID();
-  if (_entities.count(ent_id)) {
+  if (_entities.count(ent_id) || base_ent->GetScene()) {
     return false;
   }
 
   base_ent->AddRef();
   _entities[ent_id] = base_ent;
 
-  auto comp_types = base_ent->GetComponentTypes();
-  for (auto const& comp_type : comp_types) {
-    _entity_tag_list[comp_type][ent_id] = base_ent;
-  }
+  base_ent->SetScene(this);
+  _storage.Add(base_ent);
+  MarkComponentsChanged(base_ent);
 
   return true;
 }
@@ -125,13 +179,19 @@ bool Scene::DelEntity(uint64_t ent_id) {
     return false;
   }
 
-  auto ent = ent_itr->second;
-  _entities.erase(ent_id);
-  for (auto &tag_list : _entity_tag_list) {
-    tag_list.erase(ent_id);
+  auto base_ent = static_cast<Entity*>(ent_itr->second);
+  _entities.erase(ent_itr);
+  _storage.Remove(base_ent);
+
+  auto comp_trans = static_cast<ComponentTransform*>(base_ent->GetComponent(ComponentType_Transform));
+  if (comp_trans) {
+    comp_trans->DetachFromParent();
+    comp_trans->DetachChildren();
   }
-  auto base_ent = dynamic_cast<Entity*>(ent);
-  base_ent->DecRef();
+
+  base_ent->SetScene(nullptr);
+  // the removal log takes over the reference
+  _removed_entities.push_back({ ent_id, base_ent->GetMask(), GetChangeTick(), base_ent });
 
   return true;
 }
@@ -154,11 +214,29 @@ void Scene::Logic() {
   
 }
 
+void Scene::OnEntityChanged(Entity* ent) {
+  _storage.Move(ent);
+  MarkComponentsChanged(ent);
+}
+
+QueryState* Scene::GetQueryState(ComponentMask mask) {
+  std::lock_guard<std::mutex> lock(_queries_mutex);
+  auto query_itr = _queries.find(mask);
+  if (query_itr != _queries.end()) {
+    return query_itr->second;
+  }
+
+  auto query = new QueryState(mask);
+  _queries[mask] = query;
+  _storage.RegisterQuery(query);
+  return query;
+}
+
 std::vector<IEntity *> Scene::GetEntitiesByType(ComponentType type) {
   std::vector<IEntity *> res;
-  for (auto const &ent : _entity_tag_list[type]) {
-    res.push_back(ent.second);
-  }
+  _storage.ForEach(ComponentBit(type), [&res](const Archetype& arch) {
+    res.insert(res.end(), arch.GetEntities(), arch.GetEntities() + arch.Size());
+  });
 
   return res;
 }
@@ -175,27 +253,42 @@ Entity* Scene::GetEntitiesById(uint64_t ent_id)
 std::vector<Entity*> Scene::GetEntitiesByTypeExt(int type)
 {
   std::vector<Entity*> res;
-  for (auto const& ent : _entity_tag_list[type]) {
-    res.push_back(dynamic_cast<Entity*>(ent.second));
+  if (type <= ComponentType_Unknown || type >= ComponentType_MAX) {
+    return res;
   }
+  _storage.ForEach(ComponentBit(type), [&res](const Archetype& arch) {
+    res.insert(res.end(), arch.GetEntities(), arch.GetEntities() + arch.Size());
+  });
 
   return res;
 }
 
 std::vector<System*> Scene::GetSystems()
 {
-  static std::unordered_map<SystemType, int> sys_priority = {
-    {SystemType_Physics, -1},
-    {SystemType_SyncRender, 100 },
-  };
-  std::vector<System*> res;
-  for (auto& sys : _systems) {
-    res.push_back(sys.second);
-  }
-  std::sort(res.begin(), res.end(), [](const System* a, const System* b) {
-    return sys_priority[a->GetSystemType()] < sys_priority[b->GetSystemType()];
+  return _system_order;
+}
+
+void Scene::TickSystems(float dt)
+{
+  // drop removals every reader has seen during the previous tick
+  auto prune_tick = _removed_prune_tick;
+  auto removed_end = std::remove_if(_removed_entities.begin(), _removed_entities.end(),
+    [prune_tick](RemovedEntity& removed) {
+      if (removed.tick >= prune_tick) {
+        return false;
+      }
+      removed.ent->DecRef();
+      return true;
     });
-  return res;
+  _removed_entities.erase(removed_end, _removed_entities.end());
+  _removed_prune_tick = AdvanceChangeTick() + 1;
+
+  if (_schedule_dirty) {
+    _scheduler.Build(_system_order);
+    _schedule_dirty = false;
+  }
+
+  _scheduler.Run(dt, World::GetInstance().GetJobSystem());
 }
 
 BIND_CLS_FUNC_DEFINE(Scene, GetEntityCount)
@@ -207,6 +300,7 @@ BIND_CLS_FUNC_DEFINE(Scene, SetActiveCamera)
 BIND_CLS_FUNC_DEFINE(Scene, SetIBLPath)
 BIND_CLS_FUNC_DEFINE(Scene, GetEntitiesByTypeExt)
 BIND_CLS_FUNC_DEFINE(Scene, GetSystems)
+BIND_CLS_FUNC_DEFINE(Scene, TickSystems)
 
 static PyMethodDef type_methods[] = {
   {"get_entity_count", BIND_CLS_FUNC_NAME(Scene, GetEntityCount), METH_NOARGS, 0},
@@ -218,6 +312,7 @@ static PyMethodDef type_methods[] = {
   {"SetIBLPath", BIND_CLS_FUNC_NAME(Scene, SetIBLPath), METH_VARARGS, 0},
   {"GetEntitiesByType", BIND_CLS_FUNC_NAME(Scene, GetEntitiesByTypeExt), METH_VARARGS, 0},
   {"GetSystems", BIND_CLS_FUNC_NAME(Scene, GetSystems), METH_NOARGS, 0},
+  {"TickSystems", BIND_CLS_FUNC_NAME(Scene, TickSystems), METH_VARARGS, 0},
   {0, nullptr, 0, 0},
 }; 
 
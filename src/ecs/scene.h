@@ -1,16 +1,30 @@
 #pragma once
 #include <cstdint>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
 #include <PxPhysicsAPI.h>
 
 #include "component.h"
+#include "physx_dispatcher.h"
 #include "entity_base.h"
+#include "archetype.h"
+#include "query.h"
 #include "system_scene.h"
+#include "system_scheduler.h"
 #include "pybind/pyobject.h"
 
 namespace ECS {
+
+struct RemovedEntity {
+  uint64_t id;
+  ComponentMask mask;
+  uint32_t tick;
+  // still referenced so readers can clean up what the components own
+  Entity* ent;
+};
+
 class Scene : public BindObject {
 public:
   DECLEAR_PYCXX_OBJECT_TYPE(Scene);
@@ -22,6 +36,8 @@ public:
 
   bool AddSystem(System *sys);
   bool DelSystem(SystemType sys_type);
+  // run every system once, stages are rebuilt when systems change
+  void TickSystems(float dt);
 
   bool AddEntity(Entity *ent);
   bool DelEntity(uint64_t ent_id);
@@ -35,6 +51,21 @@ public:
   std::vector<Entity*> GetEntitiesByTypeExt(int type);
   std::vector<System*> GetSystems();
 
+  // dense per-archetype component columns
+  const ArchetypeStorage& GetStorage() const { return _storage; }
+  void OnEntityChanged(Entity* ent);
+
+  // cached view of entities having all of Ts, iterating it never allocates.
+  // Safe from systems running on workers.
+  template<typename... Ts>
+  ECS::Query<Ts...> Query() {
+    return ECS::Query<Ts...>(GetQueryState(ECS::Query<Ts...>::Mask));
+  }
+  QueryState* GetQueryState(ComponentMask mask);
+
+  // entities deleted recently, kept for at least one full TickSystems
+  const std::vector<RemovedEntity>& GetRemovedEntities() const { return _removed_entities; }
+
   void SetActiveCamera(uint64_t ent_id) { _active_camera = ent_id; }
   uint64_t GetActiveCamera() { return _active_camera; }
 
@@ -45,14 +76,23 @@ public:
 
 private:
   physx::PxScene* _px_scene;
-  physx::PxDefaultCpuDispatcher* _px_dispatcher;
+  PhysxJobDispatcher* _px_dispatcher;
 
 private:
   // id -> entity
   std::unordered_map<uint64_t, IEntity *> _entities;
-  std::unordered_map<uint64_t, IEntity *> _entity_tag_list[ComponentType_MAX];
+  ArchetypeStorage _storage;
+  std::unordered_map<ComponentMask, QueryState*> _queries;
+  // queries are created lazily by systems ticking on any thread
+  std::mutex _queries_mutex;
+  std::vector<RemovedEntity> _removed_entities;
+  uint32_t _removed_prune_tick;
 
   std::unordered_map<SystemType, System *> _systems;
+  // priority order, insertion order among equal priorities
+  std::vector<System *> _system_order;
+  SystemScheduler _scheduler;
+  bool _schedule_dirty;
 
   uint64_t _active_camera;
   std::string _ibl_hdr_path;
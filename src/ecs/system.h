@@ -10,6 +10,9 @@ enum SystemType {
   SystemType_Rotate,
   SystemType_SyncRender,
   SystemType_Physics,
+  // scripted
+  SystemType_HitObject,
+  SystemType_Transform,
   SystemType_MAX,
 };
 
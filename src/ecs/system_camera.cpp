@@ -5,10 +5,13 @@
 #include "component_camera.h"
 #include "component_trans.h"
 #include "entity_base.h"
+#include "scene.h"
 #include "world.h"
+#include "core/profiler.h"
 
 namespace ECS {
 void SystemCamera::Tick(float dt) {
+  PROFILE_SCOPE("SystemCamera::Tick");
   auto &world = World::GetInstance();
 
   auto& input = world.ctx.input;
@@ -20,26 +23,19 @@ void SystemCamera::Tick(float dt) {
   bool APressed = (input.A_Status == GLFW_PRESS);
   bool DPressed = (input.D_Status == GLFW_PRESS);
 
-  auto ents = _scene->GetEntitiesByType(ComponentType_Camera);
-
-  for (auto &ent : ents) {
-    auto base_ent = dynamic_cast<Entity*>(ent);
-    auto comp_cam = dynamic_cast<ComponentCamera*>(base_ent->GetComponent(ComponentType_Camera));
-
-    if (comp_cam->IsLocked()) {
-      continue;
+  _scene->Query<ComponentTransform, ComponentCamera>().Each([&](ComponentTransform& comp_trans, ComponentCamera& comp_cam) {
+    if (comp_cam.IsLocked()) {
+      return;
     }
 
-    auto comp_trans = dynamic_cast<ComponentTransform*>(base_ent->GetComponent(ComponentType_Transform));
-
     // update pos
     const float camera_speed = dt * 10.0f;
-    auto view = comp_cam->GetView();
+    auto view = comp_cam.GetView();
     view = glm::inverse(view);
 
     auto forward = glm::normalize(view * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f));
     auto right = glm::normalize(view * glm::vec4(1.0f, 0.0f, 0.0f, 0.0f));
-    auto cam_pos = comp_trans->GetPosition();
+    auto cam_pos = comp_trans.GetPosition();
     if (WPressed) {
       cam_pos += glm::vec3(forward * camera_speed);
     }
@@ -52,12 +48,12 @@ void SystemCamera::Tick(float dt) {
     if (DPressed) {
       cam_pos += glm::vec3(right * camera_speed);
     }
-    comp_trans->SetPosition(cam_pos);
+    comp_trans.SetPosition(cam_pos);
 
     // update yaw/pitch
-    comp_cam->SetYaw(comp_cam->GetYaw() + delta_x);
-    comp_cam->SetPitch(comp_cam->GetPitch() - delta_y);
-  }
+    comp_cam.SetYaw(comp_cam.GetYaw() + delta_x);
+    comp_cam.SetPitch(comp_cam.GetPitch() - delta_y);
+  });
 }
 
 void SystemCamera::Start() {
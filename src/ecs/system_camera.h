@@ -4,7 +4,10 @@
 namespace ECS {
 class SystemCamera : public System {
 public:
-  SystemCamera() : System(SystemType_Camera) {}
+  SystemCamera() : System(SystemType_Camera) {
+    Writes(ComponentType_Transform);
+    Writes(ComponentType_Camera);
+  }
 
   void Tick(float dt) override;
   void Start() override;
@@ -2,9 +2,11 @@
 
 #include "system_input.h"
 #include "world.h"
+#include "core/profiler.h"
 
 namespace ECS {
 void SystemInput::Tick(float dt) {
+  PROFILE_SCOPE("SystemInput::Tick");
   auto &world = World::GetInstance();
   auto& input = world.ctx.input;
 
@@ -4,7 +4,10 @@
 namespace ECS {
 class SystemInput : public System {
 public:
-  SystemInput() : System(SystemType_Input) {}
+  SystemInput() : System(SystemType_Input) {
+    // reads the window input state, no components
+    SetMainThread(true);
+  }
 
   void Tick(float dt) override;
   void Start() override;
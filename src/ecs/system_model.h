@@ -4,7 +4,11 @@
 namespace ECS {
 class SystemModel : public System {
 public:
-  SystemModel() : System(SystemType_Model) {}
+  SystemModel() : System(SystemType_Model) {
+    Writes(ComponentType_Model);
+    // creates gl resources
+    SetMainThread(true);
+  }
 
   void Tick(float dt) override;
   void Start() override{};
@@ -3,18 +3,20 @@
 #include "world.h"
 #include "component_trans.h"
 #include "component_physics.h"
+#include "core/profiler.h"
 
 namespace ECS {
  physx::PxMaterial* gMaterial = NULL;
 
 void SystemPhysics::Tick(float dt) {
-  auto ents = _scene->GetEntitiesByTypeExt(ComponentType_Physics);
-  for (auto ent : ents) {
-    auto comp_physics = dynamic_cast<ComponentPhysics*>(ent->GetComponent(ComponentType_Physics));
-    if (!comp_physics->IsLoaded()) {
+  PROFILE_SCOPE("SystemPhysics::Tick");
+  auto query = _scene->Query<ComponentTransform, ComponentPhysics>();
+
+  query.Each([this](Entity* ent, ComponentTransform& comp_trans, ComponentPhysics& comp_physics) {
+    if (!comp_physics.IsLoaded()) {
       LoadBody(ent);
     }
-  }
+  });
 
   _accumulator += dt;
   if (_accumulator < _frame_rate)
@@ -23,20 +25,21 @@ void SystemPhysics::Tick(float dt) {
   }
   _accumulator -= _frame_rate;
 
-  _scene->GetPxScene()->simulate(_frame_rate);
-  _scene->GetPxScene()->fetchResults(true);
-
-  for (auto ent : ents) {
-    auto comp_physics = dynamic_cast<ComponentPhysics*>(ent->GetComponent(ComponentType_Physics));
-    auto comp_trans = dynamic_cast<ComponentTransform*>(ent->GetComponent(ComponentType_Transform));
+  {
+    PROFILE_SCOPE("PxScene::simulate");
+    _scene->GetPxScene()->simulate(_frame_rate);
+  }
+  {
+    PROFILE_SCOPE("PxScene::fetchResults");
+    _scene->GetPxScene()->fetchResults(true);
+  }
 
-    if (!comp_physics->IsKinematic()) {
-      auto px_pos = comp_physics->GetPosition();
-      auto px_quat = comp_physics->GetRotation();
-      comp_trans->SetPosition(px_pos);
-      comp_trans->SetRotation(px_quat);
+  query.Each([](ComponentTransform& comp_trans, ComponentPhysics& comp_physics) {
+    // sleeping bodies did not move, keep their transforms unchanged
+    if (!comp_physics.IsKinematic() && !comp_physics.IsSleeping()) {
+      comp_trans.SetWorldPose(comp_physics.GetPosition(), comp_physics.GetRotation());
     }
-  }
+  });
 }
 void SystemPhysics::Start()
 {
@@ -59,8 +62,8 @@ static physx::PxShape* CreateShape(physx::PxPhysics* physics, const glm::vec3& s
 
 void SystemPhysics::LoadBody(Entity* ent)
 {
-  auto comp_trans = dynamic_cast<ComponentTransform*>(ent->GetComponent(ComponentType_Transform));
-  auto comp_physics = dynamic_cast<ComponentPhysics*>(ent->GetComponent(ComponentType_Physics));
+  auto comp_trans = static_cast<ComponentTransform*>(ent->GetComponent(ComponentType_Transform));
+  auto comp_physics = static_cast<ComponentPhysics*>(ent->GetComponent(ComponentType_Physics));
 
   auto trans = comp_trans->GetPosition();
   auto scale = comp_physics->GetGeoSize();
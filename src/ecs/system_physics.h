@@ -10,7 +10,11 @@ public:
     : System(SystemType_Physics)
     , _accumulator(0.0f)
     , _frame_rate(1.0 / 60.0f)
-  {}
+  {
+    Writes(ComponentType_Transform);
+    Writes(ComponentType_Physics);
+    SetMainThread(true);
+  }
 
   void Tick(float dt) override;
   void Start() override;
@@ -1,5 +1,6 @@
 #include "system_scene.h"
 
+#include "core/profiler.h"
 #include "pybind/pybind.h"
 #include "scene.h"
 
@@ -9,6 +10,41 @@ namespace ECS {
     return _scene;
   }
 
+  bool System::IsScripted() const
+  {
+    auto self = const_cast<System*>(this);
+    auto pyobj = self->GetPyObj();
+    return pyobj && Py_TYPE(pyobj) != self->GetRealType();
+  }
+
+  bool System::ConflictsWith(const System* other) const
+  {
+    // scripted systems may touch anything
+    if (IsScripted() || other->IsScripted()) {
+      return true;
+    }
+    if (_write_mask & (other->_read_mask | other->_write_mask)) {
+      return true;
+    }
+    return (other->_write_mask & _read_mask) != 0;
+  }
+
+  void System::RunTick(float dt)
+  {
+    if (!IsScripted()) {
+      Tick(dt);
+      return;
+    }
+
+    PROFILE_SCOPE("System::ScriptTick");
+    auto res = PyObject_CallMethod((PyObject*)GetPyObj(), "tick", "f", dt);
+    if (!res) {
+      PyErr_Print();
+      return;
+    }
+    Py_DECREF(res);
+  }
+
   BIND_CLS_FUNC_DEFINE(System, ScriptTick);
   BIND_CLS_FUNC_DEFINE(System, ScriptStart);
   BIND_CLS_FUNC_DEFINE(System, ScriptStop);
@@ -1,5 +1,6 @@
 #pragma once
 #include "system.h"
+#include "component.h"
 
 #include "pybind/pyobject.h"
 
@@ -9,7 +10,13 @@ class Scene;
 class System : public ISystem, public BindObject {
 public:
   DECLEAR_PYCXX_OBJECT_TYPE(System)
-  System(int type) : _scene(nullptr), _type(static_cast<SystemType>(type)) {}
+  System(int type)
+    : _scene(nullptr)
+    , _type(static_cast<SystemType>(type))
+    , _read_mask(0)
+    , _write_mask(0)
+    , _main_thread(false)
+  {}
 
   virtual void Tick(float dt) {};
   virtual void Start() {};
@@ -31,10 +38,29 @@ public:
   void SetScene(Scene* scn) { _scene = scn; }
   Scene* GetScene();
 
+  // component access used by the scene scheduler
+  ComponentMask GetReadMask() const { return _read_mask; }
+  ComponentMask GetWriteMask() const { return _write_mask; }
+  bool IsMainThread() const { return _main_thread || IsScripted(); }
+  bool ConflictsWith(const System* other) const;
+
+  // subclassed in python, ticks through the python "tick" method
+  bool IsScripted() const;
+  void RunTick(float dt);
+
+protected:
+  void Reads(ComponentType type) { _read_mask |= ComponentBit(type); }
+  void Writes(ComponentType type) { _write_mask |= ComponentBit(type); }
+  // needs GL, python or other main thread only state
+  void SetMainThread(bool enable) { _main_thread = enable; }
+
 protected:
   Scene *_scene;
 
 private:
   SystemType _type;
+  ComponentMask _read_mask;
+  ComponentMask _write_mask;
+  bool _main_thread;
 };
 } // namespace ECS
@@ -0,0 +1,58 @@
+#include "system_scheduler.h"
+
+#include <algorithm>
+
+#include "system_scene.h"
+#include "core/job_system.h"
+
+namespace ECS {
+
+void SystemScheduler::Build(const std::vector<System*>& systems)
+{
+  _stages.clear();
+
+  std::vector<size_t> sys_stage(systems.size(), 0);
+  for (size_t i = 0; i < systems.size(); i++) {
+    size_t stage = 0;
+    for (size_t j = 0; j < i; j++) {
+      if (systems[i]->ConflictsWith(systems[j])) {
+        stage = std::max(stage, sys_stage[j] + 1);
+      }
+    }
+
+    sys_stage[i] = stage;
+    if (_stages.size() <= stage) {
+      _stages.resize(stage + 1);
+    }
+    _stages[stage].push_back(systems[i]);
+  }
+}
+
+void SystemScheduler::Run(float dt, core::JobSystem& jobs)
+{
+  std::vector<core::JobHandle> handles;
+  for (auto& stage : _stages) {
+    if (stage.size() == 1) {
+      stage[0]->RunTick(dt);
+      continue;
+    }
+
+    handles.clear();
+    for (auto sys : stage) {
+      if (!sys->IsMainThread()) {
+        handles.push_back(jobs.Schedule([sys, dt]() {
+          sys->Tick(dt);
+        }));
+      }
+    }
+
+    for (auto sys : stage) {
+      if (sys->IsMainThread()) {
+        sys->RunTick(dt);
+      }
+    }
+
+    jobs.WaitAll(handles);
+  }
+}
+} // namespace ECS
@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+
+namespace core {
+class JobSystem;
+}
+
+namespace ECS {
+class System;
+
+// Splits systems into stages from their declared component access. A
+// system is placed after every earlier system it conflicts with, systems
+// sharing a stage run concurrently: main thread ones inline, the rest on
+// the job system.
+class SystemScheduler {
+public:
+  void Build(const std::vector<System*>& systems);
+  void Run(float dt, core::JobSystem& jobs);
+
+  const std::vector<std::vector<System*>>& GetStages() const { return _stages; }
+
+private:
+  std::vector<std::vector<System*>> _stages;
+};
+} // namespace ECS
@@ -5,16 +5,38 @@
 #include "component_model.h"
 #include "component_trans.h"
 #include "entity_base.h"
+#include "scene.h"
 
+#include "core/profiler.h"
 #include "render/render.h"
 #include "render/resource_mgr.h"
 
 namespace ECS {
+  static render::RenderItem MakeRenderItem(Entity* ent, ComponentTransform& comp_trans, ComponentModel& comp_model)
+  {
+    render::RenderItem item;
+    item.obj_id = ent->GetID();
+    item.transform = comp_trans.GetTransform();
+    item.last_trans = item.transform;
+    item.mesh = comp_model.model_id;
+    item.albedo = comp_model.albedo_id;
+    item.normal = comp_model.normal_id;
+    item.metalic = comp_model.metalic_id;
+    item.roughness = comp_model.roughness_id;
+    item.ao = comp_model.ao_id;
+    return item;
+  }
+
   void SystemSyncRender::Tick(float dt)
   {
+    PROFILE_SCOPE("SystemSyncRender::Tick");
+    auto since = _synced_tick;
+    _synced_tick = AdvanceChangeTick();
+
     UpdateCameraTrans();
-    UpdateLights();
-    UpdateObjects();
+    RemoveDeleted(since);
+    UpdateLights(since);
+    UpdateObjects(since);
   }
   void SystemSyncRender::Start()
   {
@@ -40,73 +62,89 @@ namespace ECS {
       auto projection = cam_comp->GetProjection();
 
       auto& render = render::Render::GetInstance();
-      render.SetCameraTrans(view, projection, trans_comp->GetPosition());
+      render.SetCameraTrans(view, projection, trans_comp->GetWorldPosition());
     }
   }
 
-  void SystemSyncRender::UpdateObjects()
+  void SystemSyncRender::RemoveDeleted(uint32_t since)
   {
     auto& render = render::Render::GetInstance();
-    render.ClearRenderItem();
-
-    auto model_ents = _scene->GetEntitiesByType(ComponentType_Model);
-    for (const auto& model_ent : model_ents) {
-      auto base_ent = dynamic_cast<Entity*>(model_ent);
-      auto comp_trans = dynamic_cast<ComponentTransform*>(
-        base_ent->GetComponent(ComponentType_Transform));
-      auto comp_model = dynamic_cast<ComponentModel*>(
-        base_ent->GetComponent(ComponentType_Model));
-
-      render::RenderItem item;
-      item.obj_id = model_ent->GetID();
-      item.transform = comp_trans->GetTransform();
-      item.mesh = comp_model->model_id;
-      item.albedo = comp_model->albedo_id;
-      item.normal = comp_model->normal_id;
-      item.metalic = comp_model->metalic_id;
-      item.roughness = comp_model->roughness_id;
-      item.ao = comp_model->ao_id;
-      item.last_trans = comp_trans->GetLastTrans();
-      render.AddRenderItem(item);
-
-      comp_trans->UpdateLastTrans();
+
+    for (auto& removed : _scene->GetRemovedEntities()) {
+      if (removed.tick <= since) {
+        continue;
+      }
+
+      auto comp_model = static_cast<ComponentModel*>(removed.ent->GetComponent(ComponentType_Model));
+      if (comp_model) {
+        render.DestroyRenderItem(comp_model->render_item);
+        comp_model->render_item = render::RenderItemHandle();
+      }
+
+      auto comp_light = static_cast<ComponentLight*>(removed.ent->GetComponent(ComponentType_Light));
+      if (comp_light) {
+        render.DestroyPointLight(comp_light->point_light);
+        render.DestroyDirectionLight(comp_light->direction_light);
+        comp_light->point_light = render::PointLightHandle();
+        comp_light->direction_light = render::DirectionLightHandle();
+      }
     }
+  }
 
+  void SystemSyncRender::UpdateObjects(uint32_t since)
+  {
+    auto& render = render::Render::GetInstance();
+
+    auto query = _scene->Query<ComponentTransform, ComponentModel>();
+    query.EachChanged(since, [&](Entity* ent, ComponentTransform& comp_trans, ComponentModel& comp_model) {
+      if (!comp_model.render_item.IsValid()) {
+        comp_model.render_item = render.CreateRenderItem(MakeRenderItem(ent, comp_trans, comp_model));
+        return;
+      }
+
+      if (comp_model.ChangedSince(since)) {
+        render.UpdateRenderItem(comp_model.render_item, MakeRenderItem(ent, comp_trans, comp_model));
+      }
+      if (comp_trans.ChangedSince(since)) {
+        render.UpdateTransform(comp_model.render_item, comp_trans.GetTransform());
+      }
+    });
   }
-  void SystemSyncRender::UpdateLights()
+
+  void SystemSyncRender::UpdateLights(uint32_t since)
   {
     auto& render = render::Render::GetInstance();
-    render.ClearPointLight();
-    render.ClearDirectionLight();
-
-    auto light_ents = _scene->GetEntitiesByType(ComponentType_Light);
-    for (const auto& light_ent : light_ents) {
-      auto base_ent = dynamic_cast<Entity*>(light_ent);
-      auto comp_trans = dynamic_cast<ComponentTransform*>(
-        base_ent->GetComponent(ComponentType_Transform));
-      auto comp_light = dynamic_cast<ComponentLight*>(
-        base_ent->GetComponent(ComponentType_Light));
-
-      if (comp_light->GetLightType() == LightType_Point) {
-        render::RenderPointLight point_light;
 
-        point_light.light_id = base_ent->GetID();
-        point_light.position = comp_trans->GetPosition();
-        point_light.color = comp_light->GetLightParam().diffuse;
-        point_light.enable_shadow = comp_light->IsShadowEnabled();
-        point_light.radius = comp_light->GetRadius();
+    auto query = _scene->Query<ComponentTransform, ComponentLight>();
+    query.EachChanged(since, [&render](Entity* ent, ComponentTransform& comp_trans, ComponentLight& comp_light) {
+      if (comp_light.GetLightType() == LightType_Point) {
+        render::RenderPointLight point_light;
 
-        render.AddPointLight(point_light);
-      } else if (comp_light->GetLightType() == LightType_Direction) {
+        point_light.light_id = ent->GetID();
+        point_light.position = comp_trans.GetWorldPosition();
+        point_light.color = comp_light.GetLightParam().diffuse;
+        point_light.enable_shadow = comp_light.IsShadowEnabled();
+        point_light.radius = comp_light.GetRadius();
+
+        if (comp_light.point_light.IsValid()) {
+          render.UpdatePointLight(comp_light.point_light, point_light);
+        } else {
+          comp_light.point_light = render.CreatePointLight(point_light);
+        }
+      } else if (comp_light.GetLightType() == LightType_Direction) {
         render::RenderDirectionLight direction_light;
 
-        direction_light.light_id = base_ent->GetID();
-        direction_light.direction = glm::mat3(comp_trans->GetTransform()) * glm::vec3(0.0f, 0.0f, 1.0f);
-        direction_light.color = comp_light->GetLightParam().diffuse;
-        direction_light.enable_shadow = comp_light->IsShadowEnabled();
+        direction_light.light_id = ent->GetID();
+        direction_light.direction = glm::mat3(comp_trans.GetTransform()) * glm::vec3(0.0f, 0.0f, 1.0f);
+        direction_light.color = comp_light.GetLightParam().diffuse;
+        direction_light.enable_shadow = comp_light.IsShadowEnabled();
 
-        render.AddDirectionLight(direction_light);
+        if (comp_light.direction_light.IsValid()) {
+          render.UpdateDirectionLight(comp_light.direction_light, direction_light);
+        } else {
+          comp_light.direction_light = render.CreateDirectionLight(direction_light);
+        }
       }
-    }
+    });
   }
 } // namespace ECS
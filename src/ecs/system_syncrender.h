@@ -4,7 +4,13 @@
 namespace ECS {
 class SystemSyncRender : public System {
 public:
-  SystemSyncRender() : System(SystemType_SyncRender) {}
+  SystemSyncRender() : System(SystemType_SyncRender), _synced_tick(0) {
+    Reads(ComponentType_Camera);
+    Reads(ComponentType_Model);
+    Reads(ComponentType_Light);
+    Reads(ComponentType_Transform);
+    SetMainThread(true);
+  }
 
   void Tick(float dt) override;
   void Start() override;
@@ -12,7 +18,12 @@ public:
 
 private:
   void UpdateCameraTrans();
-  void UpdateObjects();
-  void UpdateLights();
+  void UpdateObjects(uint32_t since);
+  void UpdateLights(uint32_t since);
+  void RemoveDeleted(uint32_t since);
+
+private:
+  // change tick closed by the last sync
+  uint32_t _synced_tick;
 };
 } // namespace ECS
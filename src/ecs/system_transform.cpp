@@ -0,0 +1,54 @@
+#include "system_transform.h"
+#include "scene.h"
+#include "world.h"
+#include "component_trans.h"
+#include "core/profiler.h"
+
+namespace ECS {
+
+void SystemTransform::ComposeLocals() {
+  _dirty.clear();
+  _trs.Clear();
+  _scene->Query<ComponentTransform>().Each([this](ComponentTransform& comp_trans) {
+    if (comp_trans.IsLocalDirty()) {
+      auto pos = comp_trans.GetPosition();
+      auto rot = comp_trans.GetRotation();
+      auto scale = comp_trans.GetScale();
+      float quat[4] = { rot.x, rot.y, rot.z, rot.w };
+      _trs.Push(&pos.x, quat, &scale.x);
+      _dirty.push_back(&comp_trans);
+    }
+  });
+
+  size_t count = _dirty.size();
+  if (!count) {
+    return;
+  }
+
+  _locals.resize(count);
+  auto arrays = _trs.GetArrays();
+  World::GetInstance().GetJobSystem().ParallelFor(count, 1024, [this, &arrays](size_t begin, size_t end) {
+    core::TRSArrays part = arrays;
+    for (auto channel : { &part.tx, &part.ty, &part.tz, &part.qx, &part.qy, &part.qz, &part.qw, &part.sx, &part.sy, &part.sz }) {
+      *channel += begin;
+    }
+    core::ComposeTRS(part, &_locals[begin][0][0], end - begin);
+  });
+
+  for (size_t i = 0; i < count; i++) {
+    _dirty[i]->StoreLocalTransform(_locals[i]);
+  }
+}
+
+void SystemTransform::Tick(float dt) {
+  PROFILE_SCOPE("SystemTransform::Tick");
+  ComposeLocals();
+
+  // parents are refreshed on demand, so the iteration order does not matter
+  _scene->Query<ComponentTransform>().Each([](ComponentTransform& comp_trans) {
+    if (comp_trans.IsWorldDirty()) {
+      comp_trans.UpdateWorld();
+    }
+  });
+}
+} // namespace ECS
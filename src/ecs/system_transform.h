@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "system_scene.h"
+#include "core/simd_transform.h"
+
+namespace ECS {
+class ComponentTransform;
+
+// Refreshes cached world matrices after gameplay and physics moved things,
+// so later readers only get clean transforms. Dirty local matrices are
+// composed in one SIMD batch first.
+class SystemTransform : public System {
+public:
+  SystemTransform() : System(SystemType_Transform) {
+    Writes(ComponentType_Transform);
+  }
+
+  void Tick(float dt) override;
+  void Start() override{};
+  void Stop() override{};
+
+private:
+  void ComposeLocals();
+
+private:
+  std::vector<ComponentTransform*> _dirty;
+  core::TRSBuffer _trs;
+  std::vector<glm::mat4> _locals;
+};
+} // namespace ECS
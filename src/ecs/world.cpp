@@ -1,4 +1,6 @@
 #include "world.h"
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 
 #include <PxPhysicsAPI.h>
@@ -10,6 +12,7 @@
 #include <glm/gtx/euler_angles.hpp>
 
 #include "python_ecs.h"
+#include "core/profiler.h"
 #include "pybind/pybind.h"
 
 #include "render/render.h"
@@ -59,7 +62,64 @@ World::World() {
   ctx.window_width = 1920;
   ctx.window_height = 1080;
 
+  _window = nullptr;
+  _output_fbo = 0;
+  _output_rbo = 0;
   _capture_mouse = false;
+  _frame = 0;
+  _trace_key = GLFW_RELEASE;
+}
+
+static void printUsage(const char* exe) {
+  std::cout << "usage: " << exe << " [options]\n"
+    << "  --headless         render offscreen without a window (EGL surfaceless)\n"
+    << "  --frames <n>       quit after n frames\n"
+    << "  --capture <file>   save the last frame as ppm, needs --headless\n"
+    << "  --stats <file>     export pass timings, .csv or .json\n"
+    << "  --trace <file>     export profiler scopes as chrome trace json\n"
+    << "  --script <module>  python entry module, default script_main\n"
+    << "  -- <args>          everything after is passed to the script as sys.argv\n";
+}
+
+bool World::ParseArgs(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--headless") {
+      ctx.headless = true;
+    } else if (arg == "--frames" && has_value) {
+      ctx.max_frames = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--capture" && has_value) {
+      ctx.capture_path = argv[++i];
+    } else if (arg == "--stats" && has_value) {
+      ctx.stats_path = argv[++i];
+    } else if (arg == "--trace" && has_value) {
+      ctx.trace_path = argv[++i];
+    } else if (arg == "--script" && has_value) {
+      ctx.script_module = argv[++i];
+    } else if (arg == "--") {
+      ctx.script_args.assign(argv + i + 1, argv + argc);
+      break;
+    } else {
+      if (arg != "--help" && arg != "-h") {
+        std::cerr << "bad argument: " << arg << std::endl;
+      }
+      printUsage(argv[0]);
+      return false;
+    }
+  }
+
+  // a window's back buffer is undefined once swapped
+  if (!ctx.capture_path.empty() && !ctx.headless) {
+    std::cerr << "--capture needs --headless" << std::endl;
+    printUsage(argv[0]);
+    return false;
+  }
+  if (ctx.headless && !ctx.max_frames) {
+    std::cout << "headless without --frames, runs until killed" << std::endl;
+  }
+  return true;
 }
 
 void World::initPython()
@@ -67,6 +127,11 @@ void World::initPython()
   InitPython();
 }
 
+void World::initJobs()
+{
+  _job_system.Init();
+}
+
 void GLAPIENTRY
 MessageCallback(GLenum source,
   GLenum type,
@@ -81,12 +146,15 @@ MessageCallback(GLenum source,
     type, severity, message);
 }
 
-void World::initGL() {
+void World::initWindowGL() {
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   // glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
+  if (ctx.headless) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  }
 
   _window = glfwCreateWindow(ctx.window_width, ctx.window_height,
                              ctx.title.c_str(), NULL, NULL);
@@ -103,6 +171,42 @@ void World::initGL() {
 
   glfwSetCursorPosCallback(_window, mouse_callback);
   glfwSetScrollCallback(_window, scroll_callback);
+}
+
+void World::initHeadlessGL() {
+  if (!core::HeadlessContext::IsSupported()) {
+    // built without EGL, a hidden window still needs a display
+    std::cout << "no EGL in this build, using a hidden window" << std::endl;
+    initWindowGL();
+  } else {
+    if (!_headless.Init(4, 3)) {
+      throw "fail to create headless context";
+    }
+    if (!gladLoadGLLoader((GLADloadproc)core::HeadlessContext::GetProcAddress)) {
+      throw "fail to glad load gl loader\n";
+    }
+  }
+
+  // surfaceless contexts have no default framebuffer
+  glGenFramebuffers(1, &_output_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, _output_fbo);
+  glGenRenderbuffers(1, &_output_rbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, _output_rbo);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, ctx.window_width, ctx.window_height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _output_rbo);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw "fail to create offscreen framebuffer";
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, ctx.window_width, ctx.window_height);
+}
+
+void World::initGL() {
+  if (ctx.headless) {
+    initHeadlessGL();
+  } else {
+    initWindowGL();
+  }
 
   glEnable(GL_DEPTH_TEST);
   glDepthFunc(GL_LEQUAL);
@@ -112,7 +216,9 @@ void World::initGL() {
   glDebugMessageCallback(MessageCallback, 0);*/
 
   ImGui::CreateContext();
-  ImGui_ImplGlfw_InitForOpenGL(_window, true);
+  if (_window) {
+    ImGui_ImplGlfw_InitForOpenGL(_window, true);
+  }
   ImGui_ImplOpenGL3_Init("#version 330");
 }
 
@@ -125,6 +231,9 @@ void World::initPhysx() {
 
 void World::initRender()
 {
+  render::Render::GetInstance().SetJobSystem(&_job_system);
+  render::Render::GetInstance().SetOutputFramebuffer(_output_fbo);
+  render::ResourceMgr::GetInstance().SetJobSystem(&_job_system);
   render::Render::GetInstance().Init();
 }
 
@@ -134,10 +243,21 @@ void World::startScript()
 }
 
 void World::updateInput() {
+  if (!_window) {
+    return;
+  }
+
   if (glfwGetKey(_window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
     glfwSetWindowShouldClose(_window, true);
   }
 
+  auto trace_key = glfwGetKey(_window, GLFW_KEY_F11);
+  if (trace_key == GLFW_PRESS && _trace_key != GLFW_PRESS) {
+    auto path = "trace_" + std::to_string(_frame) + ".json";
+    ExportTrace(path.c_str());
+  }
+  _trace_key = trace_key;
+
   if (!IsMouseCaptured()) {
     return;
   }
@@ -160,6 +280,7 @@ void World::updateInput() {
 }
 
 void World::logic() {
+  PROFILE_SCOPE("World::logic");
   updateInput();
 
   TickPython();
@@ -168,8 +289,15 @@ void World::logic() {
 }
 
 void World::render() {
+  PROFILE_SCOPE("World::render");
   ImGui_ImplOpenGL3_NewFrame();
-  ImGui_ImplGlfw_NewFrame();
+  if (_window) {
+    ImGui_ImplGlfw_NewFrame();
+  } else {
+    auto& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(float(ctx.window_width), float(ctx.window_height));
+    io.DeltaTime = 1.0f / 60.0f;
+  }
   ImGui::NewFrame();
 
   ImGui::Begin("Contrl Panel");
@@ -180,16 +308,64 @@ void World::render() {
   if (ImGui::Button("Connet PVD")) {
     ConnectPVD();
   }
+  if (ImGui::Button("Export Trace (F11)")) {
+    auto path = "trace_" + std::to_string(_frame) + ".json";
+    ExportTrace(path.c_str());
+  }
 
   render::Render::GetInstance().DoRender();
 
   ImGui::End();
   ImGui::Render();
+
+  // offscreen frames are captured, keep the panel out of them
+  if (ctx.headless) {
+    glFlush();
+    return;
+  }
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
   glfwSwapBuffers(_window);
 }
 
+bool World::shouldClose(uint64_t frame) {
+  if (ctx.max_frames && frame >= ctx.max_frames) {
+    return true;
+  }
+  return _window && glfwWindowShouldClose(_window);
+}
+
+bool World::ExportTrace(const char* path) {
+  if (!core::Profiler::GetInstance().ExportChromeTrace(path)) {
+    std::cerr << "fail to write " << path << std::endl;
+    return false;
+  }
+  std::cout << "trace saved to " << path << std::endl;
+  return true;
+}
+
+bool World::CaptureFrame(const char* path) {
+  int width = ctx.window_width;
+  int height = ctx.window_height;
+  std::vector<unsigned char> pixels(width * height * 3);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, _output_fbo);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  fprintf(file, "P6\n%d %d\n255\n", width, height);
+  // gl rows start at the bottom
+  for (int y = height - 1; y >= 0; y--) {
+    fwrite(pixels.data() + y * width * 3, 1, width * 3, file);
+  }
+  fclose(file);
+  return true;
+}
+
 void World::ConnectPVD()
 {
   physx::PxPvdTransport* transport = physx::PxDefaultPvdSocketTransportCreate("127.0.0.1", 5425, 10);
@@ -198,6 +374,9 @@ void World::ConnectPVD()
 
 void World::ToggleMouse()
 {
+  if (!_window) {
+    return;
+  }
   _capture_mouse = !_capture_mouse;
   glfwSetInputMode(_window, GLFW_CURSOR, _capture_mouse ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
 }
@@ -217,7 +396,7 @@ std::vector<double> World::GetMoveDelta()
 
 bool World::IsMousePressed(int key)
 {
-  return glfwGetMouseButton(_window, key) == GLFW_PRESS;
+  return _window && glfwGetMouseButton(_window, key) == GLFW_PRESS;
 }
 
 void World::AddScene(Scene* scn)
@@ -227,6 +406,8 @@ void World::AddScene(Scene* scn)
 }
 
 void World::Init() {
+  PROFILE_THREAD("main");
+  initJobs();
   initPython();
   initGL();
   initPhysx();
@@ -235,15 +416,39 @@ void World::Init() {
   startScript();
 }
 
-void World::Run() {
-  uint64_t curr_frame = 0;
-  while (!glfwWindowShouldClose(_window)) {
-    logic();
+bool World::Step() {
+  if (shouldClose(_frame)) {
+    return false;
+  }
+  PROFILE_SCOPE("World::Step");
+
+  logic();
 
-    render();
+  render();
 
+  if (_window) {
     glfwPollEvents();
-    curr_frame++;
+  }
+  _frame++;
+  return true;
+}
+
+void World::Run() {
+  while (Step()) {
+  }
+
+  if (!ctx.capture_path.empty() && !CaptureFrame(ctx.capture_path.c_str())) {
+    std::cerr << "fail to write " << ctx.capture_path << std::endl;
+  }
+  if (!ctx.stats_path.empty()) {
+    // the last frames are still in flight
+    render::Render::GetInstance().GetStats().Flush();
+  }
+  if (!ctx.stats_path.empty() && !render::Render::GetInstance().ExportStats(ctx.stats_path.c_str())) {
+    std::cerr << "fail to write " << ctx.stats_path << std::endl;
+  }
+  if (!ctx.trace_path.empty()) {
+    ExportTrace(ctx.trace_path.c_str());
   }
 }
 
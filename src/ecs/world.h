@@ -5,6 +5,8 @@
 #include <PxPhysicsAPI.h>
 
 #include "scene.h"
+#include "core/headless_context.h"
+#include "core/job_system.h"
 #include "pybind/pyobject.h"
 
 struct GLFWwindow;
@@ -48,6 +50,20 @@ struct WorldContext {
   int window_width;
   int window_height;
 
+  // no window, renders into an offscreen target
+  bool headless = false;
+  // stop after this many frames, 0 runs until the window closes
+  uint64_t max_frames = 0;
+  // written when Run returns
+  std::string capture_path;
+  std::string stats_path;
+  // chrome trace of the last frames
+  std::string trace_path;
+
+  // python module with __start__ and tick, gets script_args as sys.argv
+  std::string script_module = "script_main";
+  std::vector<std::string> script_args;
+
   InputContext input;
 };
 
@@ -66,8 +82,18 @@ public:
     return _scenes[0];
   }
 
+  // false on bad arguments or --help
+  bool ParseArgs(int argc, char** argv);
   void Init();
   void Run();
+  // one frame, false once the world should close
+  bool Step();
+  uint64_t GetFrameIndex() const { return _frame; }
+
+  // last rendered frame as binary ppm
+  bool CaptureFrame(const char* path);
+  // profiler scopes as chrome trace json, also bound to F11
+  bool ExportTrace(const char* path);
 
   void ConnectPVD();
   void ToggleMouse();
@@ -81,7 +107,10 @@ public:
 private:
   World();
   void initPython();
+  void initJobs();
   void initGL();
+  void initWindowGL();
+  void initHeadlessGL();
   void initPhysx();
   void initRender();
 
@@ -90,22 +119,35 @@ private:
   void updateInput();
   void logic();
   void render();
+  bool shouldClose(uint64_t frame);
 
 public:
   physx::PxFoundation* GetFoundation() { return _foundation; }
   physx::PxPhysics* GetPhysics() { return _physics; }
   physx::PxPvd* GetPvd() { return _pvd; }
 
+  core::JobSystem& GetJobSystem() { return _job_system; }
+
 private:
   std::vector<Scene *> _scenes;
 
   GLFWwindow *_window;
 
+  // headless only, the window's framebuffer otherwise
+  core::HeadlessContext _headless;
+  unsigned int _output_fbo;
+  unsigned int _output_rbo;
+
   // physics
   physx::PxFoundation* _foundation;
   physx::PxPhysics* _physics;
   physx::PxPvd* _pvd;
 
+  // shared by systems, resource loading and physx
+  core::JobSystem _job_system;
+
   bool _capture_mouse;
+  uint64_t _frame;
+  int _trace_key;
 };
 } // namespace ECS
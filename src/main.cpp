@@ -1,7 +1,10 @@
 #include "ecs/world.h"
 
-int main() {
+int main(int argc, char** argv) {
   auto& world = ECS::World::GetInstance();
+  if (!world.ParseArgs(argc, argv)) {
+    return 1;
+  }
   world.Init();
 
   world.Run();
@@ -3,6 +3,9 @@
 #include <glm/glm.hpp>
 #include <vector>
 
+#include "bounds.h"
+#include "mesh_arena.h"
+
 namespace render {
 
   struct Vertex
@@ -34,20 +37,17 @@ namespace render {
   class Mesh
   {
   public:
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures);
+    // uploads the data into the MeshArena right away, nothing is kept on the CPU
+    Mesh(const Vertex* vertices, size_t vertex_count, const unsigned int* indices, size_t index_count, const Bounds& bounds);
+    // draws expect the MeshArena to be bound
     void Draw(Shader* shader) const;
+    const MeshRange& GetRange() const { return _range; }
+    const Bounds& GetBounds() const { return _bounds; }
 
   private:
-    void SetupMesh();
-
-  private:
-    std::vector<Vertex> _vertices;
-    std::vector<unsigned int> _indices;
-    std::vector<Texture> _textures;
-
-    unsigned int _vao;
-    unsigned int _vbo;
-    unsigned int _ebo;
+    MeshRange _range;
+    // object space, computed at import
+    Bounds _bounds;
   };
 
 }
\ No newline at end of file
@@ -36,6 +36,10 @@ namespace render {
 
   void Model::LoadModel(const char* path)
   {
+    if (LoadCache(path)) {
+      return;
+    }
+
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
 
@@ -45,29 +49,56 @@ namespace render {
       return;
     }
 
-    ProcessNode(scene->mRootNode, scene);
+    std::vector<MeshData> meshes;
+    ProcessNode(scene->mRootNode, scene, meshes);
+    if (!MeshCache::Write(path, meshes)) {
+      std::cout << "fail to write mesh cache of " << path << std::endl;
+    }
+
+    for (auto& mesh : meshes) {
+      _meshes.emplace_back(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), mesh.bounds);
+      _bounds.Expand(mesh.bounds);
+    }
+  }
+
+  bool Model::LoadCache(const char* path)
+  {
+    MeshCache cache;
+    if (!cache.Open(path)) {
+      return false;
+    }
+
+    // straight from the mapping into the buffers
+    for (size_t i = 0; i < cache.GetMeshCount(); i++) {
+      auto mesh = cache.GetMesh(i);
+      _meshes.emplace_back(mesh.vertices, mesh.vertex_count, mesh.indices, mesh.index_count, mesh.bounds);
+    }
+    _bounds = cache.GetBounds();
+    return true;
   }
 
-  void Model::ProcessNode(aiNode* node, const aiScene* scene)
+  void Model::ProcessNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& res)
   {
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
       auto ai_mesh = scene->mMeshes[node->mMeshes[i]];
-      _meshes.push_back(ProcessMesh(ai_mesh, scene));
+      res.push_back(ProcessMesh(ai_mesh, scene));
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++) {
-      ProcessNode(node->mChildren[i], scene);
+      ProcessNode(node->mChildren[i], scene, res);
     }
   }
 
-  Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+  MeshData Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
   {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    MeshData res;
+    auto& vertices = res.vertices;
+    auto& indices = res.indices;
 
+    // zeroed so missing attributes are stable in the cache
+    vertices.resize(mesh->mNumVertices, Vertex{});
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-      Vertex new_vec;
+      auto& new_vec = vertices[i];
       new_vec.Position.x = mesh->mVertices[i].x;
       new_vec.Position.y = mesh->mVertices[i].y;
       new_vec.Position.z = mesh->mVertices[i].z;
@@ -90,19 +121,16 @@ namespace render {
         new_vec.Bitangent.y = mesh->mBitangents[i].y;
         new_vec.Bitangent.z = mesh->mBitangents[i].z;
       }
-      else {
-        new_vec.TexCoords = glm::vec2(0.0f, 0.0f);
-      }
-
-      vertices.push_back(new_vec);
+      res.bounds.Expand(new_vec.Position);
     }
 
+    indices.reserve(mesh->mNumFaces * 3);
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
       for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++) {
         indices.push_back(mesh->mFaces[i].mIndices[j]);
       }
     }
 
-    return Mesh(vertices, indices, textures);
+    return res;
   }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <vector>
 #include <string>
 #include "Mesh.h"
+#include "mesh_cache.h"
 
 struct aiNode;
 struct aiMesh;
@@ -17,15 +18,21 @@ namespace render {
     Model(const char* path);
 
     void Draw(Shader* shader);
+    const std::vector<Mesh>& GetMeshes() const { return _meshes; }
+    // union of the mesh bounds, invalid when nothing was loaded
+    const Bounds& GetBounds() const { return _bounds; }
 
   private:
     void LoadModel(const char* path);
-    void ProcessNode(aiNode* node, const aiScene* scene);
-    Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene);
+    // false when there is no valid cache, then Assimp imports the source
+    bool LoadCache(const char* path);
+    void ProcessNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& res);
+    MeshData ProcessMesh(aiMesh* mesh, const aiScene* scene);
 
   private:
     std::vector<Mesh> _meshes;
     std::string _directory;
+    Bounds _bounds;
   };
 
 }
\ No newline at end of file
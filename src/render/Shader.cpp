@@ -58,6 +58,8 @@ namespace render {
     glLinkProgram(id);
 
     glDeleteShader(compute_shader);
+
+    Reflect();
   }
 
   Shader::Shader(const char* vert_path, const char* frag_path)
@@ -108,6 +110,8 @@ namespace render {
 
     glDeleteShader(vert_shader);
     glDeleteShader(frag_shader);
+
+    Reflect();
   }
 
   Shader::Shader(const char* vert_path, const char* gs_path, const char* frag_path)
@@ -143,6 +147,8 @@ namespace render {
     glDeleteShader(vert_shader);
     glDeleteShader(gs_shader);
     glDeleteShader(frag_shader);
+
+    Reflect();
   }
 
   void Shader::Use()
@@ -150,58 +156,175 @@ namespace render {
     glUseProgram(id);
   }
 
+  void Shader::Reflect()
+  {
+    char name[256];
+    int count = 0;
+
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    for (int i = 0; i < count; i++) {
+      int length = 0;
+      int size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(id, i, sizeof(name), &length, &size, &type, name);
+
+      // block members have no location
+      int location = glGetUniformLocation(id, name);
+      if (location < 0) {
+        continue;
+      }
+
+      std::string full_name(name, length);
+      UniformInfo info = { location, type, size };
+      _names.push_back(full_name);
+      _uniforms[_names.back()] = info;
+
+      // arrays are reported as "name[0]", also register "name" and every element
+      if (full_name.size() > 3 && full_name.compare(full_name.size() - 3, 3, "[0]") == 0) {
+        auto base_name = full_name.substr(0, full_name.size() - 3);
+        _names.push_back(base_name);
+        _uniforms[_names.back()] = info;
+
+        for (int elem = 1; elem < size; elem++) {
+          auto elem_name = base_name + "[" + std::to_string(elem) + "]";
+          UniformInfo elem_info = { glGetUniformLocation(id, elem_name.c_str()), type, 1 };
+          _names.push_back(elem_name);
+          _uniforms[_names.back()] = elem_info;
+        }
+      }
+    }
+
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    for (int i = 0; i < count; i++) {
+      int length = 0;
+      glGetActiveUniformBlockName(id, i, sizeof(name), &length, name);
+      _names.emplace_back(name, length);
+      _uniform_blocks[_names.back()] = i;
+    }
+
+    glGetProgramInterfaceiv(id, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &count);
+    for (int i = 0; i < count; i++) {
+      int length = 0;
+      glGetProgramResourceName(id, GL_SHADER_STORAGE_BLOCK, i, sizeof(name), &length, name);
+      _names.emplace_back(name, length);
+      _storage_blocks[_names.back()] = i;
+    }
+  }
+
+  UniformLocation Shader::GetUniform(const char* name) const
+  {
+    UniformLocation res;
+    auto info = GetUniformInfo(name);
+    if (info) {
+      res.location = info->location;
+    }
+    return res;
+  }
+
+  const UniformInfo* Shader::GetUniformInfo(const char* name) const
+  {
+    auto itr = _uniforms.find(std::string_view(name));
+    return itr != _uniforms.end() ? &itr->second : nullptr;
+  }
+
+  int Shader::GetUniformBlockIndex(const char* name) const
+  {
+    auto itr = _uniform_blocks.find(std::string_view(name));
+    return itr != _uniform_blocks.end() ? itr->second : -1;
+  }
+
+  int Shader::GetStorageBlockIndex(const char* name) const
+  {
+    auto itr = _storage_blocks.find(std::string_view(name));
+    return itr != _storage_blocks.end() ? itr->second : -1;
+  }
+
+  void Shader::BindUniformBlock(const char* name, unsigned int binding)
+  {
+    int index = GetUniformBlockIndex(name);
+    if (index >= 0) {
+      glUniformBlockBinding(id, index, binding);
+    }
+  }
+
   void Shader::SetFloat(const char* name, float value)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniform1f(param_pos, value);
+    SetFloat(GetUniform(name), value);
   }
 
   void Shader::SetInt(const char* name, int value)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniform1i(param_pos, value);
+    SetInt(GetUniform(name), value);
   }
 
   void Shader::SetUInt(const char* name, unsigned int value)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniform1ui(param_pos, value);
+    SetUInt(GetUniform(name), value);
   }
 
   void Shader::SetFM4(const char* name, const float* ptr)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniformMatrix4fv(param_pos, 1, GL_FALSE, ptr);
+    SetFM4(GetUniform(name), ptr);
   }
 
   void Shader::SetFV3(const char* name, const float* ptr)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniform3f(param_pos, ptr[0], ptr[1], ptr[2]);
+    SetFV3(GetUniform(name), ptr);
   }
 
   void Shader::SetFV2(const char* name, const float* ptr)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniform2f(param_pos, ptr[0], ptr[1]);
+    SetFV2(GetUniform(name), ptr);
   }
 
   void Shader::SetFV3(const char* name, float x, float y, float z)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniform3f(param_pos, x, y, z);
+    glUniform3f(GetUniform(name).location, x, y, z);
   }
 
   void Shader::SetFV4(const char* name, const float* ptr)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniform4f(param_pos, ptr[0], ptr[1], ptr[2], ptr[3]);
+    SetFV4(GetUniform(name), ptr);
   }
 
   void Shader::SetFV4(const char* name, float x, float y, float z, float w)
   {
-    int param_pos = glGetUniformLocation(id, name);
-    glUniform4f(param_pos, x, y, z, w);
+    glUniform4f(GetUniform(name).location, x, y, z, w);
+  }
+
+  void Shader::SetFloat(UniformLocation loc, float value)
+  {
+    glUniform1f(loc.location, value);
+  }
+
+  void Shader::SetInt(UniformLocation loc, int value)
+  {
+    glUniform1i(loc.location, value);
+  }
+
+  void Shader::SetUInt(UniformLocation loc, unsigned int value)
+  {
+    glUniform1ui(loc.location, value);
+  }
+
+  void Shader::SetFM4(UniformLocation loc, const float* ptr, int count)
+  {
+    glUniformMatrix4fv(loc.location, count, GL_FALSE, ptr);
+  }
+
+  void Shader::SetFV2(UniformLocation loc, const float* ptr, int count)
+  {
+    glUniform2fv(loc.location, count, ptr);
+  }
+
+  void Shader::SetFV3(UniformLocation loc, const float* ptr, int count)
+  {
+    glUniform3fv(loc.location, count, ptr);
+  }
+
+  void Shader::SetFV4(UniformLocation loc, const float* ptr, int count)
+  {
+    glUniform4fv(loc.location, count, ptr);
   }
 
   void Shader::Compute(unsigned int x, unsigned int y, unsigned int z)
@@ -1,7 +1,26 @@
 #pragma once
 
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
 namespace render {
 
+  // resolved once, setters taking it skip the name lookup
+  struct UniformLocation {
+    int location = -1;
+
+    bool IsValid() const { return location >= 0; }
+  };
+
+  struct UniformInfo {
+    int location;
+    // GL type and array length
+    unsigned int type;
+    int size;
+  };
+
   class Shader
   {
   public:
@@ -9,6 +28,10 @@ namespace render {
     Shader(const char* vert_path, const char* frag_path);
     Shader(const char* vert_path, const char* gs_path, const char* frag_path);
 
+    // the lookup maps point into _names
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
     void Use();
     void SetFloat(const char* name, float value);
     void SetInt(const char* name, int value);
@@ -20,12 +43,39 @@ namespace render {
     void SetFV4(const char* name, const float* ptr);
     void SetFV4(const char* name, float x, float y, float z, float w);
 
+    // reflected at link time, arrays are also listed per element ("samples[3]")
+    UniformLocation GetUniform(const char* name) const;
+    UniformLocation GetUniform(const std::string& name) const { return GetUniform(name.c_str()); }
+    const UniformInfo* GetUniformInfo(const char* name) const;
+    // -1 when the block is not active
+    int GetUniformBlockIndex(const char* name) const;
+    int GetStorageBlockIndex(const char* name) const;
+    // no-op when the program doesn't use the block
+    void BindUniformBlock(const char* name, unsigned int binding);
+
+    void SetFloat(UniformLocation loc, float value);
+    void SetInt(UniformLocation loc, int value);
+    void SetUInt(UniformLocation loc, unsigned int value);
+    void SetFM4(UniformLocation loc, const float* ptr, int count = 1);
+    void SetFV2(UniformLocation loc, const float* ptr, int count = 1);
+    void SetFV3(UniformLocation loc, const float* ptr, int count = 1);
+    void SetFV4(UniformLocation loc, const float* ptr, int count = 1);
+
     void Compute(unsigned int x, unsigned int y, unsigned int z);
 
     void Validate();
 
+  private:
+    void Reflect();
+
   private:
     unsigned int id;
+
+    // keys point into _names
+    std::deque<std::string> _names;
+    std::unordered_map<std::string_view, UniformInfo> _uniforms;
+    std::unordered_map<std::string_view, int> _uniform_blocks;
+    std::unordered_map<std::string_view, int> _storage_blocks;
   };
 
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cfloat>
+#include <glm/glm.hpp>
+
+namespace render {
+  struct Bounds {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+    void Expand(const glm::vec3& point)
+    {
+      min = glm::min(min, point);
+      max = glm::max(max, point);
+    }
+
+    void Expand(const Bounds& other)
+    {
+      min = glm::min(min, other.min);
+      max = glm::max(max, other.max);
+    }
+
+    bool Contains(const Bounds& other) const
+    {
+      return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+        max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+    }
+
+    glm::vec3 Center() const { return (min + max) * 0.5f; }
+    glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+    float SurfaceArea() const
+    {
+      auto size = max - min;
+      return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    static Bounds Union(const Bounds& a, const Bounds& b)
+    {
+      Bounds res;
+      res.min = glm::min(a.min, b.min);
+      res.max = glm::max(a.max, b.max);
+      return res;
+    }
+
+    // box around the transformed box, the extents go through |rotation * scale|
+    Bounds Transformed(const glm::mat4& trans) const
+    {
+      auto center = glm::vec3(trans * glm::vec4(Center(), 1.0f));
+      auto extents = Extents();
+      glm::vec3 new_extents(
+        glm::abs(trans[0][0]) * extents.x + glm::abs(trans[1][0]) * extents.y + glm::abs(trans[2][0]) * extents.z,
+        glm::abs(trans[0][1]) * extents.x + glm::abs(trans[1][1]) * extents.y + glm::abs(trans[2][1]) * extents.z,
+        glm::abs(trans[0][2]) * extents.x + glm::abs(trans[1][2]) * extents.y + glm::abs(trans[2][2]) * extents.z);
+
+      Bounds res;
+      res.min = center - new_extents;
+      res.max = center + new_extents;
+      return res;
+    }
+
+    bool IntersectsSphere(const glm::vec3& center, float radius) const
+    {
+      auto closest = glm::clamp(center, min, max);
+      auto delta = closest - center;
+      return glm::dot(delta, delta) <= radius * radius;
+    }
+  };
+
+  // planes point inwards, xyz normal and w distance
+  struct Frustum {
+    glm::vec4 planes[6];
+
+    // Gribb/Hartmann extraction, works for perspective and ortho projections
+    static Frustum FromMatrix(const glm::mat4& vp)
+    {
+      Frustum res;
+      for (int i = 0; i < 3; i++) {
+        for (int side = 0; side < 2; side++) {
+          float sign = side ? -1.0f : 1.0f;
+          auto& plane = res.planes[i * 2 + side];
+          plane = glm::vec4(
+            vp[0][3] + sign * vp[0][i],
+            vp[1][3] + sign * vp[1][i],
+            vp[2][3] + sign * vp[2][i],
+            vp[3][3] + sign * vp[3][i]);
+          plane /= glm::length(glm::vec3(plane));
+        }
+      }
+      return res;
+    }
+
+    bool Intersects(const Bounds& bounds) const
+    {
+      auto center = bounds.Center();
+      auto extents = bounds.Extents();
+      for (const auto& plane : planes) {
+        auto normal = glm::vec3(plane);
+        float radius = glm::dot(extents, glm::abs(normal));
+        if (glm::dot(normal, center) + plane.w < -radius) {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+}
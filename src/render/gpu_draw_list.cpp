@@ -0,0 +1,203 @@
+#include "gpu_draw_list.h"
+
+#include <algorithm>
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glad/glad.h>
+
+#include "core/profiler.h"
+
+namespace render {
+  // local_size_x of cull_cs.glsl
+  static const unsigned int cull_group_size = 64;
+
+  GpuDrawList::GpuDrawList()
+    : _view_count(0)
+    , _cull_shader(nullptr)
+    , _dirty_begin(0)
+    , _dirty_end(0)
+    , _command_count(0)
+    , _instance_count(0)
+    , _layout_dirty(false)
+    , _object_buffer(0)
+    , _batch_buffer(0)
+    , _template_buffer(0)
+    , _command_buffer(0)
+    , _instance_buffer(0)
+    , _object_capacity(0)
+    , _batch_capacity(0)
+    , _template_capacity(0)
+    , _command_capacity(0)
+    , _instance_capacity(0)
+  {
+  }
+
+  void GpuDrawList::Init(int view_count, Shader* cull_shader)
+  {
+    _view_count = view_count;
+    _cull_shader = cull_shader;
+    _u_object_count = cull_shader->GetUniform("object_count");
+    _u_command_offset = cull_shader->GetUniform("command_offset");
+    _u_planes = cull_shader->GetUniform("planes[0]");
+    _u_sphere = cull_shader->GetUniform("sphere");
+
+    if (!_object_buffer) {
+      unsigned int buffers[5];
+      glGenBuffers(5, buffers);
+      _object_buffer = buffers[0];
+      _batch_buffer = buffers[1];
+      _template_buffer = buffers[2];
+      _command_buffer = buffers[3];
+      _instance_buffer = buffers[4];
+    }
+  }
+
+  void GpuDrawList::SetObjectCount(size_t count)
+  {
+    if (count > _objects.size()) {
+      _dirty_begin = std::min(_dirty_begin, _objects.size());
+      _dirty_end = count;
+    }
+    _objects.resize(count);
+    _dirty_end = std::min(_dirty_end, count);
+  }
+
+  void GpuDrawList::SetObject(size_t idx, const GpuObject& obj)
+  {
+    _objects[idx] = obj;
+    if (_dirty_begin >= _dirty_end) {
+      _dirty_begin = idx;
+      _dirty_end = idx + 1;
+    }
+    else {
+      _dirty_begin = std::min(_dirty_begin, idx);
+      _dirty_end = std::max(_dirty_end, idx + 1);
+    }
+  }
+
+  void GpuDrawList::SetLayout(const std::vector<GpuBatch>& batches, const std::vector<DrawCommand>& commands, uint32_t instance_count)
+  {
+    _batches = batches;
+    _command_count = commands.size();
+    _instance_count = instance_count;
+
+    // every view appends behind its own base instances
+    _command_template.resize(_command_count * _view_count);
+    for (int view = 0; view < _view_count; view++) {
+      for (size_t i = 0; i < _command_count; i++) {
+        auto& command = _command_template[view * _command_count + i];
+        command = commands[i];
+        command.instance_count = 0;
+        command.base_instance += view * instance_count;
+      }
+    }
+    _layout_dirty = true;
+  }
+
+  void GpuDrawList::Reserve(unsigned int& buffer, size_t& capacity, size_t size)
+  {
+    if (size <= capacity) {
+      return;
+    }
+    capacity = std::max(size, capacity * 2);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  void GpuDrawList::Upload()
+  {
+    PROFILE_SCOPE("GpuDrawList::Upload");
+    auto object_size = _objects.size() * sizeof(GpuObject);
+    if (object_size > _object_capacity) {
+      // new storage, everything goes up again
+      Reserve(_object_buffer, _object_capacity, object_size);
+      _dirty_begin = 0;
+      _dirty_end = _objects.size();
+    }
+    if (_dirty_begin < _dirty_end) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _object_buffer);
+      glBufferSubData(GL_COPY_WRITE_BUFFER, _dirty_begin * sizeof(GpuObject),
+        (_dirty_end - _dirty_begin) * sizeof(GpuObject), _objects.data() + _dirty_begin);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    _dirty_begin = _dirty_end = 0;
+
+    if (!_layout_dirty) {
+      return;
+    }
+    _layout_dirty = false;
+
+    auto batch_size = _batches.size() * sizeof(GpuBatch);
+    auto template_size = _command_template.size() * sizeof(DrawCommand);
+    Reserve(_batch_buffer, _batch_capacity, batch_size);
+    Reserve(_template_buffer, _template_capacity, template_size);
+    Reserve(_command_buffer, _command_capacity, template_size);
+    Reserve(_instance_buffer, _instance_capacity, size_t(_instance_count) * _view_count * sizeof(uint32_t));
+
+    if (batch_size) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _batch_buffer);
+      glBufferSubData(GL_COPY_WRITE_BUFFER, 0, batch_size, _batches.data());
+    }
+    if (template_size) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _template_buffer);
+      glBufferSubData(GL_COPY_WRITE_BUFFER, 0, template_size, _command_template.data());
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  void GpuDrawList::CullFrustum(int view, const Frustum& frustum)
+  {
+    Cull(view, frustum.planes, glm::vec4(0.0f));
+  }
+
+  void GpuDrawList::CullSphere(int view, const glm::vec3& center, float radius)
+  {
+    // planes that never reject
+    glm::vec4 planes[6];
+    std::fill(planes, planes + 6, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    Cull(view, planes, glm::vec4(center, radius));
+  }
+
+  void GpuDrawList::Cull(int view, const glm::vec4* planes, const glm::vec4& sphere)
+  {
+    if (!_command_count || _objects.empty()) {
+      return;
+    }
+
+    // instance counts back to 0
+    auto offset = view * _command_count * sizeof(DrawCommand);
+    glBindBuffer(GL_COPY_READ_BUFFER, _template_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _command_buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, offset, _command_count * sizeof(DrawCommand));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    _cull_shader->Use();
+    _cull_shader->SetUInt(_u_object_count, static_cast<unsigned int>(_objects.size()));
+    _cull_shader->SetUInt(_u_command_offset, static_cast<unsigned int>(view * _command_count));
+    _cull_shader->SetFV4(_u_planes, glm::value_ptr(planes[0]), 6);
+    _cull_shader->SetFV4(_u_sphere, glm::value_ptr(sphere));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding, _object_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BatchBinding, _batch_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CommandBinding, _command_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstanceBinding, _instance_buffer);
+    _cull_shader->Compute(static_cast<unsigned int>((_objects.size() + cull_group_size - 1) / cull_group_size), 1, 1);
+    // read back as draw commands and instance attributes
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+  }
+
+  void GpuDrawList::Draw(int view, uint32_t first_command, uint32_t count)
+  {
+    if (!count) {
+      return;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding, _object_buffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _command_buffer);
+    auto offset = (view * _command_count + first_command) * sizeof(DrawCommand);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, count, sizeof(DrawCommand));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "Shader.h"
+
+namespace render {
+  // std430 mirrors of the structs in cull_cs.glsl and the vertex shaders,
+  // keep both in sync
+  struct GpuObject {
+    static constexpr uint32_t NoBatch = 0xffffffffu;
+
+    glm::mat4 model;
+    glm::mat4 last_model;
+    // object space
+    glm::vec4 bounds_min;
+    glm::vec4 bounds_max;
+    // NoBatch is never drawn
+    uint32_t batch;
+    uint32_t pad0[3];
+  };
+
+  // the draw commands of one mesh and material, one per sub mesh
+  struct GpuBatch {
+    uint32_t first_command;
+    uint32_t command_count;
+    uint32_t pad0[2];
+  };
+
+  // DrawElementsIndirectCommand
+  struct DrawCommand {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+  };
+
+  static_assert(sizeof(GpuObject) == 176, "GpuObject must match std430");
+  static_assert(sizeof(DrawCommand) == 20, "DrawCommand must match the indirect layout");
+
+  // Per object data and indirect draw commands, culled on the GPU. Every
+  // view owns a copy of the commands and of the instance list: a compute
+  // pass resets its instance counts, tests each object's bounds and
+  // appends the visible object ids behind each command's base instance.
+  // The ids are read as an instanced vertex attribute, the vertex shaders
+  // fetch the object from the ObjectList storage buffer.
+  class GpuDrawList {
+  public:
+    // storage buffer binding points, also in the shaders
+    static constexpr unsigned int ObjectBinding = 6;
+    static constexpr unsigned int BatchBinding = 7;
+    static constexpr unsigned int CommandBinding = 8;
+    static constexpr unsigned int InstanceBinding = 9;
+
+    GpuDrawList();
+
+    void Init(int view_count, Shader* cull_shader);
+
+    // objects are indexed like the dense render item table
+    void SetObjectCount(size_t count);
+    void SetObject(size_t idx, const GpuObject& obj);
+    // `instance_count` is the instances every view may append in total
+    void SetLayout(const std::vector<GpuBatch>& batches, const std::vector<DrawCommand>& commands, uint32_t instance_count);
+    // dirty objects and a changed layout, before the first Cull of a frame
+    void Upload();
+
+    void CullFrustum(int view, const Frustum& frustum);
+    // point lights, objects outside the sphere are dropped
+    void CullSphere(int view, const glm::vec3& center, float radius);
+    // `count` commands from `first_command` of `view`, the MeshArena must
+    // be bound with GetInstanceBuffer
+    void Draw(int view, uint32_t first_command, uint32_t count);
+
+    unsigned int GetInstanceBuffer() const { return _instance_buffer; }
+    size_t GetObjectCount() const { return _objects.size(); }
+    size_t GetCommandCount() const { return _command_count; }
+
+  private:
+    void Cull(int view, const glm::vec4* planes, const glm::vec4& sphere);
+    static void Reserve(unsigned int& buffer, size_t& capacity, size_t size);
+
+  private:
+    int _view_count;
+    Shader* _cull_shader;
+    UniformLocation _u_object_count;
+    UniformLocation _u_command_offset;
+    UniformLocation _u_planes;
+    UniformLocation _u_sphere;
+
+    std::vector<GpuObject> _objects;
+    // [_dirty_begin, _dirty_end) is uploaded next
+    size_t _dirty_begin;
+    size_t _dirty_end;
+
+    std::vector<GpuBatch> _batches;
+    // commands of every view, instance counts 0, copied over before culling
+    std::vector<DrawCommand> _command_template;
+    size_t _command_count;
+    uint32_t _instance_count;
+    bool _layout_dirty;
+
+    unsigned int _object_buffer;
+    unsigned int _batch_buffer;
+    unsigned int _template_buffer;
+    unsigned int _command_buffer;
+    unsigned int _instance_buffer;
+    size_t _object_capacity;
+    size_t _batch_capacity;
+    size_t _template_capacity;
+    size_t _command_capacity;
+    size_t _instance_capacity;
+  };
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace render {
+  // Generational handle, `Tag` only keeps handle types apart. Generation 0
+  // is never handed out so a default handle is invalid.
+  template<typename Tag>
+  struct Handle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return generation != 0; }
+
+    uint64_t Pack() const { return (uint64_t(generation) << 32) | index; }
+    static Handle Unpack(uint64_t packed) {
+      Handle res;
+      res.index = uint32_t(packed & 0xffffffffu);
+      res.generation = uint32_t(packed >> 32);
+      return res;
+    }
+
+    bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+    // any fixed order, for sorting
+    bool operator<(const Handle& other) const { return Pack() < other.Pack(); }
+  };
+
+  // Items live packed in one array, handles resolve through a slot array so
+  // they stay valid while other items are swap-removed.
+  template<typename T, typename Tag = T>
+  class DenseTable {
+  public:
+    typedef Handle<Tag> HandleType;
+
+    HandleType Create(const T& item)
+    {
+      return Create(T(item));
+    }
+
+    HandleType Create(T&& item)
+    {
+      uint32_t slot_idx;
+      if (_free_slots.empty()) {
+        slot_idx = static_cast<uint32_t>(_slots.size());
+        _slots.push_back({ 0, 1 });
+      } else {
+        slot_idx = _free_slots.back();
+        _free_slots.pop_back();
+      }
+
+      auto& slot = _slots[slot_idx];
+      slot.dense = static_cast<uint32_t>(_items.size());
+      _items.push_back(std::move(item));
+      _dense_slots.push_back(slot_idx);
+
+      HandleType res;
+      res.index = slot_idx;
+      res.generation = slot.generation;
+      return res;
+    }
+
+    bool Destroy(HandleType handle)
+    {
+      if (!Contains(handle)) {
+        return false;
+      }
+
+      auto& slot = _slots[handle.index];
+      uint32_t last = static_cast<uint32_t>(_items.size() - 1);
+      if (slot.dense != last) {
+        _items[slot.dense] = std::move(_items[last]);
+        _dense_slots[slot.dense] = _dense_slots[last];
+        _slots[_dense_slots[slot.dense]].dense = slot.dense;
+      }
+      _items.pop_back();
+      _dense_slots.pop_back();
+
+      // skip 0 on wrap so stale handles never become valid again
+      slot.generation = slot.generation + 1 ? slot.generation + 1 : 1;
+      _free_slots.push_back(handle.index);
+      return true;
+    }
+
+    bool Contains(HandleType handle) const
+    {
+      return handle.IsValid() && handle.index < _slots.size() &&
+        _slots[handle.index].generation == handle.generation;
+    }
+
+    T* Get(HandleType handle)
+    {
+      return Contains(handle) ? &_items[_slots[handle.index].dense] : nullptr;
+    }
+
+    const T* Get(HandleType handle) const
+    {
+      return Contains(handle) ? &_items[_slots[handle.index].dense] : nullptr;
+    }
+
+    // handle of the item stored at dense position `idx`
+    HandleType GetHandle(size_t idx) const
+    {
+      HandleType res;
+      res.index = _dense_slots[idx];
+      res.generation = _slots[res.index].generation;
+      return res;
+    }
+
+    void Clear()
+    {
+      for (size_t i = 0; i < _dense_slots.size(); i++) {
+        auto& slot = _slots[_dense_slots[i]];
+        slot.generation = slot.generation + 1 ? slot.generation + 1 : 1;
+        _free_slots.push_back(_dense_slots[i]);
+      }
+      _items.clear();
+      _dense_slots.clear();
+    }
+
+    size_t size() const { return _items.size(); }
+    bool empty() const { return _items.empty(); }
+    T* data() { return _items.data(); }
+    const T* data() const { return _items.data(); }
+    T& operator[](size_t idx) { return _items[idx]; }
+    const T& operator[](size_t idx) const { return _items[idx]; }
+
+    typename std::vector<T>::iterator begin() { return _items.begin(); }
+    typename std::vector<T>::iterator end() { return _items.end(); }
+    typename std::vector<T>::const_iterator begin() const { return _items.begin(); }
+    typename std::vector<T>::const_iterator end() const { return _items.end(); }
+
+  private:
+    struct Slot {
+      uint32_t dense;
+      uint32_t generation;
+    };
+
+    std::vector<T> _items;
+    std::vector<uint32_t> _dense_slots;
+    std::vector<Slot> _slots;
+    std::vector<uint32_t> _free_slots;
+  };
+}
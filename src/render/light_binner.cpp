@@ -0,0 +1,305 @@
+#include "light_binner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <glad/glad.h>
+
+#include "core/profiler.h"
+#include "core/simd_cull.h"
+
+namespace render {
+  // same start as LightClusters, doubled when a frame does not fit
+  static const uint32_t initial_lights_per_cluster = 16;
+  static const size_t row_chunk = 4;
+  // a copy still in use after a second is left to the driver
+  static const uint64_t fence_timeout_ns = 1000000000ull;
+
+  static size_t AlignUp(size_t value, size_t alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  LightBinner::LightBinner()
+    : _cluster_count(0)
+    , _tile_x(0)
+    , _tile_y(0)
+    , _z_slices(0)
+    , _jobs(nullptr)
+    , _scheduled(false)
+    , _buffer(0)
+    , _mapped(nullptr)
+    , _index_offset(0)
+    , _slot_size(0)
+    , _index_capacity(0)
+    , _slot(0)
+    , _write_base(nullptr)
+    , _index_count(0)
+    , _overflow_count(0)
+  {
+    std::fill(_fences, _fences + FramesInFlight, nullptr);
+  }
+
+  void LightBinner::Init(uint32_t cluster_count)
+  {
+    _cluster_count = cluster_count;
+    CreateBuffer(cluster_count * initial_lights_per_cluster);
+  }
+
+  void LightBinner::SetClusterBoxes(const std::vector<AABBBox>& boxes, uint32_t tile_x, uint32_t tile_y, uint32_t z_slices)
+  {
+    Finish();
+    _boxes = boxes;
+    _tile_x = tile_x;
+    _tile_y = tile_y;
+    _z_slices = z_slices;
+
+    // the boxes of a slice all span its two depth planes
+    _slices.resize(z_slices);
+    for (uint32_t z = 0; z < z_slices; z++) {
+      const auto& box = boxes[size_t(z) * tile_y * tile_x];
+      _slices[z].z_min = box.minPoint.z;
+      _slices[z].z_max = box.maxPoint.z;
+    }
+    _rows.resize(size_t(z_slices) * tile_y);
+  }
+
+  void LightBinner::CreateBuffer(uint32_t index_capacity)
+  {
+    DeleteBuffer();
+
+    int alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 4);
+    _index_capacity = index_capacity;
+    _index_offset = AlignUp(_cluster_count * sizeof(LightGrid), alignment);
+    _slot_size = AlignUp(_index_offset + size_t(index_capacity) * sizeof(uint32_t), alignment);
+    auto size = _slot_size * FramesInFlight;
+
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+    if (GLAD_GL_ARB_buffer_storage) {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      // dynamic storage keeps the staging upload working if mapping fails
+      glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags | GL_DYNAMIC_STORAGE_BIT);
+      _mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+    }
+    else {
+      glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    if (!_mapped) {
+      _staging.resize(_slot_size);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  void LightBinner::DeleteBuffer()
+  {
+    // frames in flight keep the old storage alive until they are done
+    for (auto& fence : _fences) {
+      if (fence) {
+        glDeleteSync(static_cast<GLsync>(fence));
+        fence = nullptr;
+      }
+    }
+    if (_mapped) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      _mapped = nullptr;
+    }
+    if (_buffer) {
+      glDeleteBuffers(1, &_buffer);
+      _buffer = 0;
+    }
+    _staging.clear();
+  }
+
+  void LightBinner::Schedule(core::JobSystem* jobs, const std::vector<PLight>& lights, const glm::mat4& view)
+  {
+    PROFILE_SCOPE("LightBinner::Schedule");
+    Finish();
+
+    // everything submitted so far includes the light pass reading the
+    // current copy, the next one was read FramesInFlight - 1 frames ago
+    if (_fences[_slot]) {
+      glDeleteSync(static_cast<GLsync>(_fences[_slot]));
+    }
+    _fences[_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _slot = (_slot + 1) % FramesInFlight;
+    if (_fences[_slot]) {
+      auto fence = static_cast<GLsync>(_fences[_slot]);
+      if (_mapped) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fence_timeout_ns);
+      }
+      glDeleteSync(fence);
+      _fences[_slot] = nullptr;
+    }
+    _write_base = _mapped ? _mapped + _slot * _slot_size : _staging.data();
+
+    // the caller may change its lights before Finish
+    auto light_count = lights.size();
+    _light_x.resize(light_count);
+    _light_y.resize(light_count);
+    _light_z.resize(light_count);
+    _light_radius.resize(light_count);
+    for (size_t i = 0; i < light_count; i++) {
+      auto pos = view * glm::vec4(lights[i].position, 1.0f);
+      _light_x[i] = pos.x;
+      _light_y[i] = pos.y;
+      _light_z[i] = pos.z;
+      _light_radius[i] = lights[i].radius;
+    }
+
+    auto bin_slices = [this](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        BinSlice(static_cast<uint32_t>(i));
+      }
+    };
+    auto bin_rows = [this](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        BinRow(static_cast<uint32_t>(i));
+      }
+    };
+    auto write_rows = [this](size_t begin, size_t end) {
+      WriteRows(begin, end);
+    };
+
+    _scheduled = true;
+    if (jobs && jobs->IsRunning()) {
+      _jobs = jobs;
+      auto slices = jobs->ScheduleParallelFor(_z_slices, 1, bin_slices);
+      auto rows = jobs->ScheduleParallelFor(_rows.size(), row_chunk, bin_rows, { slices });
+      auto offsets = jobs->Schedule([this]() { CountRows(); }, { rows });
+      _job = jobs->ScheduleParallelFor(_rows.size(), row_chunk, write_rows, { offsets });
+    }
+    else {
+      bin_slices(0, _z_slices);
+      bin_rows(0, _rows.size());
+      CountRows();
+      write_rows(0, _rows.size());
+    }
+  }
+
+  void LightBinner::Finish()
+  {
+    if (!_scheduled) {
+      return;
+    }
+    PROFILE_SCOPE("LightBinner::Finish");
+    if (_job) {
+      _jobs->Wait(_job);
+      _job.reset();
+    }
+    _scheduled = false;
+
+    if (_index_count > _index_capacity) {
+      // nothing was written, grow and write again
+      _overflow_count++;
+      auto capacity = _index_capacity;
+      while (capacity < _index_count) {
+        capacity *= 2;
+      }
+      CreateBuffer(capacity);
+      _write_base = _mapped ? _mapped + _slot * _slot_size : _staging.data();
+      WriteRows(0, _rows.size());
+    }
+
+    if (!_mapped) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+      glBufferSubData(GL_COPY_WRITE_BUFFER, _slot * _slot_size, _index_offset + size_t(_index_count) * sizeof(uint32_t),
+        _staging.data());
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+  }
+
+  void LightBinner::Bind() const
+  {
+    auto base = _slot * _slot_size;
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LightClusters::GridBinding, _buffer,
+      base, _cluster_count * sizeof(LightGrid));
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LightClusters::IndexBinding, _buffer,
+      base + _index_offset, size_t(_index_capacity) * sizeof(uint32_t));
+  }
+
+  void LightBinner::BinSlice(uint32_t slice_idx)
+  {
+    auto& slice = _slices[slice_idx];
+    auto light_count = _light_x.size();
+    const float inf = std::numeric_limits<float>::infinity();
+    float box_min[3] = { -inf, -inf, slice.z_min };
+    float box_max[3] = { inf, inf, slice.z_max };
+
+    core::SphereArrays lights = { _light_x.data(), _light_y.data(), _light_z.data(), _light_radius.data() };
+    slice.index.resize(light_count);
+    auto count = core::CullSpheresAABB(lights, light_count, box_min, box_max, slice.index.data());
+    slice.index.resize(count);
+
+    slice.x.resize(count);
+    slice.y.resize(count);
+    slice.z.resize(count);
+    slice.radius.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      auto light = slice.index[i];
+      slice.x[i] = _light_x[light];
+      slice.y[i] = _light_y[light];
+      slice.z[i] = _light_z[light];
+      slice.radius[i] = _light_radius[light];
+    }
+  }
+
+  void LightBinner::BinRow(uint32_t row_idx)
+  {
+    auto& row = _rows[row_idx];
+    const auto& slice = _slices[row_idx / _tile_y];
+    auto candidate_count = slice.index.size();
+    core::SphereArrays lights = { slice.x.data(), slice.y.data(), slice.z.data(), slice.radius.data() };
+
+    row.counts.resize(_tile_x);
+    row.indices.clear();
+    row.hits.resize(candidate_count);
+    for (uint32_t x = 0; x < _tile_x; x++) {
+      const auto& box = _boxes[size_t(row_idx) * _tile_x + x];
+      auto count = core::CullSpheresAABB(lights, candidate_count, &box.minPoint.x, &box.maxPoint.x, row.hits.data());
+      for (size_t i = 0; i < count; i++) {
+        row.indices.push_back(slice.index[row.hits[i]]);
+      }
+      row.counts[x] = static_cast<uint32_t>(count);
+    }
+  }
+
+  void LightBinner::CountRows()
+  {
+    uint32_t offset = 0;
+    for (auto& row : _rows) {
+      row.offset = offset;
+      offset += static_cast<uint32_t>(row.indices.size());
+    }
+    _index_count = offset;
+  }
+
+  void LightBinner::WriteRows(size_t begin, size_t end)
+  {
+    // Finish grows the buffer and calls again
+    if (_index_count > _index_capacity) {
+      return;
+    }
+
+    auto grids = reinterpret_cast<LightGrid*>(_write_base);
+    auto indices = reinterpret_cast<uint32_t*>(_write_base + _index_offset);
+    for (size_t i = begin; i < end; i++) {
+      const auto& row = _rows[i];
+      auto grid = grids + i * _tile_x;
+      auto offset = row.offset;
+      for (uint32_t x = 0; x < _tile_x; x++) {
+        grid[x].offset = offset;
+        grid[x].count = row.counts[x];
+        offset += row.counts[x];
+      }
+      if (!row.indices.empty()) {
+        memcpy(indices + row.offset, row.indices.data(), row.indices.size() * sizeof(uint32_t));
+      }
+    }
+  }
+}
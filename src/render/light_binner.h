@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/job_system.h"
+#include "light_clusters.h"
+
+namespace render {
+  // Point light lists of the clusters, built on the CPU while the GPU works
+  // on the shadow and gbuffer passes. Same grid and index layout as
+  // LightClusters, but every cluster gets its lights, there is no depth to
+  // tell the empty ones apart:
+  //   slices  lights are culled against the depth range of each z slice
+  //   rows    the survivors of a slice are tested against each cluster box
+  //   offsets a running sum over the rows
+  //   write   grid and indices go straight into the buffer
+  // The buffer holds FramesInFlight copies, persistently mapped when
+  // ARB_buffer_storage is there, so a copy is only rewritten once the GPU
+  // is done with the frame that read it.
+  class LightBinner {
+  public:
+    static constexpr int FramesInFlight = LightClusters::FramesInFlight;
+
+    LightBinner();
+
+    void Init(uint32_t cluster_count);
+    // view space boxes from BuildClusterBoxes
+    void SetClusterBoxes(const std::vector<AABBBox>& boxes, uint32_t tile_x, uint32_t tile_y, uint32_t z_slices);
+
+    // GL thread, `lights` is copied. Runs inline when `jobs` is null or
+    // not running, otherwise returns right away and Finish waits.
+    void Schedule(core::JobSystem* jobs, const std::vector<PLight>& lights, const glm::mat4& view);
+    // GL thread, before the light pass
+    void Finish();
+    // grid and indices of the last Finish at their bindings
+    void Bind() const;
+
+    uint32_t GetIndexCount() const { return _index_count; }
+    uint32_t GetIndexCapacity() const { return _index_capacity; }
+    // frames whose indices did not fit and were written again
+    uint64_t GetOverflowCount() const { return _overflow_count; }
+
+  private:
+    struct Slice {
+      float z_min;
+      float z_max;
+      // lights touching the slice, view space
+      std::vector<float> x;
+      std::vector<float> y;
+      std::vector<float> z;
+      std::vector<float> radius;
+      std::vector<uint32_t> index;
+    };
+
+    struct Row {
+      // light count per tile, the indices of all tiles back to back
+      std::vector<uint32_t> counts;
+      std::vector<uint32_t> indices;
+      uint32_t offset;
+      // scratch of the sphere tests
+      std::vector<uint32_t> hits;
+    };
+
+    void BinSlice(uint32_t slice);
+    void BinRow(uint32_t row);
+    void CountRows();
+    void WriteRows(size_t begin, size_t end);
+
+    // (re)creates the buffer with room for `index_capacity` indices per copy
+    void CreateBuffer(uint32_t index_capacity);
+    void DeleteBuffer();
+
+  private:
+    uint32_t _cluster_count;
+    uint32_t _tile_x;
+    uint32_t _tile_y;
+    uint32_t _z_slices;
+    std::vector<AABBBox> _boxes;
+
+    // view space lights of the scheduled frame
+    std::vector<float> _light_x;
+    std::vector<float> _light_y;
+    std::vector<float> _light_z;
+    std::vector<float> _light_radius;
+    std::vector<Slice> _slices;
+    // z_slices * tile_y
+    std::vector<Row> _rows;
+
+    core::JobSystem* _jobs;
+    core::JobHandle _job;
+    bool _scheduled;
+
+    unsigned int _buffer;
+    // null without ARB_buffer_storage, the copies are uploaded from _staging
+    uint8_t* _mapped;
+    std::vector<uint8_t> _staging;
+    size_t _index_offset;
+    size_t _slot_size;
+    uint32_t _index_capacity;
+    // GLsync of the last frame that read each copy
+    void* _fences[FramesInFlight];
+    int _slot;
+    // where the jobs write the current copy
+    uint8_t* _write_base;
+
+    uint32_t _index_count;
+    uint64_t _overflow_count;
+  };
+}
@@ -0,0 +1,229 @@
+#include "light_clusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "core/profiler.h"
+
+namespace render {
+  // starting size of the index buffer, grown on overflow
+  static const uint32_t initial_lights_per_cluster = 16;
+  // local sizes of the cluster shaders
+  static const unsigned int mark_group_size = 8;
+  static const unsigned int compact_group_size = 64;
+
+  static glm::vec3 ScreenToView(const glm::mat4& inverse_projection, int width, int height, uint32_t x, uint32_t y)
+  {
+    glm::vec4 ndc_pos(float(x) * 2.0f / width - 1.0f, float(y) * 2.0f / height - 1.0f, -1.0f, 1.0f);
+    glm::vec4 view_pos = inverse_projection * ndc_pos;
+    return glm::vec3(view_pos) / view_pos.w;
+  }
+
+  void BuildClusterBoxes(const glm::mat4& inverse_projection, int width, int height, uint32_t tile_size,
+    uint32_t tile_x, uint32_t tile_y, uint32_t z_slices, float z_near, float z_far, std::vector<AABBBox>& res)
+  {
+    res.resize(size_t(tile_x) * tile_y * z_slices);
+    for (uint32_t z = 0; z < z_slices; z++) {
+      float z_front = -z_near * std::pow(z_far / z_near, float(z) / z_slices);
+      float z_back = -z_near * std::pow(z_far / z_near, float(z + 1) / z_slices);
+      for (uint32_t y = 0; y < tile_y; y++) {
+        for (uint32_t x = 0; x < tile_x; x++) {
+          auto view_min = ScreenToView(inverse_projection, width, height, x * tile_size, y * tile_size);
+          auto view_max = ScreenToView(inverse_projection, width, height, (x + 1) * tile_size, (y + 1) * tile_size);
+
+          // tile corners pushed along their rays onto both depth planes
+          glm::vec3 min_front = view_min * (z_front / view_min.z);
+          glm::vec3 min_back = view_min * (z_back / view_min.z);
+          glm::vec3 max_front = view_max * (z_front / view_max.z);
+          glm::vec3 max_back = view_max * (z_back / view_max.z);
+
+          auto& box = res[(size_t(z) * tile_y + y) * tile_x + x];
+          box.minPoint = glm::vec4(glm::min(glm::min(min_front, min_back), glm::min(max_front, max_back)), 1.0f);
+          box.maxPoint = glm::vec4(glm::max(glm::max(min_front, min_back), glm::max(max_front, max_back)), 1.0f);
+        }
+      }
+    }
+  }
+
+  LightClusters::LightClusters()
+    : _cluster_count(0)
+    , _mark(nullptr)
+    , _compact(nullptr)
+    , _assign(nullptr)
+    , _scan(nullptr)
+    , _grid_buffer(0)
+    , _index_buffer(0)
+    , _counter_buffer(0)
+    , _flag_buffer(0)
+    , _active_buffer(0)
+    , _index_capacity(0)
+    , _frame(0)
+    , _overflow_count(0)
+  {
+    std::fill(_readback_buffers, _readback_buffers + FramesInFlight, 0);
+    std::fill(_readback_fences, _readback_fences + FramesInFlight, nullptr);
+    memset(&_last_counters, 0, sizeof(_last_counters));
+  }
+
+  void LightClusters::Init(uint32_t cluster_count, Shader* mark, Shader* compact, Shader* assign, Shader* scan)
+  {
+    _cluster_count = cluster_count;
+    _mark = mark;
+    _compact = compact;
+    _assign = assign;
+    _scan = scan;
+    _u_compact_cluster_count = compact->GetUniform("cluster_count");
+    _u_assign_light_count = assign->GetUniform("light_count");
+    _u_assign_write = assign->GetUniform("write_indices");
+
+    _mark->Use();
+    _mark->SetInt("gPosAO", 0);
+    glUseProgram(0);
+
+    unsigned int buffers[5];
+    glGenBuffers(5, buffers);
+    _grid_buffer = buffers[0];
+    _index_buffer = buffers[1];
+    _counter_buffer = buffers[2];
+    _flag_buffer = buffers[3];
+    _active_buffer = buffers[4];
+    _index_capacity = cluster_count * initial_lights_per_cluster;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _grid_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, cluster_count * sizeof(LightGrid), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _index_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, _index_capacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _counter_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(ClusterCounters), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _active_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, cluster_count * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    // the compact pass clears the flags it reads, they start cleared
+    std::vector<uint32_t> flags(cluster_count, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _flag_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, cluster_count * sizeof(uint32_t), flags.data(), GL_DYNAMIC_COPY);
+
+    glGenBuffers(FramesInFlight, _readback_buffers);
+    for (int i = 0; i < FramesInFlight; i++) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _readback_buffers[i]);
+      glBufferData(GL_COPY_WRITE_BUFFER, sizeof(ClusterCounters), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  void LightClusters::ReadBack(int slot)
+  {
+    auto fence = static_cast<GLsync>(_readback_fences[slot]);
+    if (!fence) {
+      return;
+    }
+    auto status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      return;
+    }
+    glDeleteSync(fence);
+    _readback_fences[slot] = nullptr;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, _readback_buffers[slot]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(ClusterCounters), &_last_counters);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    if (_last_counters.index_count > _last_counters.index_capacity) {
+      _overflow_count++;
+    }
+    if (_last_counters.index_count > _index_capacity) {
+      // rewritten every frame, nothing to keep
+      while (_index_capacity < _last_counters.index_count) {
+        _index_capacity *= 2;
+      }
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _index_buffer);
+      glBufferData(GL_COPY_WRITE_BUFFER, size_t(_index_capacity) * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+  }
+
+  void LightClusters::Bind() const
+  {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GridBinding, _grid_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IndexBinding, _index_buffer);
+  }
+
+  void LightClusters::Assign(unsigned int position_texture, int width, int height,
+    unsigned int cluster_buffer, unsigned int light_buffer, uint32_t light_count)
+  {
+    PROFILE_SCOPE("LightClusters::Assign");
+    int slot = static_cast<int>(_frame % FramesInFlight);
+    ReadBack(slot);
+
+    ClusterCounters counters;
+    memset(&counters, 0, sizeof(counters));
+    counters.dispatch_y = 1;
+    counters.dispatch_z = 1;
+    counters.index_capacity = _index_capacity;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _counter_buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(counters), &counters);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ClusterBinding, cluster_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GridBinding, _grid_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LightBinding, light_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IndexBinding, _index_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CounterBinding, _counter_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FlagBinding, _flag_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ActiveBinding, _active_buffer);
+
+    // 1. clusters that have pixels, into the flags last frame's compact
+    // cleared
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    _mark->Use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, position_texture);
+    _mark->Compute((width + mark_group_size - 1) / mark_group_size, (height + mark_group_size - 1) / mark_group_size, 1);
+    // each pass reads what the one before wrote, Shader::Compute already
+    // waits on storage writes but the passes do not rely on it
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 2. list them, also writes the dispatch size
+    _compact->Use();
+    _compact->SetUInt(_u_compact_cluster_count, _cluster_count);
+    _compact->Compute((_cluster_count + compact_group_size - 1) / compact_group_size, 1, 1);
+    // the dispatch size and the active cluster list
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 3. light count per cluster
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, _counter_buffer);
+    _assign->Use();
+    _assign->SetUInt(_u_assign_light_count, light_count);
+    _assign->SetUInt(_u_assign_write, 0);
+    glDispatchComputeIndirect(0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 4. offsets
+    _scan->Use();
+    _scan->Compute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 5. indices
+    _assign->Use();
+    _assign->SetUInt(_u_assign_write, 1);
+    glDispatchComputeIndirect(0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    // counters come back FramesInFlight frames later
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, _counter_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _readback_buffers[slot]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(ClusterCounters));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (_readback_fences[slot]) {
+      glDeleteSync(static_cast<GLsync>(_readback_fences[slot]));
+    }
+    _readback_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _frame++;
+  }
+}
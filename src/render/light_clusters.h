@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+namespace render {
+  // std430 mirrors of the structs in the cluster shaders and pbr_fs.glsl,
+  // keep both in sync
+  struct AABBBox {
+    glm::vec4 minPoint;
+    glm::vec4 maxPoint;
+  };
+
+  struct PLight {
+    glm::vec3 position;
+    int shadow_idx;
+    glm::vec3 diffuse;
+    float radius;
+  };
+
+  struct LightGrid {
+    unsigned int offset;
+    unsigned int count;
+  };
+
+  struct ClusterCounters {
+    // indirect dispatch of the count and write passes, a group per active cluster
+    uint32_t dispatch_x;
+    uint32_t dispatch_y;
+    uint32_t dispatch_z;
+    uint32_t active_count;
+    // indices wanted by the active clusters, may exceed the capacity
+    uint32_t index_count;
+    uint32_t index_capacity;
+    uint32_t pad0[2];
+  };
+
+  static_assert(sizeof(PLight) == 32, "PLight must match std430");
+  static_assert(sizeof(ClusterCounters) == 32, "ClusterCounters must match std430");
+
+  // view space boxes of the tile_x * tile_y * z_slices clusters, the same
+  // cluster_init_cs.glsl computes
+  void BuildClusterBoxes(const glm::mat4& inverse_projection, int width, int height, uint32_t tile_size,
+    uint32_t tile_x, uint32_t tile_y, uint32_t z_slices, float z_near, float z_far, std::vector<AABBBox>& res);
+
+  // Point light lists of the clusters, built on the GPU after the gbuffer:
+  //   mark     every pixel flags the cluster it falls into
+  //   compact  flagged clusters are listed, the others get no lights
+  //   count    a group per listed cluster counts the lights touching it
+  //   scan     a prefix sum over the counts gives each cluster its offset
+  //   write    the same test again, the indices go behind the offset
+  // Indices past the capacity are dropped. The counters are read back a few
+  // frames later without waiting on the GPU, then the index buffer grows to
+  // fit and the overflow is reported.
+  class LightClusters {
+  public:
+    static constexpr int FramesInFlight = 3;
+    // storage buffer binding points, also in the shaders
+    static constexpr unsigned int ClusterBinding = 1;
+    static constexpr unsigned int GridBinding = 2;
+    static constexpr unsigned int LightBinding = 3;
+    static constexpr unsigned int IndexBinding = 4;
+    static constexpr unsigned int CounterBinding = 5;
+    static constexpr unsigned int FlagBinding = 10;
+    static constexpr unsigned int ActiveBinding = 11;
+
+    LightClusters();
+
+    // `assign` is cluster_light_cs.glsl, it runs as the count and the write pass
+    void Init(uint32_t cluster_count, Shader* mark, Shader* compact, Shader* assign, Shader* scan);
+    // `position_texture` holds the gbuffer world positions, `cluster_buffer`
+    // the cluster boxes and `light_buffer` `light_count` PLights. Leaves the
+    // grid, lights and indices bound for the light pass.
+    void Assign(unsigned int position_texture, int width, int height,
+      unsigned int cluster_buffer, unsigned int light_buffer, uint32_t light_count);
+
+    // grid and indices at their bindings for the light pass
+    void Bind() const;
+    unsigned int GetGridBuffer() const { return _grid_buffer; }
+    unsigned int GetIndexBuffer() const { return _index_buffer; }
+    // counters of the last frame read back
+    uint32_t GetActiveCount() const { return _last_counters.active_count; }
+    uint32_t GetIndexCount() const { return _last_counters.index_count; }
+    uint32_t GetIndexCapacity() const { return _index_capacity; }
+    // frames that dropped indices
+    uint64_t GetOverflowCount() const { return _overflow_count; }
+
+  private:
+    // the slot about to be reused, skipped when the GPU is not done with it
+    void ReadBack(int slot);
+
+  private:
+    uint32_t _cluster_count;
+    Shader* _mark;
+    Shader* _compact;
+    Shader* _assign;
+    Shader* _scan;
+    UniformLocation _u_compact_cluster_count;
+    UniformLocation _u_assign_light_count;
+    UniformLocation _u_assign_write;
+
+    unsigned int _grid_buffer;
+    unsigned int _index_buffer;
+    unsigned int _counter_buffer;
+    unsigned int _flag_buffer;
+    unsigned int _active_buffer;
+    uint32_t _index_capacity;
+
+    unsigned int _readback_buffers[FramesInFlight];
+    // GLsync, null when nothing is in flight
+    void* _readback_fences[FramesInFlight];
+    uint64_t _frame;
+    ClusterCounters _last_counters;
+    uint64_t _overflow_count;
+  };
+}
@@ -0,0 +1,229 @@
+#include "mesh_arena.h"
+
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include "Mesh.h"
+
+namespace render {
+  // grown by doubling, 14 MB of vertices and 4 MB of indices to start with
+  static const uint32_t initial_vertex_capacity = 1 << 18;
+  static const uint32_t initial_index_capacity = 1 << 20;
+
+  // binding points of the shared vao
+  static const unsigned int vertex_binding = 0;
+  static const unsigned int instance_binding = 1;
+
+  uint32_t RangeAllocator::Allocate(uint32_t size)
+  {
+    if (!size) {
+      return 0;
+    }
+
+    for (size_t i = 0; i < _free.size(); i++) {
+      auto& range = _free[i];
+      if (range.size < size) {
+        continue;
+      }
+
+      uint32_t res = range.offset;
+      range.offset += size;
+      range.size -= size;
+      if (!range.size) {
+        _free.erase(_free.begin() + i);
+      }
+      _used += size;
+      return res;
+    }
+    return Invalid;
+  }
+
+  void RangeAllocator::Free(uint32_t offset, uint32_t size)
+  {
+    if (!size) {
+      return;
+    }
+    _used -= size;
+
+    auto next = std::lower_bound(_free.begin(), _free.end(), offset, [](const Range& range, uint32_t value) {
+      return range.offset < value;
+      });
+    auto idx = next - _free.begin();
+    _free.insert(next, { offset, size });
+
+    // merge with the following range, then with the previous one
+    if (idx + 1 < _free.size() && _free[idx].offset + _free[idx].size == _free[idx + 1].offset) {
+      _free[idx].size += _free[idx + 1].size;
+      _free.erase(_free.begin() + idx + 1);
+    }
+    if (idx > 0 && _free[idx - 1].offset + _free[idx - 1].size == _free[idx].offset) {
+      _free[idx - 1].size += _free[idx].size;
+      _free.erase(_free.begin() + idx);
+    }
+  }
+
+  void RangeAllocator::Grow(uint32_t new_capacity)
+  {
+    if (new_capacity <= _capacity) {
+      return;
+    }
+
+    uint32_t size = new_capacity - _capacity;
+    if (!_free.empty() && _free.back().offset + _free.back().size == _capacity) {
+      _free.back().size += size;
+    }
+    else {
+      _free.push_back({ _capacity, size });
+    }
+    _capacity = new_capacity;
+  }
+
+  // a larger buffer holding the contents of `buffer`, which is deleted
+  static unsigned int GrowBuffer(unsigned int buffer, size_t old_size, size_t new_size)
+  {
+    unsigned int res;
+    glGenBuffers(1, &res);
+    // copy targets, so the element binding of the current vao stays as is
+    glBindBuffer(GL_COPY_WRITE_BUFFER, res);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_STATIC_DRAW);
+    if (buffer) {
+      glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      glDeleteBuffers(1, &buffer);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return res;
+  }
+
+  MeshArena::MeshArena()
+    : _vao(0)
+    , _vbo(0)
+    , _ebo(0)
+    , _instance_vbo(0)
+  {
+  }
+
+  void MeshArena::Init()
+  {
+    glGenVertexArrays(1, &_vao);
+    glBindVertexArray(_vao);
+
+    // pos, nor, uv, tangent, bitangent
+    glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position));
+    glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal));
+    glVertexAttribFormat(2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords));
+    glVertexAttribFormat(3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Tangent));
+    glVertexAttribFormat(4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Bitangent));
+    for (int i = 0; i < 5; i++) {
+      glVertexAttribBinding(i, vertex_binding);
+      glEnableVertexAttribArray(i);
+    }
+
+    // object id, enabled once there is an instance buffer
+    glVertexAttribIFormat(5, 1, GL_UNSIGNED_INT, 0);
+    glVertexAttribBinding(5, instance_binding);
+    glVertexBindingDivisor(instance_binding, 1);
+    glBindVertexArray(0);
+
+    GrowVertices(initial_vertex_capacity);
+    GrowIndices(initial_index_capacity);
+  }
+
+  void MeshArena::GrowVertices(uint32_t min_capacity)
+  {
+    auto capacity = _vertices.GetCapacity();
+    auto new_capacity = std::max(capacity * 2, min_capacity);
+    _vbo = GrowBuffer(_vbo, capacity * sizeof(Vertex), new_capacity * sizeof(Vertex));
+    _vertices.Grow(new_capacity);
+    AttachBuffers();
+  }
+
+  void MeshArena::GrowIndices(uint32_t min_capacity)
+  {
+    auto capacity = _indices.GetCapacity();
+    auto new_capacity = std::max(capacity * 2, min_capacity);
+    _ebo = GrowBuffer(_ebo, capacity * sizeof(unsigned int), new_capacity * sizeof(unsigned int));
+    _indices.Grow(new_capacity);
+    AttachBuffers();
+  }
+
+  void MeshArena::AttachBuffers()
+  {
+    // may run in the middle of a pass, when a draw loads a model
+    int current_vao = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &current_vao);
+
+    glBindVertexArray(_vao);
+    glBindVertexBuffer(vertex_binding, _vbo, 0, sizeof(Vertex));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+    glBindVertexArray(current_vao);
+  }
+
+  MeshRange MeshArena::Allocate(const Vertex* vertices, size_t vertex_count, const unsigned int* indices, size_t index_count)
+  {
+    if (!_vao) {
+      Init();
+    }
+
+    MeshRange res;
+    res.vertex_count = static_cast<uint32_t>(vertex_count);
+    res.index_count = static_cast<uint32_t>(index_count);
+
+    res.base_vertex = _vertices.Allocate(res.vertex_count);
+    if (res.base_vertex == RangeAllocator::Invalid) {
+      GrowVertices(_vertices.GetCapacity() + res.vertex_count);
+      res.base_vertex = _vertices.Allocate(res.vertex_count);
+    }
+    res.first_index = _indices.Allocate(res.index_count);
+    if (res.first_index == RangeAllocator::Invalid) {
+      GrowIndices(_indices.GetCapacity() + res.index_count);
+      res.first_index = _indices.Allocate(res.index_count);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, res.base_vertex * sizeof(Vertex), vertex_count * sizeof(Vertex), vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, res.first_index * sizeof(unsigned int), index_count * sizeof(unsigned int), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return res;
+  }
+
+  void MeshArena::Free(const MeshRange& range)
+  {
+    _vertices.Free(range.base_vertex, range.vertex_count);
+    _indices.Free(range.first_index, range.index_count);
+  }
+
+  void MeshArena::Bind(unsigned int instance_buffer)
+  {
+    if (!_vao) {
+      Init();
+    }
+
+    glBindVertexArray(_vao);
+    if (instance_buffer && instance_buffer != _instance_vbo) {
+      glBindVertexBuffer(instance_binding, instance_buffer, 0, sizeof(uint32_t));
+      if (!_instance_vbo) {
+        glEnableVertexAttribArray(5);
+      }
+      _instance_vbo = instance_buffer;
+    }
+  }
+
+  void MeshArena::Unbind()
+  {
+    glBindVertexArray(0);
+  }
+
+  size_t MeshArena::GetCapacity() const
+  {
+    return size_t(_vertices.GetCapacity()) * sizeof(Vertex) + size_t(_indices.GetCapacity()) * sizeof(unsigned int);
+  }
+
+  size_t MeshArena::GetUsed() const
+  {
+    return size_t(_vertices.GetUsed()) * sizeof(Vertex) + size_t(_indices.GetUsed()) * sizeof(unsigned int);
+  }
+}
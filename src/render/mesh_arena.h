@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render {
+  struct Vertex;
+
+  // where a mesh lives in the arena buffers, counted in vertices and indices
+  struct MeshRange {
+    uint32_t base_vertex;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+  };
+
+  // First fit over a free list sorted by offset, neighbours are merged on
+  // free. Offsets and sizes are in elements.
+  class RangeAllocator {
+  public:
+    static constexpr uint32_t Invalid = 0xffffffffu;
+
+    // Invalid when no free range is large enough
+    uint32_t Allocate(uint32_t size);
+    void Free(uint32_t offset, uint32_t size);
+    // [capacity, new_capacity) becomes free
+    void Grow(uint32_t new_capacity);
+
+    uint32_t GetCapacity() const { return _capacity; }
+    uint32_t GetUsed() const { return _used; }
+
+  private:
+    struct Range {
+      uint32_t offset;
+      uint32_t size;
+    };
+
+    std::vector<Range> _free;
+    uint32_t _capacity = 0;
+    uint32_t _used = 0;
+  };
+
+  // Vertices and indices of every mesh, suballocated from one vertex and
+  // one index buffer behind a single vao, so meshes differ only in their
+  // base vertex and first index. The buffers grow by copying on the GPU,
+  // ranges handed out before stay valid.
+  class MeshArena {
+  public:
+    static MeshArena& GetInstance() {
+      static MeshArena inst;
+      return inst;
+    }
+
+    // GL thread, uploads right away
+    MeshRange Allocate(const Vertex* vertices, size_t vertex_count, const unsigned int* indices, size_t index_count);
+    void Free(const MeshRange& range);
+
+    // arena meshes only draw while the vao is bound, the per instance
+    // object id at location 5 reads `instance_buffer` when it is not 0
+    void Bind(unsigned int instance_buffer = 0);
+    void Unbind();
+
+    unsigned int GetVertexArray() const { return _vao; }
+    unsigned int GetVertexBuffer() const { return _vbo; }
+    unsigned int GetIndexBuffer() const { return _ebo; }
+    // bytes
+    size_t GetCapacity() const;
+    size_t GetUsed() const;
+
+  private:
+    MeshArena();
+
+    void Init();
+    void GrowVertices(uint32_t min_capacity);
+    void GrowIndices(uint32_t min_capacity);
+    // points the vao at the current buffers
+    void AttachBuffers();
+
+  private:
+    unsigned int _vao;
+    unsigned int _vbo;
+    unsigned int _ebo;
+    unsigned int _instance_vbo;
+
+    RangeAllocator _vertices;
+    RangeAllocator _indices;
+  };
+}
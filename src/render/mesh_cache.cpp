@@ -0,0 +1,178 @@
+#include "mesh_cache.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace render {
+  static const size_t data_alignment = 16;
+
+  static uint64_t AlignOffset(uint64_t offset)
+  {
+    return (offset + data_alignment - 1) & ~uint64_t(data_alignment - 1);
+  }
+
+  static Bounds ToBounds(const float* min, const float* max)
+  {
+    Bounds res;
+    res.min = glm::vec3(min[0], min[1], min[2]);
+    res.max = glm::vec3(max[0], max[1], max[2]);
+    return res;
+  }
+
+  static void FromBounds(const Bounds& bounds, float* min, float* max)
+  {
+    for (int i = 0; i < 3; i++) {
+      min[i] = bounds.min[i];
+      max[i] = bounds.max[i];
+    }
+  }
+
+  std::string MeshCache::GetCachePath(const char* source_path)
+  {
+    return std::string(source_path) + ".meshcache";
+  }
+
+  bool MeshCache::Write(const char* source_path, const std::vector<MeshData>& meshes)
+  {
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MeshCacheHeader::Magic;
+    header.version = MeshCacheHeader::Version;
+    header.vertex_size = sizeof(Vertex);
+    header.mesh_count = static_cast<uint32_t>(meshes.size());
+    if (!core::GetFileStamp(source_path, header.source_size, header.source_mtime)) {
+      return false;
+    }
+
+    Bounds bounds;
+    std::vector<MeshCacheEntry> entries(meshes.size());
+    uint64_t offset = sizeof(MeshCacheHeader) + sizeof(MeshCacheEntry) * entries.size();
+    for (size_t i = 0; i < meshes.size(); i++) {
+      auto& mesh = meshes[i];
+      auto& entry = entries[i];
+      entry.vertex_count = static_cast<uint32_t>(mesh.vertices.size());
+      entry.index_count = static_cast<uint32_t>(mesh.indices.size());
+      entry.vertex_offset = AlignOffset(offset);
+      offset = entry.vertex_offset + sizeof(Vertex) * mesh.vertices.size();
+      entry.index_offset = AlignOffset(offset);
+      offset = entry.index_offset + sizeof(unsigned int) * mesh.indices.size();
+      FromBounds(mesh.bounds, entry.bounds_min, entry.bounds_max);
+      bounds.Expand(mesh.bounds);
+    }
+    FromBounds(bounds, header.bounds_min, header.bounds_max);
+
+    // written aside and renamed, a crash never leaves half a cache behind
+    auto path = GetCachePath(source_path);
+    auto tmp_path = path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+      return false;
+    }
+
+    static const char padding[data_alignment] = { 0 };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && (entries.empty() || fwrite(entries.data(), sizeof(MeshCacheEntry), entries.size(), file) == entries.size());
+    offset = sizeof(MeshCacheHeader) + sizeof(MeshCacheEntry) * entries.size();
+    for (size_t i = 0; ok && i < meshes.size(); i++) {
+      auto& mesh = meshes[i];
+      auto& entry = entries[i];
+
+      ok = ok && fwrite(padding, 1, entry.vertex_offset - offset, file) == entry.vertex_offset - offset;
+      ok = ok && fwrite(mesh.vertices.data(), sizeof(Vertex), mesh.vertices.size(), file) == mesh.vertices.size();
+      offset = entry.vertex_offset + sizeof(Vertex) * mesh.vertices.size();
+
+      ok = ok && fwrite(padding, 1, entry.index_offset - offset, file) == entry.index_offset - offset;
+      ok = ok && fwrite(mesh.indices.data(), sizeof(unsigned int), mesh.indices.size(), file) == mesh.indices.size();
+      offset = entry.index_offset + sizeof(unsigned int) * mesh.indices.size();
+    }
+    ok = fclose(file) == 0 && ok;
+
+    if (ok) {
+      std::remove(path.c_str());
+      ok = std::rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) {
+      std::remove(tmp_path.c_str());
+    }
+    return ok;
+  }
+
+  bool MeshCache::Open(const char* source_path)
+  {
+    Close();
+    if (!_file.Open(GetCachePath(source_path).c_str())) {
+      return false;
+    }
+    if (!Validate(source_path)) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  bool MeshCache::Validate(const char* source_path)
+  {
+    auto data = _file.GetData();
+    auto size = _file.GetSize();
+    if (size < sizeof(MeshCacheHeader)) {
+      return false;
+    }
+
+    MeshCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != MeshCacheHeader::Magic || header.version != MeshCacheHeader::Version ||
+      header.vertex_size != sizeof(Vertex)) {
+      return false;
+    }
+
+    uint64_t source_size;
+    int64_t source_mtime;
+    if (!core::GetFileStamp(source_path, source_size, source_mtime) ||
+      source_size != header.source_size || source_mtime != header.source_mtime) {
+      return false;
+    }
+
+    uint64_t table_end = sizeof(MeshCacheHeader) + uint64_t(sizeof(MeshCacheEntry)) * header.mesh_count;
+    if (table_end > size) {
+      return false;
+    }
+
+    _entries.resize(header.mesh_count);
+    if (header.mesh_count) {
+      memcpy(_entries.data(), data + sizeof(MeshCacheHeader), sizeof(MeshCacheEntry) * header.mesh_count);
+    }
+    for (auto& entry : _entries) {
+      uint64_t vertex_end = entry.vertex_offset + uint64_t(sizeof(Vertex)) * entry.vertex_count;
+      uint64_t index_end = entry.index_offset + uint64_t(sizeof(unsigned int)) * entry.index_count;
+      if (entry.vertex_offset % data_alignment || entry.index_offset % data_alignment ||
+        entry.vertex_offset < table_end || entry.index_offset < table_end ||
+        vertex_end > size || index_end > size) {
+        return false;
+      }
+    }
+
+    _bounds = ToBounds(header.bounds_min, header.bounds_max);
+    return true;
+  }
+
+  void MeshCache::Close()
+  {
+    _file.Close();
+    _entries.clear();
+    _bounds = Bounds();
+  }
+
+  MeshView MeshCache::GetMesh(size_t idx) const
+  {
+    auto& entry = _entries[idx];
+    auto data = _file.GetData();
+
+    MeshView res;
+    res.vertices = reinterpret_cast<const Vertex*>(data + entry.vertex_offset);
+    res.vertex_count = entry.vertex_count;
+    res.indices = reinterpret_cast<const unsigned int*>(data + entry.index_offset);
+    res.index_count = entry.index_count;
+    res.bounds = ToBounds(entry.bounds_min, entry.bounds_max);
+    return res;
+  }
+}
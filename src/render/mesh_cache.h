@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bounds.h"
+#include "Mesh.h"
+#include "core/mapped_file.h"
+
+namespace render {
+  // processed vertices and indices of one mesh, as imported
+  struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    Bounds bounds;
+  };
+
+  // Binary mesh file written next to the source after an Assimp import:
+  //   MeshCacheHeader
+  //   MeshCacheEntry[mesh_count]
+  //   per mesh Vertex[vertex_count] then uint32[index_count], 16 byte aligned
+  // A file whose version, vertex size or source size / write time does not
+  // match is ignored and rewritten by the next import.
+  struct MeshCacheHeader {
+    static constexpr uint32_t Magic = 0x4853454d; // "MESH"
+    static constexpr uint32_t Version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_size;
+    uint32_t mesh_count;
+    uint64_t source_size;
+    int64_t source_mtime;
+    float bounds_min[3];
+    float bounds_max[3];
+  };
+
+  struct MeshCacheEntry {
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    float bounds_min[3];
+    float bounds_max[3];
+  };
+
+  // points into the mapping, valid while the MeshCache is open
+  struct MeshView {
+    const Vertex* vertices;
+    size_t vertex_count;
+    const unsigned int* indices;
+    size_t index_count;
+    Bounds bounds;
+  };
+
+  class MeshCache {
+  public:
+    // "model.obj" -> "model.obj.meshcache"
+    static std::string GetCachePath(const char* source_path);
+    // false when the file could not be written, the import still works
+    static bool Write(const char* source_path, const std::vector<MeshData>& meshes);
+
+    // maps the cache of `source_path`, false when missing or stale
+    bool Open(const char* source_path);
+    void Close();
+
+    size_t GetMeshCount() const { return _entries.size(); }
+    MeshView GetMesh(size_t idx) const;
+    const Bounds& GetBounds() const { return _bounds; }
+
+  private:
+    bool Validate(const char* source_path);
+
+  private:
+    core::MappedFile _file;
+    std::vector<MeshCacheEntry> _entries;
+    Bounds _bounds;
+  };
+}
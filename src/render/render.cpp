@@ -1,17 +1,24 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <memory>
 #include <vector>
 #include <random>
-#include <chrono>
+#include <tuple>
 
 #include "render.h"
 
 #include "Shader.h"
 #include "Model.h"
+#include "mesh_arena.h"
 #include "resource.h"
 #include "resource_mgr.h"
 #include "resource_utils.h"
+#include "texture_cache.h"
+#include "texture_streamer.h"
 #include "utils.h"
 #include "imgui.h"
+#include "core/profiler.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -19,6 +26,13 @@
 #include <glad/glad.h>
 
 namespace render {
+  // texture units of the shadow atlas pages in the light pass
+  static const int point_shadow_delta_base = 10;
+  static const int direction_shadow_delta_base = 20;
+  // bump when the ibl shaders change, cached maps are rendered again
+  static const uint64_t pbr_cache_version = 1;
+  static const char* pbr_brdf_path = "resource/images/pbr/brdf_lut.texcache";
+
   static glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
   static glm::mat4 captureViews[] =
   {
@@ -42,6 +56,29 @@ namespace render {
     return res;
   }
 
+  // far plane of getPointLightVP, point shadows end there
+  static const float point_shadow_far = 50.0f;
+
+  // a fixed box around the origin
+  static glm::mat4 GetDirectionShadowVP(const glm::vec3& direction)
+  {
+    auto view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), direction, glm::vec3(0.0f, 1.0f, 0.0f));
+    auto projection = glm::ortho(-40.0f, 40.0f, -40.0f, 40.0f, -25.0f, 25.0f);
+    return projection * view;
+  }
+
+  // radius of the sphere on screen in pixels, `pixel_scale` is
+  // projection[1][1] * height / 2
+  static float GetSphereCoverage(const glm::vec3& center, float radius, const glm::vec3& eye, float pixel_scale)
+  {
+    auto delta = center - eye;
+    float dist2 = glm::dot(delta, delta);
+    if (dist2 <= radius * radius) {
+      return FLT_MAX;
+    }
+    return radius / std::sqrt(dist2 - radius * radius) * pixel_scale;
+  }
+
   static double Halton_Seq(int index, int base) {
     double f = 1, r = 0;
     while (index > 0) {
@@ -71,64 +108,260 @@ namespace render {
   void Render::PrepareRender()
   {
     if (_enable_ibl) {
-      // 1. skybox
-      InitPbrSkybox();
+      // only rendered when the hdr or the sizes changed since the last run
+      if (!LoadPbrCache()) {
+        // 1. skybox
+        InitPbrSkybox();
+
+        // 2. irradiance
+        InitPbrIrradiance();
+
+        // 3. prefilter
+        InitPbrPrefilter();
+
+        SavePbrCache();
+      }
+
+      // 4. brdf, independent of the skybox and shipped with the resources
+      if (!LoadPbrBrdf()) {
+        InitPbrBrdf();
+        SavePbrBrdf();
+      }
+    }
+  }
+
+  void Render::UpdateBounds()
+  {
+    for (auto handle : _pending_bounds) {
+      auto item = _render_objects.Get(handle);
+      if (!item || item->has_bounds) {
+        continue;
+      }
+
+      // loads the mesh, it would be loaded by the first draw anyway
+      auto mesh = GetModelResource(item->mesh);
+      if (!mesh) {
+        continue;
+      }
+      item->local_bounds = mesh->GetBounds();
+      // empty models have nothing to draw
+      if (item->local_bounds.IsValid()) {
+        item->has_bounds = true;
+        _shadow_dirty_bounds.push_back(item->local_bounds.Transformed(item->transform));
+        _draw_layout_dirty = true;
+      }
+    }
+    _pending_bounds.clear();
+  }
+
+  static bool SameTextures(const RenderItem* a, const RenderItem* b)
+  {
+    return a->albedo == b->albedo && a->normal == b->normal &&
+      a->metalic == b->metalic && a->roughness == b->roughness && a->ao == b->ao;
+  }
+
+  void Render::BuildDrawLayout()
+  {
+    PROFILE_SCOPE("Render::BuildDrawLayout");
+    // items with bounds have their mesh loaded
+    std::vector<RenderItem*> items;
+    for (auto& item : _render_objects) {
+      item.draw_batch = GpuObject::NoBatch;
+      if (item.has_bounds) {
+        items.push_back(&item);
+      }
+    }
+    // textures first, the batches of one material end up adjacent
+    std::sort(items.begin(), items.end(), [](const RenderItem* a, const RenderItem* b) {
+      return std::tie(a->albedo, a->normal, a->metalic, a->roughness, a->ao, a->mesh) <
+        std::tie(b->albedo, b->normal, b->metalic, b->roughness, b->ao, b->mesh);
+      });
+
+    std::vector<GpuBatch> batches;
+    std::vector<DrawCommand> commands;
+    uint32_t instance_count = 0;
+    const RenderItem* material_item = nullptr;
+    _material_draws.clear();
+    for (size_t begin = 0, end = 0; begin < items.size(); begin = end) {
+      auto first = items[begin];
+      end = begin + 1;
+      while (end < items.size() && first->mesh == items[end]->mesh && SameTextures(first, items[end])) {
+        end++;
+      }
+
+      auto resource = GetModelResource(first->mesh, false);
+      auto model = resource ? resource->GetModel() : nullptr;
+      if (!model) {
+        continue;
+      }
 
-      // 2. irradiance
-      InitPbrIrradiance();
+      // one command per sub mesh, each with room for every item of the batch
+      GpuBatch batch = {};
+      batch.first_command = static_cast<uint32_t>(commands.size());
+      auto item_count = static_cast<uint32_t>(end - begin);
+      for (auto& mesh : model->GetMeshes()) {
+        auto& range = mesh.GetRange();
+        DrawCommand command;
+        command.count = range.index_count;
+        command.instance_count = 0;
+        command.first_index = range.first_index;
+        command.base_vertex = static_cast<int32_t>(range.base_vertex);
+        command.base_instance = instance_count;
+        commands.push_back(command);
+        instance_count += item_count;
+      }
+      batch.command_count = static_cast<uint32_t>(commands.size()) - batch.first_command;
+
+      if (!material_item || !SameTextures(material_item, first)) {
+        MaterialDraw draw = {};
+        draw.textures[0] = first->albedo;
+        draw.textures[1] = first->normal;
+        draw.textures[2] = first->metalic;
+        draw.textures[3] = first->roughness;
+        draw.textures[4] = first->ao;
+        draw.first_command = batch.first_command;
+        _material_draws.push_back(draw);
+        material_item = first;
+      }
+      _material_draws.back().command_count += batch.command_count;
 
-      // 3. prefilter
-      InitPbrPrefilter();
+      for (size_t i = begin; i < end; i++) {
+        items[i]->draw_batch = static_cast<uint32_t>(batches.size());
+      }
+      batches.push_back(batch);
+    }
 
-      // 4. brdf
-      InitPbrBrdf();
+    _draw_list.SetObjectCount(_render_objects.size());
+    for (auto& item : _render_objects) {
+      UpdateDrawObject(item);
     }
+    _draw_list.SetLayout(batches, commands, instance_count);
+    _draw_layout_dirty = false;
+  }
+
+  void Render::UpdateDrawObject(const RenderItem& item)
+  {
+    GpuObject obj = {};
+    obj.model = item.transform;
+    obj.last_model = item.last_trans;
+    obj.bounds_min = glm::vec4(item.local_bounds.min, 1.0f);
+    obj.bounds_max = glm::vec4(item.local_bounds.max, 1.0f);
+    obj.batch = item.draw_batch;
+    _draw_list.SetObject(&item - _render_objects.data(), obj);
   }
 
   void Render::Update()
   {
+    PROFILE_SCOPE("Render::Update");
+    TextureStreamer::GetInstance().Update(_texture_upload_budget);
+    UpdateBounds();
+
+    // not moved again since last frame, stop reporting velocity
+    for (auto handle : _settle_items) {
+      auto item = _render_objects.Get(handle);
+      if (item && item->move_frame != _frame_index) {
+        item->last_trans = item->transform;
+        if (!_draw_layout_dirty) {
+          UpdateDrawObject(*item);
+        }
+      }
+    }
+    _settle_items.swap(_moved_items);
+    _moved_items.clear();
+
+    if (_draw_layout_dirty) {
+      BuildDrawLayout();
+    }
+    else {
+      for (auto handle : _settle_items) {
+        auto item = _render_objects.Get(handle);
+        if (item) {
+          UpdateDrawObject(*item);
+        }
+      }
+    }
+    _draw_list.Upload();
+    UpdateClusterLights();
   }
 
   void Render::PostUpdate()
   {
+    PROFILE_SCOPE("Render::PostUpdate");
     PostUpdateTAA();
+    _frame_index++;
   }
 
   void Render::DoRender()
   {
+    PROFILE_SCOPE("Render::DoRender");
     Update();
-    auto begin_time = std::chrono::steady_clock::now();
-    ComputeClusterLight();
-    auto end_cluster_box = std::chrono::steady_clock::now();
+    UploadFrameUniforms();
+    _stats.BeginFrame();
+
+    _stats.BeginPass(RenderPass_Shadow);
     RenderShadow();
-    auto end_shadow = std::chrono::steady_clock::now();
+    _stats.EndPass(RenderPass_Shadow);
+    UploadClusterLights();
+    _stats.BeginPass(RenderPass_Gbuffer);
     RenderGbuffer();
-    auto end_gbuffer = std::chrono::steady_clock::now();
+    _stats.EndPass(RenderPass_Gbuffer);
+    _stats.BeginPass(RenderPass_Cluster);
+    ComputeClusterLight();
+    _stats.EndPass(RenderPass_Cluster);
+    _stats.BeginPass(RenderPass_SSAO);
     RenderSSAO();
-    auto end_ssao = std::chrono::steady_clock::now();
+    _stats.EndPass(RenderPass_SSAO);
+    _stats.BeginPass(RenderPass_Light);
     RenderLight();
-    auto end_light = std::chrono::steady_clock::now();
+    _stats.EndPass(RenderPass_Light);
+    _stats.BeginPass(RenderPass_Skybox);
     RenderSkyBox();
-    auto end_skybox = std::chrono::steady_clock::now();
+    _stats.EndPass(RenderPass_Skybox);
+    _stats.BeginPass(RenderPass_TAA);
     RenderTAA();
+    _stats.EndPass(RenderPass_TAA);
     RenderPost();
-    PostUpdate();
 
-    _dt_cluster_box_pass = std::chrono::duration<float, std::milli>(end_cluster_box - begin_time).count();
-    _dt_shadow_pass = std::chrono::duration<float, std::milli>(end_shadow - end_cluster_box).count();
-    _dt_gbuffer_pass = std::chrono::duration<float, std::milli>(end_gbuffer - end_shadow).count();
-    _dt_ssao_pass = std::chrono::duration<float, std::milli>(end_ssao - end_gbuffer).count();
-    _dt_light_pass = std::chrono::duration<float, std::milli>(end_light - end_ssao).count();
-    _dt_skybox_pass = std::chrono::duration<float, std::milli>(end_skybox - end_light).count();
+    _stats.EndFrame();
+    PostUpdate();
 
-    ImGui::Text("cluster pass: %.3f ms", _dt_cluster_box_pass);
-    ImGui::Text("shadow pass: %.3f ms", _dt_shadow_pass);
-    ImGui::Text("gbuffer pass: %.3f ms", _dt_gbuffer_pass);
-    ImGui::Text("ssao pass: %.3f ms", _dt_ssao_pass);
-    ImGui::Text("light pass: %.3f ms", _dt_light_pass);
-    ImGui::Text("skybox pass: %.3f ms", _dt_skybox_pass);
+    // gpu numbers lag a few frames behind
+    for (auto& pass : _stats.GetPasses()) {
+      ImGui::Text("%s pass: cpu %.3f ms, gpu %.3f ms", pass.name.c_str(), pass.cpu.Last(), pass.gpu.Last());
+    }
+    ImGui::Checkbox("Pass Stats Detail", &_show_stats_detail);
+    if (_show_stats_detail) {
+      for (auto& pass : _stats.GetPasses()) {
+        ImGui::Text("%s gpu min %.3f avg %.3f max %.3f p99 %.3f", pass.name.c_str(),
+          pass.gpu.Min(), pass.gpu.Avg(), pass.gpu.Max(), pass.gpu.Percentile(0.99f));
+      }
+      if (ImGui::Button("Export Stats")) {
+        ExportStats("render_stats.csv");
+        ExportStats("render_stats.json");
+      }
+    }
+    ImGui::Text("draw objects: %zu, commands: %zu, materials: %zu", _draw_list.GetObjectCount(),
+      _draw_list.GetCommandCount(), _material_draws.size());
+    if (_cpu_light_binning) {
+      ImGui::Text("light binning: %u / %u indices, %llu overflows", _light_binner.GetIndexCount(),
+        _light_binner.GetIndexCapacity(), static_cast<unsigned long long>(_light_binner.GetOverflowCount()));
+    }
+    else {
+      ImGui::Text("light clusters: %u active, %u / %u indices, %llu overflows", _light_clusters.GetActiveCount(),
+        _light_clusters.GetIndexCount(), _light_clusters.GetIndexCapacity(),
+        static_cast<unsigned long long>(_light_clusters.GetOverflowCount()));
+    }
+    ImGui::Checkbox("CPU Light Binning", &_cpu_light_binning);
+    ImGui::Text("mesh arena: %.1f / %.1f MB", MeshArena::GetInstance().GetUsed() / 1048576.0,
+      MeshArena::GetInstance().GetCapacity() / 1048576.0);
+    ImGui::Text("streaming textures: %zu", TextureStreamer::GetInstance().GetPendingCount());
+    ImGui::SliderFloat("Texture Upload ms", &_texture_upload_budget, 0.5f, 16.0f);
 
     ImGui::Checkbox("Enable Shadow", &_enable_shadow);
+    ImGui::Text("shadows: %d / %d cubes, atlas %.0f%%, %d rendered", _shadow_atlas.GetCubeCount(),
+      _shadow_atlas.GetCubeCapacity(), 100.0 * _shadow_atlas.GetTileArea() / (double(_shadow_atlas_size) * _shadow_atlas_size),
+      _shadow_update_count);
+    ImGui::SliderInt("Shadow Updates", &_shadow_update_budget, 1, _max_shadow_updates);
     ImGui::Checkbox("Enable SSAO", &_enable_ssao);
 
     ImGui::SliderFloat("TAA Blend Ratio", &_taa_blend_ratio, 0.0f, 1.0f);
@@ -139,13 +372,27 @@ namespace render {
   {
     InitShader();
     InitObjects();
+    InitPlaceholders();
     InitPBR();
     InitShadowMap();
     InitSSAO();
     InitCluster();
+    InitDrawList();
+    InitUniformBuffers();
+    InitStats();
     InitTAA();
   }
 
+  bool Render::ExportStats(const char* path) const
+  {
+    std::string file_path = path;
+    auto dot = file_path.find_last_of('.');
+    if (dot != std::string::npos && file_path.substr(dot) == ".json") {
+      return _stats.ExportJSON(path);
+    }
+    return _stats.ExportCSV(path);
+  }
+
   void Render::SetPbrSkyBox(const char* path)
   {
     _pbr_skybox_path = path;
@@ -159,55 +406,146 @@ namespace render {
     _camera_pos = pos;
   }
 
-  void Render::AddRenderItem(const RenderItem& new_item)
+  RenderItemHandle Render::CreateRenderItem(const RenderItem& item)
+  {
+    auto handle = _render_objects.Create(item);
+    auto new_item = _render_objects.Get(handle);
+    new_item->move_frame = 0;
+    new_item->has_bounds = false;
+    new_item->draw_batch = GpuObject::NoBatch;
+    _pending_bounds.push_back(handle);
+    _draw_layout_dirty = true;
+    return handle;
+  }
+
+  void Render::UpdateRenderItem(RenderItemHandle handle, const RenderItem& item)
   {
-    assert(_render_objects.count(new_item.obj_id) == 0);
-    _render_objects[new_item.obj_id] = new_item;
+    auto old_item = _render_objects.Get(handle);
+    if (!old_item) {
+      return;
+    }
+    old_item->obj_id = item.obj_id;
+    if (old_item->mesh != item.mesh && old_item->has_bounds) {
+      _shadow_dirty_bounds.push_back(old_item->local_bounds.Transformed(old_item->transform));
+      old_item->has_bounds = false;
+      _pending_bounds.push_back(handle);
+    }
+    if (old_item->mesh != item.mesh || !SameTextures(old_item, &item)) {
+      _draw_layout_dirty = true;
+    }
+    old_item->mesh = item.mesh;
+    old_item->albedo = item.albedo;
+    old_item->normal = item.normal;
+    old_item->metalic = item.metalic;
+    old_item->roughness = item.roughness;
+    old_item->ao = item.ao;
   }
 
-  void Render::DelRenderItem(uint64_t obj_id)
+  void Render::UpdateTransform(RenderItemHandle handle, const glm::mat4& trans)
   {
-    auto itr = _render_objects.find(obj_id);
-    if (itr != _render_objects.end()) {
-      _render_objects.erase(itr);
+    auto item = _render_objects.Get(handle);
+    if (!item) {
+      return;
     }
+    // moved twice in one frame, keep the transform drawn last frame
+    if (item->move_frame != _frame_index) {
+      item->last_trans = item->transform;
+      item->move_frame = _frame_index;
+      _moved_items.push_back(handle);
+    }
+
+    if (item->has_bounds) {
+      // shadows seeing either end of the move are rendered again
+      _shadow_dirty_bounds.push_back(item->local_bounds.Transformed(item->transform));
+      _shadow_dirty_bounds.push_back(item->local_bounds.Transformed(trans));
+    }
+    item->transform = trans;
   }
 
-  void Render::ClearRenderItem()
+  void Render::DestroyRenderItem(RenderItemHandle handle)
   {
-    _render_objects.clear();
+    auto item = _render_objects.Get(handle);
+    if (item && item->has_bounds) {
+      _shadow_dirty_bounds.push_back(item->local_bounds.Transformed(item->transform));
+    }
+    // the last item moves into the hole, object indices change
+    if (_render_objects.Destroy(handle)) {
+      _draw_layout_dirty = true;
+    }
   }
 
-  void Render::AddPointLight(const RenderPointLight& new_light)
+  PointLightHandle Render::CreatePointLight(const RenderPointLight& light)
   {
-    _point_light[new_light.light_id] = new_light;
-    _point_light[new_light.light_id].shadow_map_idx = -1;
+    auto handle = _point_light.Create(light);
+    auto new_light = _point_light.Get(handle);
+    new_light->shadow_cube = ShadowCube();
+    new_light->shadow_dirty = true;
+    new_light->shadow_ready = false;
+    new_light->shadow_coverage = 0.0f;
+    return handle;
   }
 
-  void Render::DelPointLight(uint64_t light_id)
+  void Render::UpdatePointLight(PointLightHandle handle, const RenderPointLight& light)
   {
-    _point_light.erase(light_id);
+    auto old_light = _point_light.Get(handle);
+    if (!old_light) {
+      return;
+    }
+    // the color does not change the shadow
+    if (old_light->position != light.position || old_light->radius != light.radius ||
+      old_light->enable_shadow != light.enable_shadow) {
+      old_light->shadow_dirty = true;
+    }
+    old_light->light_id = light.light_id;
+    old_light->position = light.position;
+    old_light->color = light.color;
+    old_light->enable_shadow = light.enable_shadow;
+    old_light->radius = light.radius;
   }
 
-  void Render::ClearPointLight()
+  void Render::DestroyPointLight(PointLightHandle handle)
   {
-    _point_light.clear();
+    auto light = _point_light.Get(handle);
+    if (light) {
+      _shadow_atlas.FreeCube(light->shadow_cube);
+    }
+    _point_light.Destroy(handle);
   }
 
-  void Render::AddDirectionLight(const RenderDirectionLight& new_light)
+  DirectionLightHandle Render::CreateDirectionLight(const RenderDirectionLight& light)
   {
-    _direction_light[new_light.light_id] = new_light;
-    _direction_light[new_light.light_id].shadow_map_idx = -1;
+    auto handle = _direction_light.Create(light);
+    auto new_light = _direction_light.Get(handle);
+    new_light->shadow_tile = ShadowTile();
+    new_light->shadow_dirty = true;
+    new_light->shadow_ready = false;
+    new_light->vp = GetDirectionShadowVP(light.direction);
+    return handle;
   }
 
-  void Render::DelDirectionLight(uint64_t light_id)
+  void Render::UpdateDirectionLight(DirectionLightHandle handle, const RenderDirectionLight& light)
   {
-    _direction_light.erase(light_id);
+    auto old_light = _direction_light.Get(handle);
+    if (!old_light) {
+      return;
+    }
+    if (old_light->direction != light.direction || old_light->enable_shadow != light.enable_shadow) {
+      old_light->shadow_dirty = true;
+      old_light->vp = GetDirectionShadowVP(light.direction);
+    }
+    old_light->light_id = light.light_id;
+    old_light->direction = light.direction;
+    old_light->color = light.color;
+    old_light->enable_shadow = light.enable_shadow;
   }
 
-  void Render::ClearDirectionLight()
+  void Render::DestroyDirectionLight(DirectionLightHandle handle)
   {
-    _direction_light.clear();
+    auto light = _direction_light.Get(handle);
+    if (light) {
+      _shadow_atlas.FreeTile(light->shadow_tile);
+    }
+    _direction_light.Destroy(handle);
   }
 
   Render::Render()
@@ -220,6 +558,13 @@ namespace render {
     _gbuffer = nullptr;
     _light = nullptr;
     _skybox = nullptr;
+    _cull = nullptr;
+
+    _jobs = nullptr;
+    _frame_index = 1;
+    _draw_layout_dirty = false;
+    std::fill(_material_placeholders, _material_placeholders + MaterialSlotCount, 0);
+    _texture_upload_budget = 2.0f;
 
     // config
     _pbr_skybox_width = 512;
@@ -228,14 +573,18 @@ namespace render {
     _pbr_irradiance_height = 32;
     _pbr_prefilter_width = 128;
     _pbr_prefilter_height = 128;
+    _pbr_prefilter_levels = 5;
     _pbr_brdf_width = 512;
     _pbr_brdf_height = 512;
     _windows_width = 1920;
     _windows_height = 1080;
-    _max_direction_light_shadow = 3;
-    _max_point_light_shadow = 3;
-    _shadow_map_width = 1024;
-    _shadow_map_height = 1024;
+    _shadow_atlas_size = 4096;
+    _shadow_min_tile_size = 256;
+    _direction_shadow_size = 2048;
+    _max_shadow_updates = 8;
+    _shadow_update_budget = 4;
+    _shadow_update_count = 0;
+    _point_light_capacity = 0;
 
     _z_near = 0.1f;
     _z_far = 200.0f;
@@ -251,154 +600,267 @@ namespace render {
 
     _enable_shadow = true;
     _enable_ssao = false;
+    _show_stats_detail = false;
+    _cpu_light_binning = false;
+    _output_fbo = 0;
     _enable_ibl = false;
   }
   void Render::PostUpdateTAA()
   {
     _taa_jitter_idx++;
   }
-  void Render::RenderShadow()
+  void Render::UpdateShadowSlots()
   {
-    if (!_enable_shadow) {
-      return;
+    PROFILE_SCOPE("Render::UpdateShadowSlots");
+    // direction lights cover the whole screen, they go first
+    for (auto& light : _direction_light) {
+      if (!light.enable_shadow) {
+        _shadow_atlas.FreeTile(light.shadow_tile);
+        light.shadow_ready = false;
+        continue;
+      }
+      if (!light.shadow_tile.IsValid() && _shadow_atlas.AllocateTile(_direction_shadow_size, light.shadow_tile)) {
+        light.shadow_dirty = true;
+      }
     }
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_FRONT);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, _shadow_frame_buffer);
-    glViewport(0, 0, _shadow_map_width, _shadow_map_height);
 
-    // point_light
-    _shadow_shader_point->Use();
-    _point_shadow_count = 0;
-    int cluster_index = 0;
+    auto frustum = Frustum::FromMatrix(_camera_projection * _camera_view);
+    float pixel_scale = _camera_projection[1][1] * 0.5f * _windows_height;
+    std::vector<RenderPointLight*> lights;
     for (auto& light : _point_light) {
-      if (_point_shadow_count >= _max_point_light_shadow)
-      {
-        break;
+      if (!light.enable_shadow) {
+        _shadow_atlas.FreeCube(light.shadow_cube);
+        light.shadow_ready = false;
+        continue;
+      }
+      Bounds bounds;
+      bounds.min = light.position - glm::vec3(light.radius);
+      bounds.max = light.position + glm::vec3(light.radius);
+      light.shadow_coverage = frustum.Intersects(bounds) ?
+        GetSphereCoverage(light.position, light.radius, _camera_pos, pixel_scale) : 0.0f;
+      lights.push_back(&light);
+    }
+
+    // the largest lights on screen pick first
+    std::stable_sort(lights.begin(), lights.end(), [](const RenderPointLight* a, const RenderPointLight* b) {
+      return a->shadow_coverage > b->shadow_coverage;
+      });
+    for (size_t i = 0; i < lights.size(); i++) {
+      auto light = lights[i];
+      auto& cube = light->shadow_cube;
+      int page = _shadow_atlas.PickPage(light->shadow_coverage);
+      // grows right away but shrinks only two pages down, so lights near
+      // a page boundary keep their cube
+      if (cube.IsValid() && page >= cube.page && page <= cube.page + 1) {
+        continue;
       }
-      if (light.second.enable_shadow) {
-        // each light
-        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _point_shadow_map[_point_shadow_count], 0);
-        glDrawBuffer(GL_NONE);
-        glReadBuffer(GL_NONE);
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        _shadow_shader_point->SetFV3("lightPos", glm::value_ptr(light.second.position));
-        _shadow_shader_point->SetFloat("far_plane", 50.0f);
-        _shadow_shader_point->SetFloat("radius", light.second.radius);
-        auto vps = getPointLightVP(light.second.position);
-        light.second.vps = vps;
-        light.second.shadow_map_idx = _point_shadow_count;
-        for (int i = 0; i < vps.size(); i++) {
-          // each face
-          std::string uniform_name = "shadowMatrices[" + std::to_string(i) + "]";
-          _shadow_shader_point->SetFM4(uniform_name.c_str(), glm::value_ptr(vps[i]));
+
+      ShadowCube new_cube;
+      if (_shadow_atlas.AllocateCube(page, new_cube)) {
+        // full, the page it got is no better than its own
+        if (cube.IsValid() && new_cube.page >= cube.page && page < cube.page) {
+          _shadow_atlas.FreeCube(new_cube);
+          continue;
         }
+      }
+      else if (!cube.IsValid()) {
+        // taken from the least covered light that has one
+        for (size_t j = lights.size() - 1; j > i; j--) {
+          auto other = lights[j];
+          if (other->shadow_cube.IsValid() && other->shadow_coverage < light->shadow_coverage) {
+            new_cube = other->shadow_cube;
+            other->shadow_cube = ShadowCube();
+            other->shadow_ready = false;
+            break;
+          }
+        }
+      }
+      if (!new_cube.IsValid()) {
+        continue;
+      }
 
-        for (auto& obj : _render_objects) {
-          _shadow_shader_point->SetFM4("model", glm::value_ptr(obj.second.transform));
+      _shadow_atlas.FreeCube(cube);
+      cube = new_cube;
+      light->shadow_dirty = true;
+      light->shadow_ready = false;
+    }
+  }
 
-          auto mesh = GetModelResource(obj.second.mesh);
-          mesh->Draw(_shadow_shader_point);
+  void Render::InvalidateShadows()
+  {
+    PROFILE_SCOPE("Render::InvalidateShadows");
+    if (_shadow_dirty_bounds.empty()) {
+      return;
+    }
+
+    for (auto& light : _point_light) {
+      if (light.shadow_dirty || !light.shadow_cube.IsValid()) {
+        continue;
+      }
+      float radius = std::min(light.radius, point_shadow_far);
+      for (const auto& bounds : _shadow_dirty_bounds) {
+        if (bounds.IntersectsSphere(light.position, radius)) {
+          light.shadow_dirty = true;
+          break;
         }
-        _cluster_point_lights[cluster_index].shadow_idx = _point_shadow_count;
-        _point_shadow_count++;
       }
-      cluster_index++;
     }
 
-    glCullFace(GL_BACK);
-    glDisable(GL_CULL_FACE);
+    for (auto& light : _direction_light) {
+      if (light.shadow_dirty || !light.shadow_tile.IsValid()) {
+        continue;
+      }
+      auto frustum = Frustum::FromMatrix(light.vp);
+      for (const auto& bounds : _shadow_dirty_bounds) {
+        if (frustum.Intersects(bounds)) {
+          light.shadow_dirty = true;
+          break;
+        }
+      }
+    }
+    _shadow_dirty_bounds.clear();
+  }
+
+  void Render::RenderPointShadow(RenderPointLight& light, int view)
+  {
+    // the geometry shader drops triangles outside the radius and the
+    // depth range ends at the far plane
+    _draw_list.CullSphere(view, light.position, std::min(light.radius, point_shadow_far));
+    _shadow_atlas.BeginCube(light.shadow_cube);
+
+    _shadow_shader_point->Use();
+    _shadow_shader_point->SetFV3("lightPos", glm::value_ptr(light.position));
+    _shadow_shader_point->SetFloat("far_plane", point_shadow_far);
+    _shadow_shader_point->SetFloat("radius", light.radius);
+    _shadow_shader_point->SetInt(_u_shadow_point_layer, light.shadow_cube.layer);
+    light.vps = getPointLightVP(light.position);
+    // each face
+    _shadow_shader_point->SetFM4(_u_shadow_point_matrices, glm::value_ptr(light.vps[0]), static_cast<int>(light.vps.size()));
+
+    _draw_list.Draw(view, 0, static_cast<uint32_t>(_draw_list.GetCommandCount()));
+    light.shadow_dirty = false;
+    light.shadow_ready = true;
+  }
+
+  void Render::RenderDirectionShadow(RenderDirectionLight& light, int view)
+  {
+    _draw_list.CullFrustum(view, Frustum::FromMatrix(light.vp));
+    _shadow_atlas.BeginTile(light.shadow_tile);
 
-    // direction_light
     _shadow_shader_direction->Use();
-    _diretion_shadow_count = 0;
+    _shadow_shader_direction->SetFM4("shadow_vp", glm::value_ptr(light.vp));
+    _draw_list.Draw(view, 0, static_cast<uint32_t>(_draw_list.GetCommandCount()));
+    light.shadow_dirty = false;
+    light.shadow_ready = true;
+  }
+
+  void Render::RenderShadow()
+  {
+    PROFILE_SCOPE("Render::RenderShadow");
+    _shadow_update_count = 0;
+    if (!_enable_shadow) {
+      // casters are not tracked meanwhile, everything is rendered again
+      for (auto& light : _point_light) {
+        light.shadow_dirty = true;
+      }
+      for (auto& light : _direction_light) {
+        light.shadow_dirty = true;
+      }
+      _shadow_dirty_bounds.clear();
+      return;
+    }
+
+    UpdateShadowSlots();
+    InvalidateShadows();
+
+    // lights that never had a shadow first, then by screen coverage, point
+    // lights off screen wait until they are seen
+    std::vector<RenderPointLight*> point_updates;
+    for (auto& light : _point_light) {
+      if (light.shadow_dirty && light.shadow_cube.IsValid() && light.shadow_coverage > 0.0f) {
+        point_updates.push_back(&light);
+      }
+    }
+    std::sort(point_updates.begin(), point_updates.end(), [](const RenderPointLight* a, const RenderPointLight* b) {
+      if (a->shadow_ready != b->shadow_ready) {
+        return !a->shadow_ready;
+      }
+      return a->shadow_coverage > b->shadow_coverage;
+      });
+
+    int budget = std::min(_shadow_update_budget, _max_shadow_updates);
+    MeshArena::GetInstance().Bind(_draw_list.GetInstanceBuffer());
+
     for (auto& light : _direction_light) {
-      if (_diretion_shadow_count >= _max_direction_light_shadow) {
+      if (_shadow_update_count >= budget) {
         break;
       }
-      if (light.second.enable_shadow) {
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _diretion_shadow_map[_diretion_shadow_count], 0);
-        glDrawBuffer(GL_NONE);
-        glReadBuffer(GL_NONE);
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        auto view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), light.second.direction, glm::vec3(0.0f, 1.0f, 0.0f));
-        auto projection = glm::ortho(-40.0f, 40.0f, -40.0f, 40.0f, -25.0f, 25.0f);
-        light.second.vp = projection * view;
-        light.second.shadow_map_idx = _diretion_shadow_count;
-        _shadow_shader_direction->SetFM4("shadow_vp", glm::value_ptr(light.second.vp));
-        for (auto& obj : _render_objects) {
-          _shadow_shader_direction->SetFM4("model", glm::value_ptr(obj.second.transform));
-
-          auto mesh = GetModelResource(obj.second.mesh);
-          mesh->Draw(_shadow_shader_direction);
-        }
+      if (light.shadow_dirty && light.shadow_tile.IsValid()) {
+        RenderDirectionShadow(light, GetShadowView(_shadow_update_count++));
+      }
+    }
 
-        _diretion_shadow_count++;
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    for (auto light : point_updates) {
+      if (_shadow_update_count >= budget) {
+        break;
       }
+      RenderPointShadow(*light, GetShadowView(_shadow_update_count++));
     }
+    glCullFace(GL_BACK);
+    glDisable(GL_CULL_FACE);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    _shadow_atlas.End();
+    MeshArena::GetInstance().Unbind();
+
+    int cluster_index = 0;
+    for (const auto& light : _point_light) {
+      _cluster_point_lights[cluster_index].shadow_idx = light.shadow_ready ? ShadowAtlas::EncodeCube(light.shadow_cube) : -1;
+      cluster_index++;
+    }
   }
   void Render::RenderGbuffer()
   {
-    static glm::mat4 last_vp = _camera_projection * _camera_view;
+    PROFILE_SCOPE("Render::RenderGbuffer");
     glBindFramebuffer(GL_FRAMEBUFFER, _gbuffer_frame_buffer);
     glViewport(0, 0, _windows_width, _windows_height);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_CULL_FACE);
 
+    _draw_list.CullFrustum(0, Frustum::FromMatrix(_camera_projection * _camera_view));
+
     // input: mvp, framebuffer, map
     _gbuffer->Use();
-    _gbuffer->SetFM4("view", glm::value_ptr(_camera_view));
-    _gbuffer->SetFM4("projection", glm::value_ptr(_camera_projection));
-    auto jitter_base = GetHalton(_taa_jitter_idx) * _taa_jitter_ratio;
-    _gbuffer->SetFV2("jitter", glm::value_ptr(glm::vec2(jitter_base.x / _windows_width, jitter_base.y / _windows_height)));
-
-    for (auto& obj : _render_objects) {
-      _gbuffer->SetFM4("model", glm::value_ptr(obj.second.transform));
-      _gbuffer->SetFM4("last_mvp", glm::value_ptr(last_vp * obj.second.last_trans));
-
-      auto albedo_map = GetTexture2DResource(obj.second.albedo);
-      auto normal_map = GetTexture2DResource(obj.second.normal);
-      auto metalic_map = GetTexture2DResource(obj.second.metalic);
-      auto roughness_map = GetTexture2DResource(obj.second.roughness);
-      auto ao_map = GetTexture2DResource(obj.second.ao);
-      auto mesh = GetModelResource(obj.second.mesh);
-
-      albedo_map->BindToTexture(0);
-      normal_map->BindToTexture(1);
-      metalic_map->BindToTexture(2);
-      roughness_map->BindToTexture(3);
-      ao_map->BindToTexture(4);
-
-      _gbuffer->SetInt("albedo", 0);
-      _gbuffer->SetInt("normal", 1);
-      _gbuffer->SetInt("metalic", 2);
-      _gbuffer->SetInt("roughness", 3);
-      _gbuffer->SetInt("ao", 4);
-
-      mesh->Draw(_gbuffer);
+    _gbuffer->SetInt("albedo", 0);
+    _gbuffer->SetInt("normal", 1);
+    _gbuffer->SetInt("metalic", 2);
+    _gbuffer->SetInt("roughness", 3);
+    _gbuffer->SetInt("ao", 4);
+
+    // every mesh draws from the arena buffers, one vao for the whole pass
+    // and one multi draw per material
+    MeshArena::GetInstance().Bind(_draw_list.GetInstanceBuffer());
+    for (auto& draw : _material_draws) {
+      for (int i = 0; i < MaterialSlotCount; i++) {
+        BindMaterialTexture(draw.textures[i], i);
+      }
+      _draw_list.Draw(0, draw.first_command, draw.command_count);
     }
-
-    last_vp = _camera_projection * _camera_view;
+    MeshArena::GetInstance().Unbind();
 
     glDisable(GL_CULL_FACE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
   void Render::RenderSSAO()
   {
+    PROFILE_SCOPE("Render::RenderSSAO");
     if (!_enable_ssao) {
       return;
     }
     _ssao->Use();
 
-    auto jitter_base = GetHalton(_taa_jitter_idx) * _taa_jitter_ratio;
-    _gbuffer->SetFV2("jitter", glm::value_ptr(glm::vec2(jitter_base.x / _windows_width, jitter_base.y / _windows_height)));
-
     glBindFramebuffer(GL_FRAMEBUFFER, _ssao_frame_buffer);
     glViewport(0, 0, _windows_width, _windows_height);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -419,94 +881,69 @@ namespace render {
 
 
     // kernel
-    for (int i = 0; i < _ssao_kernal.size(); i++) {
-      std::string idx_name = "samples[" + std::to_string(i) + "]";
-      _ssao->SetFV3(idx_name.c_str(), glm::value_ptr(_ssao_kernal[i]));
+    int sample_count = std::min(static_cast<int>(_ssao_kernal.size()), _ssao_sample_count);
+    if (sample_count > 0) {
+      _ssao->SetFV3(_u_ssao_samples, glm::value_ptr(_ssao_kernal[0]), sample_count);
     }
 
-    // view, projection
-    _ssao->SetFM4("projection", glm::value_ptr(_camera_projection));
-
     renderQuad();
   }
   void Render::RenderLight()
   {
+    PROFILE_SCOPE("Render::RenderLight");
     glBindFramebuffer(GL_FRAMEBUFFER, _taa_jitter_fbo);
     glViewport(0, 0, _windows_width, _windows_height);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     _light->Use();
-    _light->SetFV3("cam_pos", glm::value_ptr(_camera_pos));
-    _light->SetFM4("cam_view", glm::value_ptr(_camera_view));
-
-    _light->SetInt("enable_ssao", _enable_ssao ? 1 : 0);
-    _light->SetInt("enable_shadow", _enable_shadow ? 1 : 0);
-    _light->SetInt("enable_ibl", _enable_ibl ? 1 : 0);
 
-    // shadow
-    int point_shadow_delta_base = 10;
-    int direction_shadow_delta_base = 20;
-    
-    for (int i = 0; i < _max_point_light_shadow; i++) {
-      std::string point_light_map = "point_light_shadow[" + std::to_string(i) + "].shadow_map";
-      _light->SetInt(point_light_map.c_str(), point_shadow_delta_base);
+    // shadow, sampler units are set once in ResolveUniforms
+    for (int i = 0; i < ShadowAtlas::PageCount; i++) {
+      glActiveTexture(GL_TEXTURE0 + point_shadow_delta_base + i);
+      glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, _shadow_atlas.GetPageTexture(i));
     }
+    glActiveTexture(GL_TEXTURE0 + direction_shadow_delta_base);
+    glBindTexture(GL_TEXTURE_2D, _shadow_atlas.GetAtlasTexture());
 
-    for (int i = 0; i < _max_direction_light_shadow; i++) {
-      std::string direction_light_map = "direction_light_shadow[" + std::to_string(i) + "].shadow_map";
-      _light->SetInt(direction_light_map.c_str(), direction_shadow_delta_base);
+    if (_cpu_light_binning) {
+      _light_binner.Bind();
     }
-
-    _light->SetInt("point_light_count", _point_light.size());
+    else {
+      _light_clusters.Bind();
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LightClusters::LightBinding, _point_light_ssbo);
     int idx = 0;
     int shadow_idx = 0;
-    for (const auto& p_light : _point_light) {
-      bool enable_shadow = _enable_shadow && p_light.second.enable_shadow && shadow_idx < _max_point_light_shadow;
-      if (enable_shadow) {
-        glActiveTexture(GL_TEXTURE0 + point_shadow_delta_base + shadow_idx);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, _point_shadow_map[p_light.second.shadow_map_idx]);
-        std::string shadow_name = "point_light_shadow[" + std::to_string(shadow_idx) + "]";
-        _light->SetInt((shadow_name + ".shadow_map").c_str(), point_shadow_delta_base + shadow_idx);
-        shadow_idx++;
-      }
-    }
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _point_light_ssbo);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, _cluster_point_lights.size() * sizeof(PLight), _cluster_point_lights.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-
-    /*glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, _light_grid_ssbo);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, _point_light_ssbo);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, _point_light_idx_ssbo);*/
-    _light->SetUInt("screen_width", _windows_width);
-    _light->SetUInt("screen_height", _windows_height);
-    _light->SetUInt("tile_size", _tile_size);
-    _light->SetFloat("z_near", _z_near);
-    _light->SetFloat("z_far", _z_far);
-    _light->SetUInt("z_slices", _z_slices);
-    _light->SetUInt("tile_x", _tile_x);
-    _light->SetUInt("tile_y", _tile_y);
-
-    _light->SetInt("direction_light_count", _direction_light.size());
-    idx = 0;
-    shadow_idx = 0;
     for (const auto& d_light : _direction_light) {
-      std::string base_name = "direction_light_list[" + std::to_string(idx) + "]";
-      bool enable_shadow = _enable_shadow && d_light.second.enable_shadow && shadow_idx < _max_direction_light_shadow;
+      if (idx >= LightUniforms::MaxDirectionLights) {
+        break;
+      }
+      bool enable_shadow = _enable_shadow && d_light.enable_shadow && d_light.shadow_ready &&
+        shadow_idx < LightUniforms::MaxDirectionShadows;
 
-      _light->SetFV3((base_name + ".direction").c_str(), glm::value_ptr(d_light.second.direction));
-      _light->SetFV3((base_name + ".diffuse").c_str(), glm::value_ptr(d_light.second.color));
-      _light->SetInt((base_name + ".shadow_idx").c_str(), enable_shadow ? shadow_idx : -1);
+      auto& light_data = _light_uniforms.direction_light_list[idx];
+      light_data.direction = d_light.direction;
+      light_data.diffuse = d_light.color;
+      light_data.shadow_idx = enable_shadow ? shadow_idx : -1;
       if (enable_shadow) {
-        glActiveTexture(GL_TEXTURE0 + direction_shadow_delta_base + shadow_idx);
-        glBindTexture(GL_TEXTURE_2D, _diretion_shadow_map[d_light.second.shadow_map_idx]);
-        std::string shadow_name = "direction_light_shadow[" + std::to_string(shadow_idx) + "]";
-        _light->SetInt((shadow_name + ".shadow_map").c_str(), direction_shadow_delta_base + shadow_idx);
-        _light->SetFM4((shadow_name + ".shadow_vp").c_str(), glm::value_ptr(d_light.second.vp));
+        _light_uniforms.direction_shadow_vp[shadow_idx] = d_light.vp;
+        _light_uniforms.direction_shadow_rect[shadow_idx] = _shadow_atlas.GetTileRect(d_light.shadow_tile);
         shadow_idx++;
       }
       idx++;
     }
+    _light_uniforms.direction_light_count = idx;
+
+    // only the used part of the list and the shadow matrices and tiles
+    glBindBuffer(GL_UNIFORM_BUFFER, _light_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, offsetof(LightUniforms, direction_light_list) + idx * sizeof(DirectionLightData),
+      &_light_uniforms);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(LightUniforms, direction_shadow_vp), shadow_idx * sizeof(glm::mat4),
+      _light_uniforms.direction_shadow_vp);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(LightUniforms, direction_shadow_rect), shadow_idx * sizeof(glm::vec4),
+      _light_uniforms.direction_shadow_rect);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
     auto position_ao_texture = GetTexture2DResource(_g_position_ao);
     auto albedo_roughness_texture = GetTexture2DResource(_g_albedo_roughness);
@@ -538,10 +975,9 @@ namespace render {
   }
   void Render::RenderSkyBox()
   {
+    PROFILE_SCOPE("Render::RenderSkyBox");
     glBindFramebuffer(GL_FRAMEBUFFER, _taa_jitter_fbo);
     _skybox->Use();
-    _skybox->SetFM4("view", glm::value_ptr(_camera_view));
-    _skybox->SetFM4("projection", glm::value_ptr(_camera_projection));
     _skybox->SetInt("skybox", 0);
     
     glBindFramebuffer(GL_READ_FRAMEBUFFER, _gbuffer_frame_buffer);
@@ -561,6 +997,7 @@ namespace render {
   }
   void Render::RenderTAA()
   {
+    PROFILE_SCOPE("Render::RenderTAA");
     if (!_taa_jitter_idx) {
       // first render taa
       glBindFramebuffer(GL_READ_FRAMEBUFFER, _taa_jitter_fbo);
@@ -591,8 +1028,6 @@ namespace render {
       _taa_sample->SetInt("last_frame", 0);
       _taa_sample->SetInt("jitter_frame", 1);
       _taa_sample->SetInt("velocity", 2);
-      _taa_sample->SetUInt("screen_width", _windows_width);
-      _taa_sample->SetUInt("screen_height", _windows_height);
       _taa_sample->SetFloat("blend_ratio", _taa_blend_ratio);
       renderQuad();
     }
@@ -605,8 +1040,9 @@ namespace render {
   }
   void Render::RenderPost()
   {
+    PROFILE_SCOPE("Render::RenderPost");
     glBindFramebuffer(GL_READ_FRAMEBUFFER, _taa_his_fbo);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _output_fbo);
     glBlitFramebuffer(0, 0, _windows_width, _windows_height, 0, 0, _windows_width,
       _windows_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
     // RenderTAA();
@@ -623,44 +1059,59 @@ namespace render {
     _cluster_init->SetFloat("z_near", _z_near);
     _cluster_init->SetFloat("z_far", _z_far);
     _cluster_init->SetUInt("tile_size", _tile_size);
-    _cluster_init->SetFM4("inverse_projection", glm::value_ptr(glm::inverse(
-      glm::perspective(glm::radians(60.0f), float(_windows_width)/ _windows_height, _z_near, _z_far))));
+    auto inverse_projection = glm::inverse(
+      glm::perspective(glm::radians(60.0f), float(_windows_width)/ _windows_height, _z_near, _z_far));
+    _cluster_init->SetFM4("inverse_projection", glm::value_ptr(inverse_projection));
 
     _cluster_init->Compute(_tile_x, _tile_y, _z_slices);
+
+    std::vector<AABBBox> boxes;
+    BuildClusterBoxes(inverse_projection, _windows_width, _windows_height, _tile_size,
+      _tile_x, _tile_y, _z_slices, _z_near, _z_far, boxes);
+    _light_binner.SetClusterBoxes(boxes, _tile_x, _tile_y, _z_slices);
   }
-  void Render::ComputeClusterLight()
+  void Render::UpdateClusterLights()
   {
     _cluster_point_lights.resize(_point_light.size());
     int idx = 0;
     for (auto const& light : _point_light) {
-      _cluster_point_lights[idx].diffuse = light.second.color;
-      _cluster_point_lights[idx].position = light.second.position;
-      _cluster_point_lights[idx].radius = light.second.radius;
+      _cluster_point_lights[idx].diffuse = light.color;
+      _cluster_point_lights[idx].position = light.position;
+      _cluster_point_lights[idx].radius = light.radius;
       _cluster_point_lights[idx].shadow_idx = -1;
       idx++;
     }
 
+    // runs while the shadow and gbuffer passes are submitted
+    if (_cpu_light_binning) {
+      _light_binner.Schedule(_jobs, _cluster_point_lights, _camera_view);
+    }
+  }
+  void Render::UploadClusterLights()
+  {
+    // never empty, a zero sized buffer can not be bound, and only
+    // reallocated to grow
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, _point_light_ssbo);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, _cluster_point_lights.size() * sizeof(PLight), _cluster_point_lights.data(), GL_DYNAMIC_COPY);
-
-    unsigned int init_index = 0;
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _global_index_ssbo);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), &init_index, GL_DYNAMIC_COPY);
-
-    _cluster_light->Use();
-    _cluster_light->SetFM4("view", glm::value_ptr(_camera_view));
-
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, _cluster_ssbo);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, _light_grid_ssbo);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, _point_light_ssbo);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, _point_light_idx_ssbo);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, _global_index_ssbo);
-
-    unsigned int sum_cluster = _tile_x * _tile_y * _z_slices;
-    _cluster_light->Compute(1, (sum_cluster + 255) / 256, 4);
-
+    if (_cluster_point_lights.size() > _point_light_capacity || !_point_light_capacity) {
+      _point_light_capacity = std::max<size_t>({ _point_light_capacity * 2, _cluster_point_lights.size(), 1 });
+      glBufferData(GL_SHADER_STORAGE_BUFFER, _point_light_capacity * sizeof(PLight), nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (!_cluster_point_lights.empty()) {
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, _cluster_point_lights.size() * sizeof(PLight), _cluster_point_lights.data());
+    }
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
   }
+  void Render::ComputeClusterLight()
+  {
+    PROFILE_SCOPE("Render::ComputeClusterLight");
+    if (_cpu_light_binning) {
+      _light_binner.Finish();
+      return;
+    }
+    auto position_texture = GetTexture2DResource(_g_position_ao);
+    _light_clusters.Assign(position_texture->GetTexture(), _windows_width, _windows_height,
+      _cluster_ssbo, _point_light_ssbo, static_cast<uint32_t>(_cluster_point_lights.size()));
+  }
   void Render::InitPbrRenderBuffer()
   {
     glGenRenderbuffers(1, &_pbr_render_buffer);
@@ -708,7 +1159,7 @@ namespace render {
   }
   void Render::InitPbrSkybox()
   {
-    uint64_t hdr_skybox = GenTexture2DFromFile(_pbr_skybox_path.c_str(), false, true);
+    auto hdr_skybox = GenTexture2DFromFile(_pbr_skybox_path.c_str(), false, true);
     auto hdr_skybox_texture = GetTexture2DResource(hdr_skybox, false);
     hdr_skybox_texture->SetFlipVectical(true);
     hdr_skybox_texture->Load();
@@ -770,7 +1221,7 @@ namespace render {
     _pbr_prefilter->SetInt("skybox", 0);
 
     glBindFramebuffer(GL_FRAMEBUFFER, _pbr_frame_buffer);
-    unsigned int maxMipLevels = 5;
+    unsigned int maxMipLevels = _pbr_prefilter_levels;
     for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
     {
       // reisze framebuffer according to mip-level size.
@@ -814,29 +1265,92 @@ namespace render {
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
+  uint64_t Render::GetPbrCacheKey()
+  {
+    auto res = HashFile(_pbr_skybox_path.c_str());
+    if (!res) {
+      return 0;
+    }
+    res = HashCombine(res, pbr_cache_version);
+    res = HashCombine(res, _pbr_skybox_width);
+    res = HashCombine(res, _pbr_skybox_height);
+    res = HashCombine(res, _pbr_irradiance_width);
+    res = HashCombine(res, _pbr_irradiance_height);
+    res = HashCombine(res, _pbr_prefilter_width);
+    res = HashCombine(res, _pbr_prefilter_height);
+    return HashCombine(res, _pbr_prefilter_levels);
+  }
+  std::string Render::GetPbrCachePath(const char* name)
+  {
+    // "sky.hdr" -> "sky.hdr.irradiance.texcache"
+    return _pbr_skybox_path + "." + name + ".texcache";
+  }
+  bool Render::LoadPbrCache()
+  {
+    PROFILE_SCOPE("LoadPbrCache");
+    auto key = GetPbrCacheKey();
+    if (!key) {
+      return false;
+    }
+
+    auto skybox_texture = GetTextureCubeResource(_pbr_texture_skybox);
+    auto irradiance_texture = GetTextureCubeResource(_pbr_texture_irradiance);
+    auto prefilter_texture = GetTextureCubeResource(_pbr_texture_prefilter);
+    if (!TextureCache::Load(GetPbrCachePath("skybox").c_str(), key, skybox_texture->GetTexture(),
+          { true, _pbr_skybox_width, _pbr_skybox_height, 1, 3 }) ||
+      !TextureCache::Load(GetPbrCachePath("irradiance").c_str(), key, irradiance_texture->GetTexture(),
+          { true, _pbr_irradiance_width, _pbr_irradiance_height, 1, 3 }) ||
+      !TextureCache::Load(GetPbrCachePath("prefilter").c_str(), key, prefilter_texture->GetTexture(),
+          { true, _pbr_prefilter_width, _pbr_prefilter_height, _pbr_prefilter_levels, 3 })) {
+      return false;
+    }
+    skybox_texture->GenMipmap();
+    return true;
+  }
+  void Render::SavePbrCache()
+  {
+    auto key = GetPbrCacheKey();
+    if (!key) {
+      return;
+    }
+
+    // the skybox mips are generated again after loading
+    TextureCache::Save(GetPbrCachePath("skybox").c_str(), key, GetTextureCubeResource(_pbr_texture_skybox)->GetTexture(),
+      { true, _pbr_skybox_width, _pbr_skybox_height, 1, 3 });
+    TextureCache::Save(GetPbrCachePath("irradiance").c_str(), key, GetTextureCubeResource(_pbr_texture_irradiance)->GetTexture(),
+      { true, _pbr_irradiance_width, _pbr_irradiance_height, 1, 3 });
+    TextureCache::Save(GetPbrCachePath("prefilter").c_str(), key, GetTextureCubeResource(_pbr_texture_prefilter)->GetTexture(),
+      { true, _pbr_prefilter_width, _pbr_prefilter_height, _pbr_prefilter_levels, 3 });
+  }
+  bool Render::LoadPbrBrdf()
+  {
+    return TextureCache::Load(pbr_brdf_path, pbr_cache_version, GetTexture2DResource(_pbr_texture_brdf)->GetTexture(),
+      { false, _pbr_brdf_width, _pbr_brdf_height, 1, 2 });
+  }
+  void Render::SavePbrBrdf()
+  {
+    TextureCache::Save(pbr_brdf_path, pbr_cache_version, GetTexture2DResource(_pbr_texture_brdf)->GetTexture(),
+      { false, _pbr_brdf_width, _pbr_brdf_height, 1, 2 });
+  }
   void Render::InitCluster()
   {
     glGenBuffers(1, &_cluster_ssbo);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, _cluster_ssbo);
     glBufferData(GL_SHADER_STORAGE_BUFFER, _z_slices * _tile_x * _tile_y * sizeof(AABBBox), nullptr, GL_DYNAMIC_COPY);
 
+    _light_binner.Init(_z_slices * _tile_x * _tile_y);
     ComputeClusterBox();
 
-    glGenBuffers(1, &_light_grid_ssbo);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _light_grid_ssbo);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, _z_slices * _tile_x * _tile_y * sizeof(LightGrid), nullptr, GL_DYNAMIC_COPY);
-
-    glGenBuffers(1, &_global_index_ssbo);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _global_index_ssbo);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY);
-
-    glGenBuffers(1, &_point_light_idx_ssbo);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _point_light_idx_ssbo);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, 1000000 * sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY);
+    _light_clusters.Init(_z_slices * _tile_x * _tile_y, _cluster_mark, _cluster_compact, _cluster_light, _cluster_scan);
 
     glGenBuffers(1, &_point_light_ssbo);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
   }
+  void Render::InitDrawList()
+  {
+    // gbuffer, then a view per shadow rendered in a frame
+    _draw_list.Init(1 + _max_shadow_updates, _cull);
+  }
   void Render::InitShader()
   {
     delete _pbr_hdr_preprocess;
@@ -849,7 +1363,11 @@ namespace render {
     delete _shadow_shader_point;
     delete _shadow_shader_direction;
     delete _cluster_init;
+    delete _cluster_mark;
+    delete _cluster_compact;
+    delete _cluster_scan;
     delete _cluster_light;
+    delete _cull;
     delete _taa_sample;
 
     _pbr_hdr_preprocess = new Shader("shader/cube_sampler_vs.glsl", "shader/pbr_hdr_preprocess_fs.glsl");
@@ -863,9 +1381,134 @@ namespace render {
     _shadow_shader_direction = new Shader("shader/shadow_vs.glsl", "shader/shadow_fg.glsl");
     _ssao = new Shader("shader/quad_sampler_vs.glsl", "shader/ssao_fs.glsl");
     _cluster_init = new Shader("shader/cluster_init_cs.glsl");
+    _cluster_mark = new Shader("shader/cluster_mark_cs.glsl");
+    _cluster_compact = new Shader("shader/cluster_compact_cs.glsl");
+    _cluster_scan = new Shader("shader/cluster_scan_cs.glsl");
     _cluster_light = new Shader("shader/cluster_light_cs.glsl");
+    _cull = new Shader("shader/cull_cs.glsl");
     _taa_sample = new Shader("shader/quad_sampler_vs.glsl", "shader/taa_sample.glsl");
+
+    ResolveUniforms();
   }
+  void Render::ResolveUniforms()
+  {
+    Shader* shaders[] = {
+      _pbr_hdr_preprocess, _pbr_irradiance, _pbr_prefilter, _pbr_brdf,
+      _gbuffer, _ssao, _light, _skybox, _shadow_shader_point, _shadow_shader_direction,
+      _cluster_init, _cluster_mark, _cluster_compact, _cluster_scan, _cluster_light, _cull, _taa_sample
+    };
+    for (auto shader : shaders) {
+      shader->BindUniformBlock("FrameUniforms", UniformBinding_Frame);
+      shader->BindUniformBlock("ViewUniforms", UniformBinding_View);
+      shader->BindUniformBlock("LightUniforms", UniformBinding_Light);
+    }
+
+    _u_shadow_point_matrices = _shadow_shader_point->GetUniform("shadowMatrices");
+    _u_shadow_point_layer = _shadow_shader_point->GetUniform("cube_layer");
+
+    _u_ssao_samples = _ssao->GetUniform("samples");
+    auto samples_info = _ssao->GetUniformInfo("samples");
+    _ssao_sample_count = samples_info ? samples_info->size : 0;
+
+    // shadow maps always sit on the same units
+    _light->Use();
+    for (int i = 0; i < ShadowAtlas::PageCount; i++) {
+      std::string page_name = "point_shadow_pages[" + std::to_string(i) + "]";
+      _light->SetInt(page_name.c_str(), point_shadow_delta_base + i);
+    }
+    _light->SetInt("direction_shadow_atlas", direction_shadow_delta_base);
+    glUseProgram(0);
+  }
+  void Render::InitUniformBuffers()
+  {
+    glGenBuffers(1, &_frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, _frame_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UniformBinding_Frame, _frame_ubo);
+
+    glGenBuffers(1, &_view_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, _view_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UniformBinding_View, _view_ubo);
+
+    glGenBuffers(1, &_light_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, _light_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UniformBinding_Light, _light_ubo);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+  void Render::InitStats()
+  {
+    // same order as RenderPass
+    _stats.AddPass("cluster");
+    _stats.AddPass("shadow");
+    _stats.AddPass("gbuffer");
+    _stats.AddPass("ssao");
+    _stats.AddPass("light");
+    _stats.AddPass("skybox");
+    _stats.AddPass("taa");
+  }
+  void Render::UploadFrameUniforms()
+  {
+    _frame_uniforms.screen_width = _windows_width;
+    _frame_uniforms.screen_height = _windows_height;
+    _frame_uniforms.tile_size = _tile_size;
+    _frame_uniforms.z_slices = _z_slices;
+    _frame_uniforms.tile_x = _tile_x;
+    _frame_uniforms.tile_y = _tile_y;
+    _frame_uniforms.z_near = _z_near;
+    _frame_uniforms.z_far = _z_far;
+    _frame_uniforms.enable_ssao = _enable_ssao ? 1 : 0;
+    _frame_uniforms.enable_shadow = _enable_shadow ? 1 : 0;
+    _frame_uniforms.enable_ibl = _enable_ibl ? 1 : 0;
+
+    auto vp = _camera_projection * _camera_view;
+    auto jitter_base = GetHalton(_taa_jitter_idx) * _taa_jitter_ratio;
+    _view_uniforms.view = _camera_view;
+    _view_uniforms.projection = _camera_projection;
+    // frame indices start at 1, no history on the first one
+    _view_uniforms.last_vp = _frame_index > 1 ? _last_vp : vp;
+    _view_uniforms.cam_pos = _camera_pos;
+    _view_uniforms.jitter = glm::vec2(jitter_base.x / _windows_width, jitter_base.y / _windows_height);
+    _last_vp = vp;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, _frame_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &_frame_uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, _view_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ViewUniforms), &_view_uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+  void Render::BindMaterialTexture(TextureHandle handle, int slot)
+  {
+    auto texture = GetTexture2DResource(handle, false);
+    if (texture && texture->IsLoaded()) {
+      texture->BindToTexture(slot);
+      return;
+    }
+
+    if (texture) {
+      texture->LoadAsync();
+    }
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D, _material_placeholders[slot]);
+  }
+
+  void Render::InitPlaceholders()
+  {
+    // neutral material: grey, flat normal, not metalic, rough, no occlusion
+    const unsigned char colors[MaterialSlotCount][3] = {
+      { 128, 128, 128 },
+      { 128, 128, 255 },
+      { 0, 0, 0 },
+      { 255, 255, 255 },
+      { 255, 255, 255 },
+    };
+    for (int i = 0; i < MaterialSlotCount; i++) {
+      _material_placeholders[i] = genTexture2D(1, 1, false, 3, colors[i]);
+    }
+  }
+
   void Render::InitObjects()
   {
     _pbr_texture_skybox = GenTextureCube(_pbr_skybox_width, _pbr_skybox_height, true);
@@ -886,18 +1529,7 @@ namespace render {
   }
   void Render::InitShadowMap()
   {
-    _point_shadow_count = 0;
-    _diretion_shadow_count = 0;
-
-    for (int i = _point_shadow_map.size(); i < _max_point_light_shadow; i++) {
-      _point_shadow_map.push_back(GenShadowMap(2));
-    }
-
-    for (int i = _diretion_shadow_map.size(); i < _max_direction_light_shadow; i++) {
-      _diretion_shadow_map.push_back(GenShadowMap(1));
-    }
-
-    glGenFramebuffers(1, &_shadow_frame_buffer);
+    _shadow_atlas.Init(_shadow_atlas_size, _shadow_min_tile_size);
   }
   std::vector<glm::vec3> GenSSAONoise(int width, int height) {
     std::vector<glm::vec3> res;
@@ -1020,40 +1652,4 @@ namespace render {
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
-  unsigned int Render::GenShadowMap(int light_type)
-  {
-    unsigned int res;
-    glGenTextures(1, &res);
-
-    if (light_type == 1) {
-      // direction light
-      glBindTexture(GL_TEXTURE_2D, res);
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, _shadow_map_width, _shadow_map_height,
-        0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_GREATER);
-      glBindTexture(GL_TEXTURE_2D, 0);
-    } else if (light_type == 2) {
-      // point light
-      glBindTexture(GL_TEXTURE_CUBE_MAP, res);
-      for (int i = 0; i < 6; i++) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
-          _shadow_map_width, _shadow_map_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-      }
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
-      glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    }
-
-    return res;
-  }
 }
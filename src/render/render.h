@@ -1,48 +1,54 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <unordered_map>
 
 #include <glm/glm.hpp>
 
+#include "handle.h"
+#include "bounds.h"
+#include "gpu_draw_list.h"
+#include "light_binner.h"
+#include "light_clusters.h"
+#include "Mesh.h"
+#include "resource.h"
+#include "Shader.h"
+#include "render_stats.h"
+#include "shadow_atlas.h"
+
 // pass1: shadow for each light
 // pass2: gbuffer
 // pass3: ssao
 // pass4: lighting
 
+namespace core {
+  class JobSystem;
+}
+
 namespace render {
-  class Shader;
   class Model;
 
-  struct AABBBox {
-    glm::vec4 minPoint;
-    glm::vec4 maxPoint;
-  };
-
-  struct PLight {
-    glm::vec3 position;
-    int shadow_idx;
-    glm::vec3 diffuse;
-    float radius;
-  };
-
-  struct LightGrid {
-    unsigned int offset;
-    unsigned int count;
-  };
-
   struct RenderItem {
     uint64_t obj_id;
     glm::mat4 transform;
     glm::mat4 last_trans;
-    uint64_t mesh;
-    uint64_t albedo;
-    uint64_t normal;
-    uint64_t metalic;
-    uint64_t roughness;
-    uint64_t ao;
+    MeshHandle mesh;
+    TextureHandle albedo;
+    TextureHandle normal;
+    TextureHandle metalic;
+    TextureHandle roughness;
+    TextureHandle ao;
+
+    // inner
+    uint64_t move_frame;
+    Bounds local_bounds;
+    // mesh loaded and not empty, local_bounds is set
+    bool has_bounds;
+    // GpuBatch index, GpuObject::NoBatch until the mesh is loaded
+    uint32_t draw_batch;
   };
 
   struct RenderPointLight {
@@ -55,7 +61,13 @@ namespace render {
 
     // inner
     std::vector<glm::mat4> vps;
-    int shadow_map_idx;
+    ShadowCube shadow_cube;
+    // the light or a caster in range changed since the cube was rendered
+    bool shadow_dirty;
+    // rendered since the cube was allocated, stale contents are still used
+    bool shadow_ready;
+    // projected radius in pixels, 0 off screen, picks the page
+    float shadow_coverage;
   };
 
   struct RenderDirectionLight {
@@ -66,10 +78,98 @@ namespace render {
     bool enable_shadow;
 
     // inner
-    int shadow_map_idx;
+    ShadowTile shadow_tile;
+    bool shadow_dirty;
+    bool shadow_ready;
     glm::mat4 vp;
   };
 
+  // draw commands sharing the material textures, one multi draw in the
+  // gbuffer pass
+  struct MaterialDraw {
+    // albedo, normal, metalic, roughness, ao
+    TextureHandle textures[5];
+    uint32_t first_command;
+    uint32_t command_count;
+  };
+
+  // timed passes, ids in RenderStats
+  enum RenderPass {
+    RenderPass_Cluster = 0,
+    RenderPass_Shadow,
+    RenderPass_Gbuffer,
+    RenderPass_SSAO,
+    RenderPass_Light,
+    RenderPass_Skybox,
+    RenderPass_TAA,
+    RenderPass_Count,
+  };
+
+  // uniform block binding points, shared by every program
+  enum UniformBinding {
+    UniformBinding_Frame = 0,
+    UniformBinding_View = 1,
+    UniformBinding_Light = 2,
+  };
+
+  // std140 mirrors of the uniform blocks in the shaders, keep both in sync
+  struct FrameUniforms {
+    uint32_t screen_width;
+    uint32_t screen_height;
+    uint32_t tile_size;
+    uint32_t z_slices;
+    uint32_t tile_x;
+    uint32_t tile_y;
+    float z_near;
+    float z_far;
+    int32_t enable_ssao;
+    int32_t enable_shadow;
+    int32_t enable_ibl;
+    int32_t pad0;
+  };
+
+  struct ViewUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 last_vp;
+    glm::vec3 cam_pos;
+    float pad0;
+    glm::vec2 jitter;
+    glm::vec2 pad1;
+  };
+
+  struct DirectionLightData {
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 diffuse;
+    int32_t shadow_idx;
+  };
+
+  struct LightUniforms {
+    static constexpr int MaxDirectionLights = 256;
+    static constexpr int MaxDirectionShadows = 16;
+
+    int32_t direction_light_count;
+    int32_t pad0[3];
+    DirectionLightData direction_light_list[MaxDirectionLights];
+    glm::mat4 direction_shadow_vp[MaxDirectionShadows];
+    // tile of each shadow in the atlas, ShadowAtlas::GetTileRect
+    glm::vec4 direction_shadow_rect[MaxDirectionShadows];
+  };
+
+  static_assert(sizeof(FrameUniforms) == 48, "FrameUniforms must match std140");
+  static_assert(offsetof(ViewUniforms, jitter) == 208, "ViewUniforms must match std140");
+  static_assert(sizeof(DirectionLightData) == 32, "DLight must match std140");
+  static_assert(offsetof(LightUniforms, direction_shadow_vp) == 16 + 32 * LightUniforms::MaxDirectionLights,
+    "LightUniforms must match std140");
+  static_assert(offsetof(LightUniforms, direction_shadow_rect) ==
+    offsetof(LightUniforms, direction_shadow_vp) + 64 * LightUniforms::MaxDirectionShadows,
+    "LightUniforms must match std140");
+
+  typedef Handle<RenderItem> RenderItemHandle;
+  typedef Handle<RenderPointLight> PointLightHandle;
+  typedef Handle<RenderDirectionLight> DirectionLightHandle;
+
   class Render {
   public:
     static Render& GetInstance() {
@@ -85,20 +185,31 @@ namespace render {
     // must invoke
     void SetPbrSkyBox(const char* path);
     void SetCameraTrans(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& pos);
+    void SetJobSystem(core::JobSystem* jobs) { _jobs = jobs; }
+    // final image target, 0 is the window
+    void SetOutputFramebuffer(unsigned int fbo) { _output_fbo = fbo; }
 
-  public:
-    // modify
-    void AddRenderItem(const RenderItem& new_item);
-    void DelRenderItem(uint64_t obj_id);
-    void ClearRenderItem();
-
-    void AddPointLight(const RenderPointLight& new_light);
-    void DelPointLight(uint64_t light_id);
-    void ClearPointLight();
+    const RenderStats& GetStats() const { return _stats; }
+    RenderStats& GetStats() { return _stats; }
+    // csv or json by extension
+    bool ExportStats(const char* path) const;
 
-    void AddDirectionLight(const RenderDirectionLight& new_light);
-    void DelDirectionLight(uint64_t light_id);
-    void ClearDirectionLight();
+  public:
+    // persistent proxies, only changes have to be pushed
+    RenderItemHandle CreateRenderItem(const RenderItem& item);
+    // mesh and textures, transforms are kept
+    void UpdateRenderItem(RenderItemHandle handle, const RenderItem& item);
+    // previous transform becomes last_trans for velocity
+    void UpdateTransform(RenderItemHandle handle, const glm::mat4& trans);
+    void DestroyRenderItem(RenderItemHandle handle);
+
+    PointLightHandle CreatePointLight(const RenderPointLight& light);
+    void UpdatePointLight(PointLightHandle handle, const RenderPointLight& light);
+    void DestroyPointLight(PointLightHandle handle);
+
+    DirectionLightHandle CreateDirectionLight(const RenderDirectionLight& light);
+    void UpdateDirectionLight(DirectionLightHandle handle, const RenderDirectionLight& light);
+    void DestroyDirectionLight(DirectionLightHandle handle);
 
   private:
     Render();
@@ -108,6 +219,7 @@ namespace render {
     void PostUpdateTAA();
 
     // render
+    // shadows that changed, within the update budget
     void RenderShadow();
     void RenderGbuffer();
     void RenderSSAO();
@@ -116,7 +228,35 @@ namespace render {
     void RenderTAA();
     void RenderPost();
 
+    // culling
+    void UpdateBounds();
+
+    // gpu driven drawing, the layout is rebuilt when items are added,
+    // removed or change mesh or material
+    void BuildDrawLayout();
+    void UpdateDrawObject(const RenderItem& item);
+    // view of the draw list culled for each shadow rendered in a frame
+    int GetShadowView(int update_idx) const { return 1 + update_idx; }
+    // streams the texture in, the slot's placeholder is bound meanwhile
+    void BindMaterialTexture(TextureHandle handle, int slot);
+
+    // shadow cache
+    // atlas slots of the shadowed lights, sized by screen coverage
+    void UpdateShadowSlots();
+    // lights whose range saw a caster change since the last frame
+    void InvalidateShadows();
+    void RenderPointShadow(RenderPointLight& light, int view);
+    void RenderDirectionShadow(RenderDirectionLight& light, int view);
+
+    // on the GPU, and on the CPU for the light binner
     void ComputeClusterBox();
+    // point lights of the frame, starts the CPU light binning
+    void UpdateClusterLights();
+    // once the shadow pass assigned shadow maps, for the cluster and light
+    // passes
+    void UploadClusterLights();
+    // after the gbuffer, only clusters with pixels get lights, or the CPU
+    // binning is waited for
     void ComputeClusterLight();
 
     // init
@@ -125,18 +265,29 @@ namespace render {
     void InitPbrIrradiance();
     void InitPbrPrefilter();
     void InitPbrBrdf();
+    // skybox, irradiance and prefilter maps saved next to the hdr
+    uint64_t GetPbrCacheKey();
+    std::string GetPbrCachePath(const char* name);
+    bool LoadPbrCache();
+    void SavePbrCache();
+    bool LoadPbrBrdf();
+    void SavePbrBrdf();
 
     void InitCluster();
+    void InitDrawList();
+    void InitUniformBuffers();
+    void InitStats();
     void InitShader();
+    void ResolveUniforms();
+    // frame and view blocks, once per frame before any pass
+    void UploadFrameUniforms();
     void InitObjects();
+    void InitPlaceholders();
     void InitPBR();
     void InitShadowMap();
     void InitSSAO();
     void InitTAA();
 
-  private:
-    unsigned int GenShadowMap(int light_type);
-
   private:
     // shader
     Shader* _pbr_hdr_preprocess;
@@ -152,15 +303,34 @@ namespace render {
     Shader* _shadow_shader_direction;
 
     Shader* _cluster_init;
+    Shader* _cluster_mark;
+    Shader* _cluster_compact;
+    Shader* _cluster_scan;
     Shader* _cluster_light;
+    Shader* _cull;
 
     Shader* _taa_sample;
 
+    // uniforms resolved after InitShader, so the passes don't look up names
+    UniformLocation _u_shadow_point_matrices;
+    UniformLocation _u_shadow_point_layer;
+    UniformLocation _u_ssao_samples;
+    int _ssao_sample_count;
+
+    // uniform buffers, bound at UniformBinding
+    unsigned int _frame_ubo;
+    unsigned int _view_ubo;
+    unsigned int _light_ubo;
+    FrameUniforms _frame_uniforms;
+    ViewUniforms _view_uniforms;
+    LightUniforms _light_uniforms;
+    glm::mat4 _last_vp;
+
     // pbr init texture
-    uint64_t _pbr_texture_skybox;
-    uint64_t _pbr_texture_irradiance;
-    uint64_t _pbr_texture_prefilter;
-    uint64_t _pbr_texture_brdf;
+    TextureCubeHandle _pbr_texture_skybox;
+    TextureCubeHandle _pbr_texture_irradiance;
+    TextureCubeHandle _pbr_texture_prefilter;
+    TextureHandle _pbr_texture_brdf;
 
     unsigned int _pbr_frame_buffer;
     unsigned int _pbr_render_buffer;
@@ -168,9 +338,6 @@ namespace render {
     unsigned int _gbuffer_frame_buffer;
     unsigned int _gbuffer_render_buffer;
 
-    unsigned int _shadow_frame_buffer;
-    unsigned int _shadow_render_buffer;
-
     // ssao
     unsigned int _ssao_map;
     unsigned int _ssao_noise_map;
@@ -179,13 +346,13 @@ namespace render {
     std::vector<glm::vec3> _ssao_kernal;
 
     // gbuffer
-    uint64_t _g_position_ao;
-    uint64_t _g_albedo_roughness;
-    uint64_t _g_normal_metalic;
-    uint64_t _g_view_position;
-    uint64_t _g_view_normal;
-    uint64_t _g_tta_velocity;
-    uint64_t _g_tta_depth;
+    TextureHandle _g_position_ao;
+    TextureHandle _g_albedo_roughness;
+    TextureHandle _g_normal_metalic;
+    TextureHandle _g_view_position;
+    TextureHandle _g_view_normal;
+    TextureHandle _g_tta_velocity;
+    TextureHandle _g_tta_depth;
 
     // active camera
     glm::mat4 _camera_view;
@@ -194,11 +361,14 @@ namespace render {
 
     // cluster
     unsigned int _cluster_ssbo;
-    unsigned int _light_grid_ssbo;
     unsigned int _point_light_ssbo;
-    unsigned int _point_light_idx_ssbo;
-    unsigned int _global_index_ssbo;
+    // lights _point_light_ssbo has room for
+    size_t _point_light_capacity;
     std::vector<PLight> _cluster_point_lights;
+    LightClusters _light_clusters;
+    LightBinner _light_binner;
+    // bins on the job system instead of the cluster compute passes
+    bool _cpu_light_binning;
 
     // TAA
     unsigned int _taa_jitter_fbo;
@@ -212,17 +382,43 @@ namespace render {
     unsigned int _taa_last_fbo;
     unsigned int _taa_last_texture;
 
+    unsigned int _output_fbo;
+
     // objs to render
-    std::unordered_map<uint64_t, RenderItem> _render_objects;
+    DenseTable<RenderItem> _render_objects;
+    // moved this frame / last frame, the latter get last_trans settled
+    std::vector<RenderItemHandle> _moved_items;
+    std::vector<RenderItemHandle> _settle_items;
+    uint64_t _frame_index;
+
+    // mesh not loaded or changed, no bounds yet
+    std::vector<RenderItemHandle> _pending_bounds;
+
+    // gbuffer texture units: albedo, normal, metalic, roughness, ao
+    static constexpr int MaterialSlotCount = 5;
+    unsigned int _material_placeholders[MaterialSlotCount];
+    // ms per frame spent copying streamed textures
+    float _texture_upload_budget;
+
+    // objects and commands of every item, view 0 is the gbuffer, then one
+    // per shadow rendered in a frame
+    GpuDrawList _draw_list;
+    std::vector<MaterialDraw> _material_draws;
+    bool _draw_layout_dirty;
 
     // light
-    std::unordered_map<uint64_t, RenderPointLight> _point_light;
-    std::unordered_map<uint64_t, RenderDirectionLight> _direction_light;
+    DenseTable<RenderPointLight> _point_light;
+    DenseTable<RenderDirectionLight> _direction_light;
 
-    int _point_shadow_count;
-    std::vector<unsigned int> _point_shadow_map;
-    int _diretion_shadow_count;
-    std::vector<unsigned int> _diretion_shadow_map;
+    ShadowAtlas _shadow_atlas;
+    // world bounds of casters that moved, appeared or went away since the
+    // last shadow pass
+    std::vector<Bounds> _shadow_dirty_bounds;
+    // rendered last frame
+    int _shadow_update_count;
+
+  private:
+    core::JobSystem* _jobs;
 
   private:
     std::string _pbr_skybox_path;
@@ -241,14 +437,17 @@ namespace render {
 
     int _pbr_prefilter_width;
     int _pbr_prefilter_height;
+    int _pbr_prefilter_levels;
 
     int _pbr_brdf_width;
     int _pbr_brdf_height;
 
-    int _shadow_map_width;
-    int _shadow_map_height;
-    int _max_point_light_shadow;
-    int _max_direction_light_shadow;
+    int _shadow_atlas_size;
+    int _shadow_min_tile_size;
+    int _direction_shadow_size;
+    // draw list views for shadows, the most rendered in one frame
+    int _max_shadow_updates;
+    int _shadow_update_budget;
 
     // cluster
     float _z_near;
@@ -269,13 +468,8 @@ namespace render {
     bool _enable_ssao;
 
   private:
-    float _dt_cluster_box_pass;
-    float _dt_shadow_pass;
-    float _dt_gbuffer_pass;
-    float _dt_ssao_pass;
-    float _dt_light_pass;
-    float _dt_skybox_pass;
-    float _dt_imgui_pass;
+    RenderStats _stats;
+    bool _show_stats_detail;
 
   };
 }
@@ -0,0 +1,226 @@
+#include "render_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <glad/glad.h>
+
+namespace render {
+  TimingSeries::TimingSeries(size_t capacity)
+    : _samples(capacity > 0 ? capacity : 1), _next(0), _count(0), _last(0.0f)
+  {
+  }
+
+  void TimingSeries::Push(float value)
+  {
+    _samples[_next] = value;
+    _next = (_next + 1) % _samples.size();
+    _count = std::min(_count + 1, _samples.size());
+    _last = value;
+  }
+
+  void TimingSeries::Clear()
+  {
+    _next = 0;
+    _count = 0;
+    _last = 0.0f;
+  }
+
+  void TimingSeries::SetCapacity(size_t capacity)
+  {
+    _samples.assign(capacity > 0 ? capacity : 1, 0.0f);
+    Clear();
+  }
+
+  float TimingSeries::Min() const
+  {
+    if (!_count) {
+      return 0.0f;
+    }
+    return *std::min_element(_samples.begin(), _samples.begin() + _count);
+  }
+
+  float TimingSeries::Max() const
+  {
+    if (!_count) {
+      return 0.0f;
+    }
+    return *std::max_element(_samples.begin(), _samples.begin() + _count);
+  }
+
+  float TimingSeries::Avg() const
+  {
+    if (!_count) {
+      return 0.0f;
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < _count; i++) {
+      sum += _samples[i];
+    }
+    return static_cast<float>(sum / _count);
+  }
+
+  float TimingSeries::Percentile(float p) const
+  {
+    if (!_count) {
+      return 0.0f;
+    }
+    std::vector<float> sorted(_samples.begin(), _samples.begin() + _count);
+    // nearest rank
+    size_t rank = static_cast<size_t>(std::ceil(std::clamp(p, 0.0f, 1.0f) * _count));
+    size_t idx = rank > 0 ? rank - 1 : 0;
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    return sorted[idx];
+  }
+
+  RenderStats::~RenderStats()
+  {
+    for (auto& query : _queries) {
+      glDeleteQueries(FramesInFlight, query.queries);
+    }
+  }
+
+  int RenderStats::AddPass(const char* name)
+  {
+    PassStats stats;
+    stats.name = name;
+    stats.cpu.SetCapacity(_history);
+    stats.gpu.SetCapacity(_history);
+    _passes.push_back(stats);
+
+    PassQuery query;
+    glGenQueries(FramesInFlight, query.queries);
+    std::fill(query.pending, query.pending + FramesInFlight, false);
+    _queries.push_back(query);
+
+    return static_cast<int>(_passes.size() - 1);
+  }
+
+  void RenderStats::Collect(int slot, bool wait)
+  {
+    for (size_t i = 0; i < _queries.size(); i++) {
+      auto& query = _queries[i];
+      if (!query.pending[slot]) {
+        continue;
+      }
+      query.pending[slot] = false;
+
+      if (!wait) {
+        GLint available = 0;
+        glGetQueryObjectiv(query.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+          _dropped++;
+          continue;
+        }
+      }
+
+      GLuint64 elapsed = 0;
+      glGetQueryObjectui64v(query.queries[slot], GL_QUERY_RESULT, &elapsed);
+      _passes[i].gpu.Push(static_cast<float>(elapsed / 1e6));
+    }
+  }
+
+  void RenderStats::BeginFrame()
+  {
+    // this slot was last used FramesInFlight frames ago
+    Collect(_frame % FramesInFlight, false);
+  }
+
+  void RenderStats::Flush()
+  {
+    // between frames the current slot holds the oldest frame, read oldest
+    // first so the series keep frame order
+    for (int i = 0; i < FramesInFlight; i++) {
+      Collect((_frame + i) % FramesInFlight, true);
+    }
+  }
+
+  void RenderStats::EndFrame()
+  {
+    _frame++;
+  }
+
+  void RenderStats::BeginPass(int pass)
+  {
+    auto& query = _queries[pass];
+    query.cpu_begin = std::chrono::steady_clock::now();
+    glBeginQuery(GL_TIME_ELAPSED, query.queries[_frame % FramesInFlight]);
+  }
+
+  void RenderStats::EndPass(int pass)
+  {
+    auto& query = _queries[pass];
+    glEndQuery(GL_TIME_ELAPSED);
+    query.pending[_frame % FramesInFlight] = true;
+
+    auto cpu_end = std::chrono::steady_clock::now();
+    _passes[pass].cpu.Push(std::chrono::duration<float, std::milli>(cpu_end - query.cpu_begin).count());
+  }
+
+  void RenderStats::Reset()
+  {
+    for (auto& pass : _passes) {
+      pass.cpu.Clear();
+      pass.gpu.Clear();
+    }
+    _dropped = 0;
+  }
+
+  void RenderStats::SetHistorySize(size_t frames)
+  {
+    _history = frames;
+    for (auto& pass : _passes) {
+      pass.cpu.SetCapacity(frames);
+      pass.gpu.SetCapacity(frames);
+    }
+    _dropped = 0;
+  }
+
+  bool RenderStats::ExportCSV(const char* path) const
+  {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+      return false;
+    }
+
+    fprintf(file, "pass,samples,cpu_min,cpu_avg,cpu_max,cpu_p99,gpu_samples,gpu_min,gpu_avg,gpu_max,gpu_p99\n");
+    for (auto& pass : _passes) {
+      fprintf(file, "%s,%zu,%.4f,%.4f,%.4f,%.4f,%zu,%.4f,%.4f,%.4f,%.4f\n", pass.name.c_str(),
+        pass.cpu.Count(), pass.cpu.Min(), pass.cpu.Avg(), pass.cpu.Max(), pass.cpu.Percentile(0.99f),
+        pass.gpu.Count(), pass.gpu.Min(), pass.gpu.Avg(), pass.gpu.Max(), pass.gpu.Percentile(0.99f));
+    }
+
+    fclose(file);
+    return true;
+  }
+
+  static void WriteSeriesJSON(FILE* file, const char* key, const TimingSeries& series)
+  {
+    fprintf(file, "\"%s\": {\"samples\": %zu, \"min\": %.4f, \"avg\": %.4f, \"max\": %.4f, \"p99\": %.4f}",
+      key, series.Count(), series.Min(), series.Avg(), series.Max(), series.Percentile(0.99f));
+  }
+
+  bool RenderStats::ExportJSON(const char* path) const
+  {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+      return false;
+    }
+
+    fprintf(file, "{\n  \"frames\": %llu,\n  \"dropped_queries\": %llu,\n  \"passes\": [\n",
+      static_cast<unsigned long long>(_frame), static_cast<unsigned long long>(_dropped));
+    for (size_t i = 0; i < _passes.size(); i++) {
+      auto& pass = _passes[i];
+      fprintf(file, "    {\"name\": \"%s\", ", pass.name.c_str());
+      WriteSeriesJSON(file, "cpu", pass.cpu);
+      fprintf(file, ", ");
+      WriteSeriesJSON(file, "gpu", pass.gpu);
+      fprintf(file, "}%s\n", i + 1 < _passes.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    fclose(file);
+    return true;
+  }
+}
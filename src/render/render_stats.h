@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace render {
+  // Rolling window of samples in ms, oldest ones are overwritten.
+  class TimingSeries {
+  public:
+    TimingSeries(size_t capacity = 300);
+
+    void Push(float value);
+    void Clear();
+    // drops the samples
+    void SetCapacity(size_t capacity);
+
+    size_t Count() const { return _count; }
+    float Last() const { return _last; }
+    float Min() const;
+    float Max() const;
+    float Avg() const;
+    // p in [0, 1], e.g. 0.99
+    float Percentile(float p) const;
+
+  private:
+    std::vector<float> _samples;
+    size_t _next;
+    size_t _count;
+    float _last;
+  };
+
+  struct PassStats {
+    std::string name;
+    TimingSeries cpu;
+    TimingSeries gpu;
+  };
+
+  // Per pass CPU and GPU timings. GPU time comes from GL_TIME_ELAPSED
+  // queries kept for several frames in flight, a query is only read back
+  // when its slot comes around again, so reading never stalls the pipeline.
+  // Passes must not nest, GL allows one elapsed query at a time.
+  class RenderStats {
+  public:
+    static constexpr int FramesInFlight = 4;
+
+    RenderStats() = default;
+    ~RenderStats();
+
+    RenderStats(const RenderStats&) = delete;
+    RenderStats& operator=(const RenderStats&) = delete;
+
+    // needs a GL context, returns the pass id
+    int AddPass(const char* name);
+
+    void BeginFrame();
+    void EndFrame();
+    void BeginPass(int pass);
+    void EndPass(int pass);
+    // waits for every query in flight, for the end of a run
+    void Flush();
+
+    const std::vector<PassStats>& GetPasses() const { return _passes; }
+    uint64_t GetFrameCount() const { return _frame; }
+    // queries that were not ready when their slot was reused
+    uint64_t GetDroppedCount() const { return _dropped; }
+    void Reset();
+    // window of every series in frames, also resets
+    void SetHistorySize(size_t frames);
+
+    // one row / object per pass with min, avg, max and p99 of both clocks
+    bool ExportCSV(const char* path) const;
+    bool ExportJSON(const char* path) const;
+
+  private:
+    void Collect(int slot, bool wait);
+
+  private:
+    struct PassQuery {
+      unsigned int queries[FramesInFlight];
+      bool pending[FramesInFlight];
+      std::chrono::steady_clock::time_point cpu_begin;
+    };
+
+    std::vector<PassStats> _passes;
+    std::vector<PassQuery> _queries;
+    uint64_t _frame = 0;
+    uint64_t _dropped = 0;
+    size_t _history = 300;
+  };
+}
@@ -6,6 +6,8 @@
 #include <glad/glad.h>
 
 #include "utils.h"
+#include "texture_streamer.h"
+#include "core/profiler.h"
 #include "Model.h"
 
 #include "stb_image.h"
@@ -15,6 +17,7 @@ namespace render {
   ResourceTexture2D::ResourceTexture2D(const char* path, bool with_mipmap, bool is_hdr)
     : Resource(ResourceType::Texture2D)
     , _loaded(false)
+    , _loading(false)
     , _path(path)
     , _width(0)
     , _height(0)
@@ -29,6 +32,7 @@ namespace render {
   ResourceTexture2D::ResourceTexture2D(int width, int height, bool with_mipmap, int NR, bool is_hdr)
     : Resource(ResourceType::Texture2D)
     , _loaded(false)
+    , _loading(false)
     , _path("")
     , _width(width)
     , _height(height)
@@ -45,6 +49,7 @@ namespace render {
     if (IsLoaded()) {
       return;
     }
+    PROFILE_SCOPE("ResourceTexture2D::Load");
 
     if (_path.size()) {
       LoadFromFile();
@@ -56,6 +61,32 @@ namespace render {
     SetLoaded();
   }
 
+  void ResourceTexture2D::LoadAsync()
+  {
+    if (IsLoaded() || IsLoading()) {
+      return;
+    }
+
+    // generated textures have nothing to decode
+    if (_path.empty()) {
+      Load();
+      return;
+    }
+
+    _loading = true;
+    TextureStreamer::GetInstance().Request(TextureHandle::Unpack(GetID()));
+  }
+
+  void ResourceTexture2D::SetStreamed(unsigned int gl_texture, int width, int height, int channel_count)
+  {
+    _gl_texture = gl_texture;
+    _width = width;
+    _height = height;
+    _channel_count = channel_count;
+    _loading = false;
+    SetLoaded();
+  }
+
   bool ResourceTexture2D::BindToTexture(unsigned int texture_idx)
   {
     if (!IsLoaded()) {
@@ -118,6 +149,7 @@ namespace render {
     if (IsLoaded()) {
       return;
     }
+    PROFILE_SCOPE("ResourceTextureCube::Load");
 
     _gl_texture = render::genTextureCube(_width, _height, _with_mipmap, _channel_count);
 
@@ -171,6 +203,7 @@ namespace render {
     if (IsLoaded()) {
       return;
     }
+    PROFILE_SCOPE("ResourceModel::Load");
     _model_ptr = new Model(_path.c_str());
     SetLoaded();
   }
@@ -184,4 +217,13 @@ namespace render {
     _model_ptr->Draw(shader);
   }
 
+  Bounds ResourceModel::GetBounds()
+  {
+    if (!IsLoaded()) {
+      return Bounds();
+    }
+
+    return _model_ptr->GetBounds();
+  }
+
 }
\ No newline at end of file
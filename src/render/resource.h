@@ -3,6 +3,9 @@
 #include <cstdint>
 #include <string>
 
+#include "bounds.h"
+#include "handle.h"
+
 namespace render {
   class Model;
   class Shader;
@@ -15,13 +18,23 @@ namespace render {
     TextureCube,
   };
 
+  class ResourceTexture2D;
+  class ResourceTextureCube;
+  class ResourceModel;
+
+  // resolved by ResourceMgr in O(1), a stale handle resolves to nullptr
+  typedef Handle<ResourceTexture2D> TextureHandle;
+  typedef Handle<ResourceTextureCube> TextureCubeHandle;
+  typedef Handle<ResourceModel> MeshHandle;
+
   class Resource {
   public:
+
     Resource() : _id(0), _type(static_cast<int>(ResourceType::None)) {}
     Resource(ResourceType type) : _id(0), _type(static_cast<int>(type)) {}
     Resource(ResourceType type, uint64_t id) : _id(id), _type(static_cast<int>(type)) {}
 
-    // setter & getter
+    // setter & getter, the packed handle once added to ResourceMgr
     uint64_t GetID() { return _id; }
     void SetID(uint64_t id) { _id = id; }
     int GetType() { return _type; }
@@ -45,12 +58,23 @@ namespace render {
     void Load() override;
     bool IsLoaded() override { return _loaded; }
 
+    // decode on a worker and upload through TextureStreamer over the next
+    // frames, Load() still blocks
+    void LoadAsync();
+    bool IsLoading() { return _loading; }
+    // TextureStreamer, once the last part is uploaded (0 if decoding failed)
+    void SetStreamed(unsigned int gl_texture, int width, int height, int channel_count);
+
     bool BindToTexture(unsigned int texture_idx);
     bool BindToCurrentTexture();
 
     void SetFlipVectical(bool enable) { _flip_vectical = enable; }
 
     unsigned int GetTexture() { return _gl_texture; }
+    const std::string& GetPath() { return _path; }
+    bool IsFlipVectical() { return _flip_vectical; }
+    bool IsHDR() { return _is_hdr; }
+    bool WithMipmap() { return _with_mipmap; }
 
   private:
     void SetLoaded() { _loaded = true; }
@@ -60,6 +84,7 @@ namespace render {
 
   private:
     bool _loaded;
+    bool _loading;
 
     // load texture from file
     std::string _path;
@@ -113,7 +138,12 @@ namespace render {
     void Load() override;
     bool IsLoaded() override { return _loaded; }
 
+    // the MeshArena must be bound
     void Draw(Shader* shader);
+    // nullptr until loaded
+    const Model* GetModel() const { return _loaded ? _model_ptr : nullptr; }
+    // object space bounds of all meshes, invalid until loaded
+    Bounds GetBounds();
 
   private:
     void SetLoaded() { _loaded = true; }
@@ -11,73 +11,72 @@ namespace render {
 
   }
 
-  uint64_t GenTexture2D(unsigned int width, unsigned int height, bool with_mipmap, int NR)
+  TextureHandle GenTexture2D(unsigned int width, unsigned int height, bool with_mipmap, int NR)
   {
-    std::shared_ptr<Resource> new_texture(new ResourceTexture2D(width, height, with_mipmap, NR));
-    ResourceMgr::GetInstance().SetResource(new_texture);
-    return new_texture->GetID();
+    std::unique_ptr<ResourceTexture2D> new_texture(new ResourceTexture2D(width, height, with_mipmap, NR));
+    return ResourceMgr::GetInstance().AddTexture2D(std::move(new_texture));
   }
 
-  uint64_t GenTexture2DFromFile(const char* path, bool with_mipmap, bool is_hdr)
+  TextureHandle GenTexture2DFromFile(const char* path, bool with_mipmap, bool is_hdr)
   {
-    static std::unordered_map<std::string, uint64_t> cache;
+    static std::unordered_map<std::string, TextureHandle> cache;
     std::string cache_idx = path;
     if (!cache.count(cache_idx)) {
-      std::shared_ptr<Resource> new_texture(new ResourceTexture2D(path, with_mipmap, is_hdr));
-      ResourceMgr::GetInstance().SetResource(new_texture);
-      cache[cache_idx] = new_texture->GetID();
+      std::unique_ptr<ResourceTexture2D> new_texture(new ResourceTexture2D(path, with_mipmap, is_hdr));
+      cache[cache_idx] = ResourceMgr::GetInstance().AddTexture2D(std::move(new_texture));
     }
     return cache[cache_idx];
   }
 
-  uint64_t GenTextureCube(unsigned int width, unsigned int height, bool with_mipmap, int NR)
+  TextureCubeHandle GenTextureCube(unsigned int width, unsigned int height, bool with_mipmap, int NR)
   {
-    std::shared_ptr<Resource> new_texture(new ResourceTextureCube(width, height, with_mipmap, NR));
-    ResourceMgr::GetInstance().SetResource(new_texture);
-    return new_texture->GetID();
+    std::unique_ptr<ResourceTextureCube> new_texture(new ResourceTextureCube(width, height, with_mipmap, NR));
+    return ResourceMgr::GetInstance().AddTextureCube(std::move(new_texture));
   }
 
-  uint64_t GenModel(const char* path)
+  MeshHandle GenModel(const char* path)
   {
-    static std::unordered_map<std::string, uint64_t> cache;
+    static std::unordered_map<std::string, MeshHandle> cache;
     std::string cache_idx = path;
     if (!cache.count(cache_idx)) {
-      std::shared_ptr<Resource> new_model(new ResourceModel(path));
-      ResourceMgr::GetInstance().SetResource(new_model);
-      cache[cache_idx] = new_model->GetID();
+      std::unique_ptr<ResourceModel> new_model(new ResourceModel(path));
+      cache[cache_idx] = ResourceMgr::GetInstance().AddModel(std::move(new_model));
     }
     return cache[cache_idx];
   }
 
-  std::shared_ptr<Resource> ResourceMgr::GetResource(uint64_t id)
+  TextureHandle ResourceMgr::AddTexture2D(std::unique_ptr<ResourceTexture2D> res)
   {
-    if (_res.count(id)) {
-      return _res[id];
-    }
-
-    return nullptr;
+    return Add(_textures_2d, std::move(res));
   }
 
-  void ResourceMgr::SetResource(std::shared_ptr<Resource> res)
+  TextureCubeHandle ResourceMgr::AddTextureCube(std::unique_ptr<ResourceTextureCube> res)
   {
-    auto new_id = GenResourceId();
-    res->SetID(new_id);
+    return Add(_textures_cube, std::move(res));
+  }
 
-    _res[new_id] = res;
+  MeshHandle ResourceMgr::AddModel(std::unique_ptr<ResourceModel> res)
+  {
+    return Add(_models, std::move(res));
   }
 
   void ResourceMgr::Load()
   {
-    for (auto& res : _res) {
-      if (!res.second->IsLoaded()) {
-        res.second->Load();
+    for (auto& res : _textures_2d) {
+      if (!res->IsLoaded()) {
+        res->Load();
+      }
+    }
+    for (auto& res : _textures_cube) {
+      if (!res->IsLoaded()) {
+        res->Load();
+      }
+    }
+    for (auto& res : _models) {
+      if (!res->IsLoaded()) {
+        res->Load();
       }
     }
   }
 
-  void ResourceMgr::Load(uint64_t id)
-  {
-    _res[id]->Load();
-  }
-
-}
\ No newline at end of file
+}
@@ -1,18 +1,26 @@
 #pragma once
 
 #include <cstdint>
-#include <unordered_map>
 #include <memory>
 
-namespace render {
+#include "handle.h"
+#include "resource.h"
+
+namespace core {
+  class JobSystem;
+}
 
-  uint64_t GenTexture2D(unsigned int width, unsigned int height, bool with_mipmap = false, int NR = 3);
-  uint64_t GenTexture2DFromFile(const char* path, bool with_mipmap = false, bool is_hdr = false);
-  uint64_t GenTextureCube(unsigned int width, unsigned int height, bool with_mipmap = false, int NR = 3);
-  uint64_t GenModel(const char* path);
+namespace render {
 
-  class Resource;
+  TextureHandle GenTexture2D(unsigned int width, unsigned int height, bool with_mipmap = false, int NR = 3);
+  TextureHandle GenTexture2DFromFile(const char* path, bool with_mipmap = false, bool is_hdr = false);
+  TextureCubeHandle GenTextureCube(unsigned int width, unsigned int height, bool with_mipmap = false, int NR = 3);
+  MeshHandle GenModel(const char* path);
 
+  // One dense slot table per resource type, so resolving a handle is an
+  // index and a generation compare: no hashing, refcounts or casts on the
+  // per draw paths. Resources are boxed, pointers stay valid while others
+  // are added.
   class ResourceMgr {
   public:
     static ResourceMgr& GetInstance() {
@@ -20,27 +28,44 @@ namespace render {
       return inst;
     }
 
-    std::shared_ptr<Resource> GetResource(uint64_t id);
-    void SetResource(std::shared_ptr<Resource> res);
+    TextureHandle AddTexture2D(std::unique_ptr<ResourceTexture2D> res);
+    TextureCubeHandle AddTextureCube(std::unique_ptr<ResourceTextureCube> res);
+    MeshHandle AddModel(std::unique_ptr<ResourceModel> res);
 
-    template<typename T>
-    std::shared_ptr<T> GetResourceAs(uint64_t id) {
-      auto res = GetResource(id);
-      return std::dynamic_pointer_cast<T>(res);
-    }
+    // nullptr for stale handles
+    ResourceTexture2D* GetTexture2D(TextureHandle handle) { return Resolve(_textures_2d, handle); }
+    ResourceTextureCube* GetTextureCube(TextureCubeHandle handle) { return Resolve(_textures_cube, handle); }
+    ResourceModel* GetModel(MeshHandle handle) { return Resolve(_models, handle); }
 
     void Load();
-    void Load(uint64_t id);
+
+    void SetJobSystem(core::JobSystem* jobs) { _jobs = jobs; }
+    core::JobSystem* GetJobSystem() { return _jobs; }
 
   private:
-    ResourceMgr() {}
+    ResourceMgr() : _jobs(nullptr) {}
 
-    uint64_t GenResourceId() {
-      static uint64_t base_id = 0;
-      return ++base_id;
+    template<typename T>
+    using Table = DenseTable<std::unique_ptr<T>, T>;
+
+    template<typename T>
+    static T* Resolve(Table<T>& table, Handle<T> handle) {
+      auto res = table.Get(handle);
+      return res ? res->get() : nullptr;
+    }
+
+    template<typename T>
+    static Handle<T> Add(Table<T>& table, std::unique_ptr<T> res) {
+      auto raw = res.get();
+      auto handle = table.Create(std::move(res));
+      raw->SetID(handle.Pack());
+      return handle;
     }
 
-    std::unordered_map<uint64_t, std::shared_ptr<Resource>> _res;
+    Table<ResourceTexture2D> _textures_2d;
+    Table<ResourceTextureCube> _textures_cube;
+    Table<ResourceModel> _models;
+    core::JobSystem* _jobs;
   };
 
-}
\ No newline at end of file
+}
@@ -2,26 +2,26 @@
 #include "resource_mgr.h"
 
 namespace render {
-  std::shared_ptr<ResourceTexture2D> GetTexture2DResource(uint64_t id, bool auto_load) {
-    auto texture = ResourceMgr::GetInstance().GetResourceAs<ResourceTexture2D>(id);
-    if (!texture->IsLoaded() && auto_load) {
+  ResourceTexture2D* GetTexture2DResource(TextureHandle handle, bool auto_load) {
+    auto texture = ResourceMgr::GetInstance().GetTexture2D(handle);
+    if (texture && !texture->IsLoaded() && auto_load) {
       texture->Load();
     }
     return texture;
   }
-  std::shared_ptr<ResourceTextureCube> GetTextureCubeResource(uint64_t id, bool auto_load) {
-    auto texture = ResourceMgr::GetInstance().GetResourceAs<ResourceTextureCube>(id);
-    if (!texture->IsLoaded() && auto_load) {
+  ResourceTextureCube* GetTextureCubeResource(TextureCubeHandle handle, bool auto_load) {
+    auto texture = ResourceMgr::GetInstance().GetTextureCube(handle);
+    if (texture && !texture->IsLoaded() && auto_load) {
       texture->Load();
     }
     return texture;
   }
-  std::shared_ptr<ResourceModel> GetModelResource(uint64_t id, bool auto_load)
+  ResourceModel* GetModelResource(MeshHandle handle, bool auto_load)
   {
-    auto model = ResourceMgr::GetInstance().GetResourceAs<ResourceModel>(id);
-    if (!model->IsLoaded() && auto_load) {
+    auto model = ResourceMgr::GetInstance().GetModel(handle);
+    if (model && !model->IsLoaded() && auto_load) {
       model->Load();
     }
     return model;
   }
-}
\ No newline at end of file
+}
@@ -1,10 +1,10 @@
 #pragma once
-#include <memory>
 
 #include "resource.h"
 
 namespace render {
-  std::shared_ptr<ResourceTexture2D> GetTexture2DResource(uint64_t id, bool auto_load = true);
-  std::shared_ptr<ResourceTextureCube> GetTextureCubeResource(uint64_t id, bool auto_load = true);
-  std::shared_ptr<ResourceModel> GetModelResource(uint64_t id, bool auto_load = true);
-}
\ No newline at end of file
+  // nullptr for stale handles
+  ResourceTexture2D* GetTexture2DResource(TextureHandle handle, bool auto_load = true);
+  ResourceTextureCube* GetTextureCubeResource(TextureCubeHandle handle, bool auto_load = true);
+  ResourceModel* GetModelResource(MeshHandle handle, bool auto_load = true);
+}
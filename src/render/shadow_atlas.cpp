@@ -0,0 +1,266 @@
+#include "shadow_atlas.h"
+
+#include <algorithm>
+
+#include <glad/glad.h>
+
+namespace render {
+  // faces and layers of the cube pages, largest first, 108 MB of depth
+  static const int page_sizes[ShadowAtlas::PageCount] = { 1024, 512, 256, 128 };
+  static const int page_layers[ShadowAtlas::PageCount] = { 2, 4, 16, 32 };
+
+  static void SetDepthParameters(unsigned int target)
+  {
+    // compared by hand in pbr_fs.glsl
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  }
+
+  ShadowAtlas::ShadowAtlas()
+    : _atlas_size(0)
+    , _min_tile_size(0)
+    , _level_count(0)
+    , _atlas_texture(0)
+    , _tile_area(0)
+    , _frame_buffer(0)
+  {
+    for (int i = 0; i < PageCount; i++) {
+      _pages[i].size = page_sizes[i];
+      _pages[i].layer_count = page_layers[i];
+      _pages[i].texture = 0;
+    }
+  }
+
+  void ShadowAtlas::Init(int atlas_size, int min_tile_size)
+  {
+    _atlas_size = atlas_size;
+    _min_tile_size = min_tile_size;
+    _level_count = 1;
+    for (int size = atlas_size; size > min_tile_size; size /= 2) {
+      _level_count++;
+    }
+    _free_tiles.assign(_level_count, {});
+    _free_tiles[0].push_back({ 0, 0, atlas_size });
+
+    glGenTextures(1, &_atlas_texture);
+    glBindTexture(GL_TEXTURE_2D, _atlas_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, atlas_size, atlas_size);
+    SetDepthParameters(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (auto& page : _pages) {
+      glGenTextures(1, &page.texture);
+      glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, page.texture);
+      glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 1, GL_DEPTH_COMPONENT24, page.size, page.size, page.layer_count * 6);
+      SetDepthParameters(GL_TEXTURE_CUBE_MAP_ARRAY);
+      // handed out from layer 0
+      page.free_layers.clear();
+      for (int layer = page.layer_count - 1; layer >= 0; layer--) {
+        page.free_layers.push_back(layer);
+      }
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+    glGenFramebuffers(1, &_frame_buffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _frame_buffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  int ShadowAtlas::GetLevel(int size) const
+  {
+    int level = 0;
+    for (int block = _atlas_size; block / 2 >= size && block > _min_tile_size; block /= 2) {
+      level++;
+    }
+    return level;
+  }
+
+  bool ShadowAtlas::PopBlock(int level, ShadowTile& res)
+  {
+    auto& blocks = _free_tiles[level];
+    if (!blocks.empty()) {
+      res = blocks.back();
+      blocks.pop_back();
+      return true;
+    }
+
+    ShadowTile parent;
+    if (level == 0 || !PopBlock(level - 1, parent)) {
+      return false;
+    }
+    int size = parent.size / 2;
+    blocks.push_back({ parent.x + size, parent.y + size, size });
+    blocks.push_back({ parent.x, parent.y + size, size });
+    blocks.push_back({ parent.x + size, parent.y, size });
+    res = { parent.x, parent.y, size };
+    return true;
+  }
+
+  void ShadowAtlas::PushBlock(int level, const ShadowTile& tile)
+  {
+    auto& blocks = _free_tiles[level];
+    if (level == 0) {
+      blocks.push_back(tile);
+      return;
+    }
+
+    // merged back into the parent once all four children are free
+    int size = tile.size;
+    ShadowTile parent = { tile.x - tile.x % (size * 2), tile.y - tile.y % (size * 2), size * 2 };
+    std::vector<ShadowTile>::iterator siblings[3];
+    int found = 0;
+    for (int i = 0; i < 4; i++) {
+      int x = parent.x + (i & 1) * size;
+      int y = parent.y + (i >> 1) * size;
+      if (x == tile.x && y == tile.y) {
+        continue;
+      }
+      auto it = std::find_if(blocks.begin(), blocks.end(), [x, y](const ShadowTile& block) {
+        return block.x == x && block.y == y;
+        });
+      if (it == blocks.end()) {
+        break;
+      }
+      siblings[found++] = it;
+    }
+
+    if (found < 3) {
+      blocks.push_back(tile);
+      return;
+    }
+    // back to front, so the other iterators stay valid
+    std::sort(siblings, siblings + 3, [](const std::vector<ShadowTile>::iterator& a, const std::vector<ShadowTile>::iterator& b) {
+      return a > b;
+      });
+    for (auto it : siblings) {
+      blocks.erase(it);
+    }
+    PushBlock(level - 1, parent);
+  }
+
+  bool ShadowAtlas::AllocateTile(int size, ShadowTile& res)
+  {
+    for (int level = GetLevel(size); level < _level_count; level++) {
+      if (PopBlock(level, res)) {
+        _tile_area += size_t(res.size) * res.size;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void ShadowAtlas::FreeTile(ShadowTile& tile)
+  {
+    if (!tile.IsValid()) {
+      return;
+    }
+    _tile_area -= size_t(tile.size) * tile.size;
+    PushBlock(GetLevel(tile.size), tile);
+    tile = ShadowTile();
+  }
+
+  bool ShadowAtlas::AllocateCube(int page, ShadowCube& res)
+  {
+    for (int i = std::max(page, 0); i < PageCount; i++) {
+      auto& layers = _pages[i].free_layers;
+      if (!layers.empty()) {
+        res.page = i;
+        res.layer = layers.back();
+        layers.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void ShadowAtlas::FreeCube(ShadowCube& cube)
+  {
+    if (!cube.IsValid()) {
+      return;
+    }
+    _pages[cube.page].free_layers.push_back(cube.layer);
+    cube = ShadowCube();
+  }
+
+  int ShadowAtlas::PickPage(float size) const
+  {
+    for (int page = PageCount - 1; page > 0; page--) {
+      if (_pages[page].size >= size) {
+        return page;
+      }
+    }
+    return 0;
+  }
+
+  int ShadowAtlas::GetPageSize(int page) const
+  {
+    return _pages[page].size;
+  }
+
+  glm::vec4 ShadowAtlas::GetTileRect(const ShadowTile& tile) const
+  {
+    float scale = 1.0f / _atlas_size;
+    return glm::vec4(tile.x * scale, tile.y * scale, tile.size * scale, tile.size * scale);
+  }
+
+  int32_t ShadowAtlas::EncodeCube(const ShadowCube& cube)
+  {
+    // page in the high bits, layer in the low 8
+    return cube.IsValid() ? (cube.page << 8) | cube.layer : -1;
+  }
+
+  void ShadowAtlas::BeginTile(const ShadowTile& tile)
+  {
+    glBindFramebuffer(GL_FRAMEBUFFER, _frame_buffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _atlas_texture, 0);
+    glViewport(tile.x, tile.y, tile.size, tile.size);
+    // the clear stays inside the tile
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(tile.x, tile.y, tile.size, tile.size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+  }
+
+  void ShadowAtlas::BeginCube(const ShadowCube& cube)
+  {
+    const auto& page = _pages[cube.page];
+    glBindFramebuffer(GL_FRAMEBUFFER, _frame_buffer);
+    // a tile drawn before in the same pass left its scissor on
+    glDisable(GL_SCISSOR_TEST);
+    // a layered attachment clears every layer, so the faces go one by one
+    for (int face = 0; face < 6; face++) {
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, page.texture, 0, cube.layer * 6 + face);
+      glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, page.texture, 0);
+    glViewport(0, 0, page.size, page.size);
+  }
+
+  void ShadowAtlas::End()
+  {
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  int ShadowAtlas::GetCubeCount() const
+  {
+    int res = 0;
+    for (const auto& page : _pages) {
+      res += page.layer_count - static_cast<int>(page.free_layers.size());
+    }
+    return res;
+  }
+
+  int ShadowAtlas::GetCubeCapacity() const
+  {
+    int res = 0;
+    for (const auto& page : _pages) {
+      res += page.layer_count;
+    }
+    return res;
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace render {
+  // square of the 2D atlas in texels, size 0 when there is none
+  struct ShadowTile {
+    int x = 0;
+    int y = 0;
+    int size = 0;
+
+    bool IsValid() const { return size > 0; }
+  };
+
+  // cube `layer` of cube array `page`, page -1 when there is none
+  struct ShadowCube {
+    int page = -1;
+    int layer = 0;
+
+    bool IsValid() const { return page >= 0; }
+  };
+
+  // Shadow maps of every light in a few textures, so the number of shadowed
+  // lights is bounded by memory instead of by sampler units:
+  //   atlas  one 2D depth texture split into power of two tiles, a buddy
+  //          allocator hands them out and merges them again on free
+  //   pages  a cube map array per resolution, page 0 is the largest, a
+  //          cube is a free layer of the page
+  // The contents of a slot stay as they are until the slot is rendered
+  // again, so the caller can keep shadows that did not change.
+  class ShadowAtlas {
+  public:
+    static constexpr int PageCount = 4;
+
+    ShadowAtlas();
+
+    // `atlas_size` and `min_tile_size` are powers of two
+    void Init(int atlas_size, int min_tile_size);
+
+    // `size` is rounded up to a power of two and clamped to the tile sizes,
+    // smaller tiles are tried when the atlas is full
+    bool AllocateTile(int size, ShadowTile& res);
+    void FreeTile(ShadowTile& tile);
+    // `page` first, then the smaller pages
+    bool AllocateCube(int page, ShadowCube& res);
+    void FreeCube(ShadowCube& cube);
+
+    // smallest page with faces of at least `size` texels
+    int PickPage(float size) const;
+    int GetPageSize(int page) const;
+    // uv offset in xy, uv scale in zw
+    glm::vec4 GetTileRect(const ShadowTile& tile) const;
+    // PLight::shadow_idx in pbr_fs.glsl, -1 for none
+    static int32_t EncodeCube(const ShadowCube& cube);
+
+    // the depth attachment, viewport and clear of one slot, for a pass
+    // writing only into it. Cubes are drawn layered: gl_Layer is
+    // cube.layer * 6 + face.
+    void BeginTile(const ShadowTile& tile);
+    void BeginCube(const ShadowCube& cube);
+    void End();
+
+    unsigned int GetAtlasTexture() const { return _atlas_texture; }
+    unsigned int GetPageTexture(int page) const { return _pages[page].texture; }
+    int GetAtlasSize() const { return _atlas_size; }
+    // texels in use out of the atlas, cubes in use out of all pages
+    size_t GetTileArea() const { return _tile_area; }
+    int GetCubeCount() const;
+    int GetCubeCapacity() const;
+
+  private:
+    struct Page {
+      int size;
+      int layer_count;
+      unsigned int texture;
+      std::vector<int> free_layers;
+    };
+
+    int GetLevel(int size) const;
+    // a free block of `level`, split from a larger one if needed
+    bool PopBlock(int level, ShadowTile& res);
+    void PushBlock(int level, const ShadowTile& tile);
+
+  private:
+    int _atlas_size;
+    int _min_tile_size;
+    int _level_count;
+    unsigned int _atlas_texture;
+    // free blocks per level, level 0 is the whole atlas
+    std::vector<std::vector<ShadowTile>> _free_tiles;
+    size_t _tile_area;
+
+    Page _pages[PageCount];
+    unsigned int _frame_buffer;
+  };
+}
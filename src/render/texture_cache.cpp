@@ -0,0 +1,148 @@
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "utils.h"
+#include "core/mapped_file.h"
+
+namespace render {
+  static const uint64_t fnv_offset = 0xcbf29ce484222325ull;
+  static const uint64_t fnv_prime = 0x100000001b3ull;
+
+  static size_t GetLevelSize(const TextureCacheShape& shape, int level)
+  {
+    size_t width = std::max(1, shape.width >> level);
+    size_t height = std::max(1, shape.height >> level);
+    // half floats
+    return width * height * shape.channel_count * 2;
+  }
+
+  static size_t GetDataSize(const TextureCacheShape& shape)
+  {
+    size_t res = 0;
+    for (int level = 0; level < shape.levels; level++) {
+      res += GetLevelSize(shape, level) * (shape.is_cube ? 6 : 1);
+    }
+    return res;
+  }
+
+  static unsigned int GetFaceTarget(const TextureCacheShape& shape, int face)
+  {
+    return shape.is_cube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+  }
+
+  bool TextureCache::Load(const char* path, uint64_t key, unsigned int gl_texture, const TextureCacheShape& shape)
+  {
+    core::MappedFile file;
+    if (!file.Open(path) || file.GetSize() < sizeof(TextureCacheHeader)) {
+      return false;
+    }
+
+    TextureCacheHeader header;
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (header.magic != TextureCacheHeader::Magic || header.version != TextureCacheHeader::Version ||
+      header.key != key || header.faces != (shape.is_cube ? 6u : 1u) ||
+      header.width != uint32_t(shape.width) || header.height != uint32_t(shape.height) ||
+      header.levels != uint32_t(shape.levels) || header.channel_count != uint32_t(shape.channel_count) ||
+      file.GetSize() != sizeof(TextureCacheHeader) + GetDataSize(shape)) {
+      return false;
+    }
+
+    auto target = shape.is_cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    auto format = getTextureFormat(shape.channel_count);
+    auto data = file.GetData() + sizeof(TextureCacheHeader);
+
+    glBindTexture(target, gl_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < shape.levels; level++) {
+      int width = std::max(1, shape.width >> level);
+      int height = std::max(1, shape.height >> level);
+      for (uint32_t face = 0; face < header.faces; face++) {
+        glTexSubImage2D(GetFaceTarget(shape, face), level, 0, 0, width, height, format, GL_HALF_FLOAT, data);
+        data += GetLevelSize(shape, level);
+      }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(target, 0);
+    return true;
+  }
+
+  bool TextureCache::Save(const char* path, uint64_t key, unsigned int gl_texture, const TextureCacheShape& shape)
+  {
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TextureCacheHeader::Magic;
+    header.version = TextureCacheHeader::Version;
+    header.key = key;
+    header.width = shape.width;
+    header.height = shape.height;
+    header.faces = shape.is_cube ? 6 : 1;
+    header.levels = shape.levels;
+    header.channel_count = shape.channel_count;
+
+    std::vector<uint8_t> data(GetDataSize(shape));
+    auto target = shape.is_cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    auto format = getTextureFormat(shape.channel_count);
+
+    glBindTexture(target, gl_texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    size_t offset = 0;
+    for (int level = 0; level < shape.levels; level++) {
+      for (uint32_t face = 0; face < header.faces; face++) {
+        glGetTexImage(GetFaceTarget(shape, face), level, format, GL_HALF_FLOAT, data.data() + offset);
+        offset += GetLevelSize(shape, level);
+      }
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(target, 0);
+
+    // written aside and renamed, a crash never leaves half a cache behind
+    std::string tmp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+      return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fclose(file) == 0 && ok;
+
+    if (ok) {
+      std::remove(path);
+      ok = std::rename(tmp_path.c_str(), path) == 0;
+    }
+    if (!ok) {
+      std::remove(tmp_path.c_str());
+    }
+    return ok;
+  }
+
+  uint64_t HashFile(const char* path)
+  {
+    core::MappedFile file;
+    if (!file.Open(path)) {
+      return 0;
+    }
+
+    uint64_t res = fnv_offset;
+    auto data = file.GetData();
+    for (size_t i = 0; i < file.GetSize(); i++) {
+      res = (res ^ data[i]) * fnv_prime;
+    }
+    return res;
+  }
+
+  uint64_t HashCombine(uint64_t seed, uint64_t value)
+  {
+    for (int i = 0; i < 8; i++) {
+      seed = (seed ^ ((value >> (i * 8)) & 0xff)) * fnv_prime;
+    }
+    return seed;
+  }
+}
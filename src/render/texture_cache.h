@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace render {
+  // Texels of a GL texture saved to disk, for textures that are rendered
+  // from their inputs once, like the IBL maps of a skybox:
+  //   TextureCacheHeader
+  //   per level, per face: half float texels, tightly packed rows
+  // A file whose key or shape does not match is ignored, the caller renders
+  // the texture again and overwrites it.
+  struct TextureCacheHeader {
+    static constexpr uint32_t Magic = 0x43584554; // "TEXC"
+    static constexpr uint32_t Version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t faces;
+    uint32_t levels;
+    uint32_t channel_count;
+    uint32_t reserved;
+  };
+
+  struct TextureCacheShape {
+    bool is_cube;
+    int width;
+    int height;
+    // saved from level 0, the rest of the chain is left as is
+    int levels;
+    int channel_count;
+  };
+
+  class TextureCache {
+  public:
+    // uploads the texels into `gl_texture`, which must already have the shape
+    static bool Load(const char* path, uint64_t key, unsigned int gl_texture, const TextureCacheShape& shape);
+    // reads the texels back, stalls until the GPU has rendered them
+    static bool Save(const char* path, uint64_t key, unsigned int gl_texture, const TextureCacheShape& shape);
+  };
+
+  // FNV-1a of the file contents, 0 when it can not be read
+  uint64_t HashFile(const char* path);
+  uint64_t HashCombine(uint64_t seed, uint64_t value);
+}
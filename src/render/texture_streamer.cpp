@@ -0,0 +1,247 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "resource.h"
+#include "resource_mgr.h"
+#include "utils.h"
+#include "core/job_system.h"
+#include "core/profiler.h"
+
+#include "stb_image.h"
+
+namespace render {
+  static const size_t staging_count = 4;
+  // rows are uploaded in parts of about this size
+  static const size_t staging_chunk_size = 4 << 20;
+
+  DecodedImage::DecodedImage(DecodedImage&& other) noexcept
+  {
+    *this = std::move(other);
+  }
+
+  DecodedImage& DecodedImage::operator=(DecodedImage&& other) noexcept
+  {
+    if (this != &other) {
+      stbi_image_free(pixels);
+      texture = other.texture;
+      width = other.width;
+      height = other.height;
+      channel_count = other.channel_count;
+      is_hdr = other.is_hdr;
+      pixels = other.pixels;
+      other.pixels = nullptr;
+    }
+    return *this;
+  }
+
+  DecodedImage::~DecodedImage()
+  {
+    stbi_image_free(pixels);
+  }
+
+  size_t DecodedImage::GetRowSize() const
+  {
+    return size_t(width) * channel_count * (is_hdr ? sizeof(float) : 1);
+  }
+
+  TextureStreamer::TextureStreamer()
+    : _decoded(std::make_shared<DecodeQueue>())
+    , _next_staging(0)
+    , _pending(0)
+    , _uploaded_bytes(0)
+  {
+  }
+
+  void TextureStreamer::Request(TextureHandle handle)
+  {
+    auto texture = ResourceMgr::GetInstance().GetTexture2D(handle);
+    if (!texture) {
+      return;
+    }
+    _pending++;
+
+    auto queue = _decoded;
+    std::string path = texture->GetPath();
+    bool flip = texture->IsFlipVectical();
+    bool is_hdr = texture->IsHDR();
+    auto decode = [queue, handle, path, flip, is_hdr]() {
+      PROFILE_SCOPE("TextureStreamer::Decode");
+      DecodedImage image;
+      image.texture = handle;
+      image.is_hdr = is_hdr;
+
+      // the global flag is shared by every thread
+      stbi_set_flip_vertically_on_load_thread(flip);
+      if (is_hdr) {
+        image.pixels = stbi_loadf(path.c_str(), &image.width, &image.height, &image.channel_count, 0);
+      }
+      else {
+        image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channel_count, 0);
+      }
+
+      std::lock_guard<std::mutex> guard(queue->lock);
+      queue->images.push_back(std::move(image));
+    };
+
+    auto jobs = ResourceMgr::GetInstance().GetJobSystem();
+    if (jobs && jobs->IsRunning()) {
+      jobs->Schedule(decode);
+    }
+    else {
+      decode();
+    }
+  }
+
+  void TextureStreamer::Update(float budget_ms)
+  {
+    PROFILE_SCOPE("TextureStreamer::Update");
+    auto begin = std::chrono::steady_clock::now();
+
+    {
+      std::lock_guard<std::mutex> guard(_decoded->lock);
+      _ready.swap(_decoded->images);
+    }
+    for (auto& image : _ready) {
+      BeginUpload(std::move(image));
+    }
+    _ready.clear();
+
+    if (_uploads.empty()) {
+      return;
+    }
+
+    if (_staging.empty()) {
+      _staging.resize(staging_count);
+      for (auto& staging : _staging) {
+        glGenBuffers(1, &staging.pbo);
+        staging.capacity = 0;
+        staging.fence = nullptr;
+      }
+    }
+
+    // at least one part per frame so big textures still finish
+    while (!_uploads.empty()) {
+      auto& upload = _uploads.front();
+      if (!UploadRows(upload)) {
+        break;
+      }
+      if (upload.next_row >= upload.image.height) {
+        FinishUpload(upload);
+        _uploads.pop_front();
+      }
+
+      auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin).count();
+      if (elapsed >= budget_ms) {
+        break;
+      }
+    }
+  }
+
+  void TextureStreamer::BeginUpload(DecodedImage&& image)
+  {
+    auto texture = ResourceMgr::GetInstance().GetTexture2D(image.texture);
+    if (!texture) {
+      _pending--;
+      return;
+    }
+
+    // bad file, same as a blocking Load
+    if (!image.pixels || image.channel_count < 1 || image.channel_count > 4) {
+      texture->SetStreamed(0, 0, 0, 0);
+      _pending--;
+      return;
+    }
+
+    Upload upload;
+    upload.with_mipmap = texture->WithMipmap();
+    upload.gl_texture = genTexture2DStorage(image.width, image.height, upload.with_mipmap, image.channel_count);
+    upload.next_row = 0;
+    upload.image = std::move(image);
+    _uploads.push_back(std::move(upload));
+  }
+
+  TextureStreamer::StagingBuffer* TextureStreamer::AcquireStaging(size_t size)
+  {
+    // fences signal in order, the oldest buffer is always the next one
+    auto& staging = _staging[_next_staging];
+    if (staging.fence) {
+      auto fence = static_cast<GLsync>(staging.fence);
+      if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        return nullptr;
+      }
+      glDeleteSync(fence);
+      staging.fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.pbo);
+    if (staging.capacity < size) {
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+      staging.capacity = size;
+    }
+
+    _next_staging = (_next_staging + 1) % _staging.size();
+    return &staging;
+  }
+
+  bool TextureStreamer::UploadRows(Upload& upload)
+  {
+    auto& image = upload.image;
+    size_t row_size = image.GetRowSize();
+    int rows = static_cast<int>(std::max<size_t>(1, staging_chunk_size / row_size));
+    rows = std::min(rows, image.height - upload.next_row);
+    size_t size = rows * row_size;
+
+    auto staging = AcquireStaging(size);
+    if (!staging) {
+      return false;
+    }
+
+    // the fence says the GPU is done with the old contents
+    auto dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!dst) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      return false;
+    }
+    memcpy(dst, static_cast<const char*>(image.pixels) + upload.next_row * row_size, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glBindTexture(GL_TEXTURE_2D, upload.gl_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload.next_row, image.width, rows,
+      getTextureFormat(image.channel_count), image.is_hdr ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    staging->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    upload.next_row += rows;
+    _uploaded_bytes += size;
+    return true;
+  }
+
+  void TextureStreamer::FinishUpload(Upload& upload)
+  {
+    if (upload.with_mipmap) {
+      glBindTexture(GL_TEXTURE_2D, upload.gl_texture);
+      glGenerateMipmap(GL_TEXTURE_2D);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    auto& image = upload.image;
+    auto texture = ResourceMgr::GetInstance().GetTexture2D(image.texture);
+    if (texture) {
+      texture->SetStreamed(upload.gl_texture, image.width, image.height, image.channel_count);
+    }
+    else {
+      glDeleteTextures(1, &upload.gl_texture);
+    }
+    _pending--;
+  }
+}
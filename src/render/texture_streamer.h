@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "resource.h"
+
+namespace render {
+  // Decoded by stb on a worker, owns the pixels.
+  struct DecodedImage {
+    TextureHandle texture;
+    int width = 0;
+    int height = 0;
+    int channel_count = 0;
+    bool is_hdr = false;
+    void* pixels = nullptr;
+
+    DecodedImage() = default;
+    DecodedImage(DecodedImage&& other) noexcept;
+    DecodedImage& operator=(DecodedImage&& other) noexcept;
+    ~DecodedImage();
+
+    size_t GetRowSize() const;
+  };
+
+  // Streams file textures in without blocking the frame. Files are decoded
+  // on the job system, the GL thread then copies the rows into pixel buffer
+  // objects a few MB at a time and uploads them with glTexSubImage2D, until
+  // the per frame budget is spent. Mips are generated after the last rows,
+  // then the texture counts as loaded. Until then callers bind a placeholder.
+  class TextureStreamer {
+  public:
+    static TextureStreamer& GetInstance() {
+      static TextureStreamer inst;
+      return inst;
+    }
+
+    // GL thread, a ResourceTexture2D with a path
+    void Request(TextureHandle handle);
+    // GL thread, once per frame before drawing
+    void Update(float budget_ms);
+
+    // requested and not yet loaded
+    size_t GetPendingCount() const { return _pending; }
+    size_t GetUploadedBytes() const { return _uploaded_bytes; }
+
+  private:
+    TextureStreamer();
+
+    // filled by the decode jobs, shared so late jobs never outlive it
+    struct DecodeQueue {
+      std::mutex lock;
+      std::vector<DecodedImage> images;
+    };
+
+    struct Upload {
+      DecodedImage image;
+      unsigned int gl_texture;
+      bool with_mipmap;
+      int next_row;
+    };
+
+    // a pixel buffer, free again once the GPU passed its fence
+    struct StagingBuffer {
+      unsigned int pbo;
+      size_t capacity;
+      void* fence;
+    };
+
+    void BeginUpload(DecodedImage&& image);
+    StagingBuffer* AcquireStaging(size_t size);
+    // false when no staging buffer is free this frame
+    bool UploadRows(Upload& upload);
+    void FinishUpload(Upload& upload);
+
+  private:
+    std::shared_ptr<DecodeQueue> _decoded;
+    std::vector<DecodedImage> _ready;
+    std::deque<Upload> _uploads;
+
+    std::vector<StagingBuffer> _staging;
+    size_t _next_staging;
+
+    size_t _pending;
+    size_t _uploaded_bytes;
+  };
+}
@@ -1,5 +1,6 @@
 #include "utils.h"
 
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <unordered_map>
@@ -282,4 +283,30 @@ namespace render {
     return res;
   }
 
+  unsigned int genTexture2DStorage(unsigned int width, unsigned int height, bool with_mipmap, int NR)
+  {
+    int levels = 1;
+    if (with_mipmap) {
+      for (auto size = std::max(width, height); size > 1; size >>= 1) {
+        levels++;
+      }
+    }
+
+    unsigned int res;
+    glGenTextures(1, &res);
+    glBindTexture(GL_TEXTURE_2D, res);
+    glTexStorage2D(GL_TEXTURE_2D, levels, channel_map[NR].first, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, with_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return res;
+  }
+
+  unsigned int getTextureFormat(int NR)
+  {
+    return channel_map[NR].second;
+  }
+
 }
\ No newline at end of file
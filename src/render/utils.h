@@ -9,4 +9,8 @@ namespace render {
   unsigned int genTextureCube(unsigned int width, unsigned int height, bool with_mipmap = false, int NR = 3);
   unsigned int genTexture2D(unsigned int width, unsigned int height, 
     bool with_mipmap = false, int NR = 3, const void* data = nullptr, bool is_hdr = false);
+  // immutable storage with every mip level allocated, filled later with glTexSubImage2D
+  unsigned int genTexture2DStorage(unsigned int width, unsigned int height, bool with_mipmap = false, int NR = 3);
+  // channels of the GL format matching NR, e.g. GL_RGB for 3
+  unsigned int getTextureFormat(int NR);
 };
\ No newline at end of file